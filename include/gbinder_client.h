@@ -62,6 +62,29 @@ GBinderLocalRequest*
 gbinder_client_new_request(
     GBinderClient* client);
 
+/*
+ * Same as gbinder_client_new_request() but the request is presized
+ * based on the size of the requests previously sent with this code.
+ */
+GBinderLocalRequest*
+gbinder_client_new_request2(
+    GBinderClient* client,
+    guint32 code);
+
+/*
+ * Builds the request in the caller provided storage (normally, on stack)
+ * and only touches the heap if the data don't fit there. Such a request
+ * may only be passed to gbinder_client_transact_sync_reply() or
+ * gbinder_client_transact_sync_oneway() and must be unreferenced before
+ * the storage goes away. The request itself takes a couple hundred bytes
+ * of the storage.
+ */
+GBinderLocalRequest*
+gbinder_client_init_request(
+    GBinderClient* client,
+    void* buf,
+    gsize size);
+
 GBinderRemoteReply*
 gbinder_client_transact_sync_reply(
     GBinderClient* client,
@@ -53,6 +53,17 @@ GBinderLocalReply*
 gbinder_local_object_new_reply(
     GBinderLocalObject* obj);
 
+/* Max number of pending incoming transactions, 0 = no limit */
+void
+gbinder_local_object_set_max_pending(
+    GBinderLocalObject* obj,
+    guint max);
+
+gboolean
+gbinder_local_object_get_incoming_stats(
+    GBinderLocalObject* obj,
+    GBinderIncomingStats* stats);
+
 G_END_DECLS
 
 #endif /* GBINDER_LOCAL_OBJECT_H */
@@ -56,6 +56,11 @@ gbinder_local_reply_cleanup(
     GDestroyNotify destroy,
     gpointer pointer);
 
+/* Drops the contents but keeps the allocated memory for reuse */
+void
+gbinder_local_reply_reset(
+    GBinderLocalReply* reply);
+
 GBinderLocalReply*
 gbinder_local_reply_append_int32(
     GBinderLocalReply* reply,
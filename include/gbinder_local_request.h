@@ -56,6 +56,44 @@ gbinder_local_request_cleanup(
     GDestroyNotify destroy,
     gpointer pointer);
 
+/*
+ * Drops the contents (and runs the cleanup functions) but keeps the
+ * RPC header and the allocated memory, so that the request can be
+ * filled again. Don't reset a request which is being transacted.
+ */
+void
+gbinder_local_request_reset(
+    GBinderLocalRequest* request);
+
+/*
+ * Templates. Any request can serve as a template for requests with the
+ * same contents, except for the int32/int64 values written into slots
+ * with gbinder_writer_append_int32/64_slot(). The template must not
+ * be modified while it has instances. Instances share slots with their
+ * template and are cheap to create once the template has been used.
+ */
+GBinderLocalRequest*
+gbinder_local_request_instantiate(
+    GBinderLocalRequest* tmpl);
+
+gboolean
+gbinder_local_request_patch_int32(
+    GBinderLocalRequest* request,
+    guint slot,
+    guint32 value);
+
+gboolean
+gbinder_local_request_patch_int64(
+    GBinderLocalRequest* request,
+    guint slot,
+    guint64 value);
+
+/* Size hint, appending size more bytes won't reallocate the buffer */
+GBinderLocalRequest*
+gbinder_local_request_reserve(
+    GBinderLocalRequest* request,
+    gsize size);
+
 GBinderLocalRequest*
 gbinder_local_request_append_int32(
     GBinderLocalRequest* request,
@@ -112,6 +112,31 @@ char**
 gbinder_reader_read_hidl_string_vec(
     GBinderReader* reader);
 
+/*
+ * HIDL vectors and structures are not copied, the returned pointers
+ * point to the received data and remain valid as long as the remote
+ * request or reply does. The buffers which hidl_string and hidl_vec
+ * fields point to are validated and skipped.
+ */
+gboolean
+gbinder_reader_read_hidl_vec(
+    GBinderReader* reader,
+    gsize elemsize,
+    gconstpointer* data,
+    gsize* count);
+
+gboolean
+gbinder_reader_read_hidl_struct_vec(
+    GBinderReader* reader,
+    const GBinderHidlType* type,
+    gconstpointer* data,
+    gsize* count);
+
+gconstpointer
+gbinder_reader_read_hidl_struct(
+    GBinderReader* reader,
+    const GBinderHidlType* type);
+
 gboolean
 gbinder_reader_skip_buffer(
     GBinderReader* reader);
@@ -125,6 +150,58 @@ gbinder_reader_read_string16(
     GBinderReader* reader)
     G_GNUC_WARN_UNUSED_RESULT;
 
+/* AIDL byte[], points to the received data. NULL array is NULL */
+gboolean
+gbinder_reader_read_byte_array(
+    GBinderReader* reader,
+    gconstpointer* data,
+    gsize* len);
+
+/*
+ * AIDL primitive arrays. The elements are copied to a newly allocated
+ * array which must be freed with g_free(). Null array is returned as
+ * NULL, empty one as non-NULL.
+ */
+gboolean
+gbinder_reader_read_int32_array(
+    GBinderReader* reader,
+    gint32** values,
+    gsize* count);
+
+gboolean
+gbinder_reader_read_int64_array(
+    GBinderReader* reader,
+    gint64** values,
+    gsize* count);
+
+gboolean
+gbinder_reader_read_float_array(
+    GBinderReader* reader,
+    gfloat** values,
+    gsize* count);
+
+gboolean
+gbinder_reader_read_double_array(
+    GBinderReader* reader,
+    gdouble** values,
+    gsize* count);
+
+gboolean
+gbinder_reader_read_bool_array(
+    GBinderReader* reader,
+    gboolean** values,
+    gsize* count);
+
+/*
+ * The result is NULL terminated, null strings are returned as NULL
+ * elements. Unless there are any, it can be freed with g_strfreev().
+ */
+gboolean
+gbinder_reader_read_string16_array(
+    GBinderReader* reader,
+    char*** strv,
+    gsize* count);
+
 gboolean
 gbinder_reader_read_nullable_string16(
     GBinderReader* reader,
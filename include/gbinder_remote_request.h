@@ -62,6 +62,28 @@ uid_t
 gbinder_remote_request_sender_euid(
     GBinderRemoteRequest* req);
 
+/*
+ * GBinderLocalTransactFunc may call gbinder_remote_request_block()
+ * to tell the caller that the reply isn't ready yet. The value returned
+ * by the callback is ignored in that case. The reply is sent when
+ * gbinder_remote_request_complete() gets called, which can happen on
+ * any thread. Meanwhile, another looper thread is serving the incoming
+ * transactions. Every blocked request must eventually be completed,
+ * unless GBinderIpc shuts down first and completes it with an error.
+ * Only two-way transactions can be blocked, blocking the one-way ones
+ * has no effect.
+ */
+
+void
+gbinder_remote_request_block(
+    GBinderRemoteRequest* req);
+
+void
+gbinder_remote_request_complete(
+    GBinderRemoteRequest* req,
+    GBinderLocalReply* reply,
+    int status);
+
 /* Convenience function to decode requests with just one data item */
 
 gboolean
@@ -80,6 +80,85 @@ gbinder_servicemanager_new_local_object(
     GBinderLocalTransactFunc handler,
     void* user_data);
 
+/*
+ * Main loop priority at which incoming transactions are handled,
+ * G_PRIORITY_DEFAULT_IDLE by default. Higher priority keeps busy
+ * main loop from delaying the incoming calls.
+ */
+void
+gbinder_servicemanager_set_incoming_priority(
+    GBinderServiceManager* sm,
+    int priority);
+
+/*
+ * With fair scheduling enabled, incoming transactions are queued per
+ * sender and handled round-robin. Per-sender statistics are collected
+ * while it's enabled. The array returned by gbinder_servicemanager_callers()
+ * must be deallocated with g_free.
+ */
+void
+gbinder_servicemanager_set_fair_incoming(
+    GBinderServiceManager* sm,
+    gboolean fair);
+
+GBinderCallerStats*
+gbinder_servicemanager_callers(
+    GBinderServiceManager* sm,
+    guint* count)
+    G_GNUC_WARN_UNUSED_RESULT;
+
+/*
+ * Max number of incoming transactions waiting for the main thread,
+ * 0 = no limit (see GBinderIncomingStats). When the limit is reached,
+ * two-way transactions are rejected with -EBUSY and one-way transactions
+ * are either dropped (if drop_oneway is TRUE) or make the looper wait
+ * for the main thread to catch up.
+ */
+void
+gbinder_servicemanager_set_max_pending_incoming(
+    GBinderServiceManager* sm,
+    guint max,
+    gboolean drop_oneway);
+
+gboolean
+gbinder_servicemanager_get_incoming_stats(
+    GBinderServiceManager* sm,
+    GBinderIncomingStats* stats);
+
+/*
+ * Max number of completed outgoing transactions whose callbacks are
+ * invoked per main loop iteration, 0 = no limit (the default is 64).
+ * The rest are delivered by the next iterations, so that a burst of
+ * completions doesn't starve other sources.
+ */
+void
+gbinder_servicemanager_set_tx_done_batch(
+    GBinderServiceManager* sm,
+    guint max);
+
+/*
+ * Sets scheduling parameters (see GBinderThreadParams) for the threads
+ * of the given kind. Only non-zero parameters are applied, the rest is
+ * left as is. NULL params restore the defaults, i.e. SCHED_OTHER, nice 0
+ * and all CPUs (but not the thread names).
+ */
+void
+gbinder_servicemanager_set_thread_params(
+    GBinderServiceManager* sm,
+    GBINDER_THREADS threads,
+    const GBinderThreadParams* params);
+
+/*
+ * Spawns the binder threads and allocates the internal tables upfront
+ * so that the first transactions don't pay for it. Must be invoked on
+ * the main thread, stats (optional) receive the time spent by each step.
+ */
+gboolean
+gbinder_servicemanager_prewarm(
+    GBinderServiceManager* sm,
+    guint threads,
+    GBinderPrewarmStats* stats);
+
 GBinderServiceManager*
 gbinder_servicemanager_ref(
     GBinderServiceManager* sm);
@@ -92,7 +92,138 @@ GBinderLocalReply*
     int* status,
     void* user_data);
 
+/*
+ * GBINDER_TX_FLAG_HIGH_PRIORITY only affects asynchronous transactions
+ * on the sending side. Such transactions are executed by a separate set
+ * of worker threads and never get queued behind the normal ones (e.g.
+ * service manager queries). It's not passed to the remote side.
+ *
+ * GBINDER_TX_FLAG_DIRECT_REPLY makes asynchronous transactions invoke
+ * the reply callback directly on the worker thread which has executed
+ * the transaction, rather than on the main thread. Destroy callback is
+ * still invoked on the main thread. Cancelling such a transaction after
+ * the reply callback has been invoked (or while it's running) has no
+ * effect other than making the transaction id invalid.
+ */
 #define GBINDER_TX_FLAG_ONEWAY (0x01)
+#define GBINDER_TX_FLAG_HIGH_PRIORITY (0x02)
+#define GBINDER_TX_FLAG_DIRECT_REPLY (0x04)
+
+/*
+ * Incoming transactions which have been received by the looper thread
+ * but not yet handled by the main thread are counted as pending. When
+ * the limit is reached, two-way transactions are rejected with -EBUSY
+ * and one-way transactions are either dropped or make the looper wait
+ * for the main thread to catch up.
+ */
+typedef struct gbinder_incoming_stats {
+    guint pending;   /* Currently pending */
+    guint peak;      /* The highest number ever pending */
+    guint rejected;  /* Two-way transactions rejected with -EBUSY */
+    guint dropped;   /* One-way transactions dropped */
+} GBinderIncomingStats;
+
+/*
+ * Incoming transactions per sender, see gbinder_servicemanager_callers()
+ * The kernel doesn't report the sender pid for one-way transactions, so
+ * those are accounted per euid with zero pid.
+ */
+typedef struct gbinder_caller_stats {
+    pid_t pid;       /* Zero for one-way transactions */
+    uid_t euid;
+    guint pending;   /* Waiting to be handled */
+    guint handled;   /* Handled so far */
+    gint64 busy;     /* Microseconds spent in the handlers */
+} GBinderCallerStats;
+
+/* Time (in microseconds) spent by each step of the prewarm */
+typedef struct gbinder_prewarm_stats {
+    gint64 looper;   /* Starting the looper thread */
+    gint64 threads;  /* Starting the transaction threads */
+    gint64 tables;   /* Allocating object and transaction tables */
+    gint64 total;
+} GBinderPrewarmStats;
+
+/*
+ * Scheduling parameters for the binder threads. Only the non-zero
+ * parameters are applied. CPU affinity, nice level and SCHED_FIFO
+ * priority may require privileges, failures are logged and otherwise
+ * ignored. Nice level is ignored if SCHED_FIFO priority is set.
+ */
+typedef enum gbinder_threads {
+    GBINDER_THREADS_LOOPER,  /* Looper thread(s) */
+    GBINDER_THREADS_POOL     /* Threads executing outgoing transactions */
+} GBINDER_THREADS;
+
+typedef struct gbinder_thread_params {
+    const char* name;        /* Thread name (max 15 characters) */
+    guint64 cpu_mask;        /* Allowed CPUs (0..63) */
+    int nice;                /* Nice level */
+    int fifo_priority;       /* SCHED_FIFO priority */
+} GBinderThreadParams;
+
+/*
+ * HIDL containers, laid out the way they are passed over hwbinder.
+ * Pointers are 64-bit regardless of the architecture.
+ */
+typedef struct gbinder_hidl_vec {
+    union {
+        guint64 value;
+        const void* ptr;
+    } data;
+    guint32 count;
+    guint32 owns_buffer;
+} GBinderHidlVec;
+
+#define GBINDER_HIDL_VEC_BUFFER_OFFSET (0)
+
+typedef struct gbinder_hidl_string {
+    union {
+        guint64 value;
+        const char* str;
+    } data;
+    guint32 len;
+    guint32 owns_buffer;
+} GBinderHidlString;
+
+#define GBINDER_HIDL_STRING_BUFFER_OFFSET (0)
+
+/*
+ * Describes where a structure keeps its hidl_string and hidl_vec fields
+ * (directly or in embedded structures), so that the writer and the
+ * reader can follow the pointers. Plain data fields need no description.
+ * The list of fields is terminated by GBINDER_HIDL_FIELD_END(), NULL
+ * list means that the structure contains no pointers.
+ */
+typedef struct gbinder_hidl_type GBinderHidlType;
+
+typedef enum gbinder_hidl_field_kind {
+    GBINDER_HIDL_FIELD_KIND_END,
+    GBINDER_HIDL_FIELD_KIND_STRING,  /* GBinderHidlString */
+    GBINDER_HIDL_FIELD_KIND_VEC,     /* GBinderHidlVec of elements of type */
+    GBINDER_HIDL_FIELD_KIND_STRUCT   /* Structure of type embedded by value */
+} GBINDER_HIDL_FIELD_KIND;
+
+typedef struct gbinder_hidl_field {
+    GBINDER_HIDL_FIELD_KIND kind;
+    gsize offset;
+    const GBinderHidlType* type;
+} GBinderHidlField;
+
+struct gbinder_hidl_type {
+    const char* name;
+    gsize size;
+    const GBinderHidlField* fields;
+};
+
+#define GBINDER_HIDL_FIELD_STRING(s,f) \
+    { GBINDER_HIDL_FIELD_KIND_STRING, G_STRUCT_OFFSET(s,f), NULL }
+#define GBINDER_HIDL_FIELD_VEC(s,f,t) \
+    { GBINDER_HIDL_FIELD_KIND_VEC, G_STRUCT_OFFSET(s,f), t }
+#define GBINDER_HIDL_FIELD_STRUCT(s,f,t) \
+    { GBINDER_HIDL_FIELD_KIND_STRUCT, G_STRUCT_OFFSET(s,f), t }
+#define GBINDER_HIDL_FIELD_END() \
+    { GBINDER_HIDL_FIELD_KIND_END, 0, NULL }
 
 typedef enum gbinder_status {
     GBINDER_STATUS_OK = 0,
@@ -55,6 +55,40 @@ struct gbinder_parent {
     guint32 offset;
 };
 
+/*
+ * Size hint. Makes sure that appending the specified number of bytes
+ * won't reallocate the buffer.
+ */
+void
+gbinder_writer_reserve(
+    GBinderWriter* writer,
+    gsize size);
+
+/*
+ * Two-pass writing. The fill function is first invoked with a scratch
+ * writer to measure the data, then the space is allocated in one go
+ * and the function is invoked again with the actual writer.
+ *
+ * The function is therefore called twice and must be deterministic,
+ * i.e. write the same thing both times, and must not have side effects
+ * of its own. Values returned by the writer (object indices, slots) are
+ * only meaningful during the second pass. Destroy callbacks passed in
+ * by the first pass are ignored, memory allocated by the scratch writer
+ * is released before the second pass. If the second pass writes more
+ * than the first one did, the data simply grow as usual.
+ */
+typedef
+void
+(*GBinderWriterFillFunc)(
+    GBinderWriter* writer,
+    void* user_data);
+
+void
+gbinder_writer_append_measured(
+    GBinderWriter* writer,
+    GBinderWriterFillFunc fill,
+    void* user_data);
+
 void
 gbinder_writer_append_int32(
     GBinderWriter* writer,
@@ -65,6 +99,20 @@ gbinder_writer_append_int64(
     GBinderWriter* writer,
     guint64 value);
 
+/*
+ * Same as gbinder_writer_append_int32/64 but also return the slot
+ * index which can be passed to gbinder_local_request_patch_int32/64
+ */
+guint
+gbinder_writer_append_int32_slot(
+    GBinderWriter* writer,
+    guint32 value);
+
+guint
+gbinder_writer_append_int64_slot(
+    GBinderWriter* writer,
+    guint64 value);
+
 void
 gbinder_writer_append_string16(
     GBinderWriter* writer,
@@ -122,6 +170,95 @@ gbinder_writer_append_hidl_string_vec(
     const char* data[],
     gssize count);
 
+/*
+ * The following functions don't copy the data, only the descriptors.
+ * The memory (including everything the hidl_string and hidl_vec fields
+ * point to) must stay valid until the transaction has been completed.
+ */
+void
+gbinder_writer_append_hidl_vec(
+    GBinderWriter* writer,
+    const void* base,
+    guint count,
+    guint elemsize);
+
+void
+gbinder_writer_append_hidl_struct_vec(
+    GBinderWriter* writer,
+    const void* base,
+    guint count,
+    const GBinderHidlType* type);
+
+void
+gbinder_writer_append_hidl_struct(
+    GBinderWriter* writer,
+    const void* ptr,
+    const GBinderHidlType* type);
+
+/*
+ * Appends hidl_vec<uint8_t> pointing to the caller's memory, which the
+ * kernel copies directly to the receiver. The destroy callback is
+ * invoked (possibly on a worker thread) as soon as the data have been
+ * written to the driver, or when the request/reply is deallocated or
+ * reset without being sent. The request must not be sent again after
+ * that.
+ */
+void
+gbinder_writer_append_hidl_byte_vec(
+    GBinderWriter* writer,
+    const void* bytes,
+    gsize size,
+    GDestroyNotify destroy,
+    gpointer user_data);
+
+/* AIDL byte[], negative length (or NULL) writes a null array */
+void
+gbinder_writer_append_byte_array(
+    GBinderWriter* writer,
+    const void* bytes,
+    gssize len);
+
+/*
+ * AIDL primitive arrays. Negative count (or NULL values with non-zero
+ * count) writes a null array. NULL elements of a string array are
+ * written as null strings.
+ */
+void
+gbinder_writer_append_int32_array(
+    GBinderWriter* writer,
+    const gint32* values,
+    gssize count);
+
+void
+gbinder_writer_append_int64_array(
+    GBinderWriter* writer,
+    const gint64* values,
+    gssize count);
+
+void
+gbinder_writer_append_float_array(
+    GBinderWriter* writer,
+    const gfloat* values,
+    gssize count);
+
+void
+gbinder_writer_append_double_array(
+    GBinderWriter* writer,
+    const gdouble* values,
+    gssize count);
+
+void
+gbinder_writer_append_bool_array(
+    GBinderWriter* writer,
+    const gboolean* values,
+    gssize count);
+
+void
+gbinder_writer_append_string16_array(
+    GBinderWriter* writer,
+    const char* const* strv,
+    gssize count);
+
 void
 gbinder_writer_append_local_object(
     GBinderWriter* writer,
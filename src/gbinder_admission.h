@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GBINDER_ADMISSION_H
+#define GBINDER_ADMISSION_H
+
+#include "gbinder_types_p.h"
+#include "gbinder_log.h"
+
+/*
+ * Counts incoming transactions which have been accepted by the looper
+ * but not yet handled by the main thread. The counters are updated
+ * by both threads, hence atomics. Zero limit means no limit.
+ */
+struct gbinder_admission {
+    gint limit;
+    gint pending;
+    gint peak;
+    gint rejected;
+    gint dropped;
+};
+
+GBINDER_INLINE_FUNC
+gboolean
+gbinder_admission_enter(
+    GBinderAdmission* self,
+    gboolean force)
+{
+    const int limit = g_atomic_int_get(&self->limit);
+    int n, peak;
+
+    /* Rejected attempts don't even temporarily bump the counter */
+    do {
+        n = g_atomic_int_get(&self->pending) + 1;
+        if (limit > 0 && n > limit && !force) {
+            return FALSE;
+        }
+    } while (!g_atomic_int_compare_and_exchange(&self->pending, n - 1, n));
+    while ((peak = g_atomic_int_get(&self->peak)) < n &&
+        !g_atomic_int_compare_and_exchange(&self->peak, peak, n));
+    return TRUE;
+}
+
+GBINDER_INLINE_FUNC
+void
+gbinder_admission_leave(
+    GBinderAdmission* self)
+{
+    GASSERT(self->pending > 0);
+    g_atomic_int_add(&self->pending, -1);
+}
+
+GBINDER_INLINE_FUNC
+void
+gbinder_admission_set_limit(
+    GBinderAdmission* self,
+    guint max)
+{
+    g_atomic_int_set(&self->limit, MIN(max, G_MAXINT));
+}
+
+GBINDER_INLINE_FUNC
+void
+gbinder_admission_get_stats(
+    GBinderAdmission* self,
+    GBinderIncomingStats* stats)
+{
+    stats->pending = g_atomic_int_get(&self->pending);
+    stats->peak = g_atomic_int_get(&self->peak);
+    stats->rejected = g_atomic_int_get(&self->rejected);
+    stats->dropped = g_atomic_int_get(&self->dropped);
+}
+
+#define gbinder_admission_reject(self) g_atomic_int_inc(&(self)->rejected)
+#define gbinder_admission_drop(self) g_atomic_int_inc(&(self)->dropped)
+
+#endif /* GBINDER_ADMISSION_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
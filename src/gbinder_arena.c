@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gbinder_arena.h"
+
+#include <gutil_macros.h>
+
+/*
+ * The arena is a list of chunks, the most recently allocated one
+ * first. Each chunk is twice as large as the previous one (blocks
+ * larger than that get a chunk of their own).
+ */
+struct gbinder_arena {
+    GBinderArena* next;
+    gsize size;
+    gsize used;
+};
+
+/* Data follow the header, 8-byte aligned */
+#define GBINDER_ARENA_HEADER_SIZE G_ALIGN8(sizeof(GBinderArena))
+#define GBINDER_ARENA_MIN_CHUNK (256)
+#define GBINDER_ARENA_MAX_CHUNK (16 * 1024)
+
+gpointer
+gbinder_arena_alloc0(
+    GBinderArena** arena,
+    gsize size)
+{
+    GBinderArena* chunk = *arena;
+    gpointer ptr;
+
+    size = G_ALIGN8(size);
+    if (!chunk || (chunk->size - chunk->used) < size) {
+        gsize chunk_size = chunk ?
+            MIN(chunk->size * 2, GBINDER_ARENA_MAX_CHUNK) :
+            GBINDER_ARENA_MIN_CHUNK;
+
+        chunk_size = MAX(chunk_size, size);
+        chunk = g_malloc(GBINDER_ARENA_HEADER_SIZE + chunk_size);
+        chunk->next = *arena;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        *arena = chunk;
+    }
+    ptr = ((guint8*)chunk) + GBINDER_ARENA_HEADER_SIZE + chunk->used;
+    chunk->used += size;
+    return memset(ptr, 0, size);
+}
+
+void
+gbinder_arena_reset(
+    GBinderArena** arena)
+{
+    GBinderArena* chunk = *arena;
+
+    if (chunk) {
+        if (chunk->size > GBINDER_ARENA_MAX_CHUNK) {
+            /* Don't hold on to oversized blocks */
+            gbinder_arena_free(chunk);
+            *arena = NULL;
+        } else {
+            gbinder_arena_free(chunk->next);
+            chunk->next = NULL;
+            chunk->used = 0;
+        }
+    }
+}
+
+void
+gbinder_arena_free(
+    GBinderArena* arena)
+{
+    while (arena) {
+        GBinderArena* next = arena->next;
+
+        g_free(arena);
+        arena = next;
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
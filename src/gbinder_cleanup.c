@@ -69,6 +69,20 @@ gbinder_cleanup_free(
     }
 }
 
+void
+gbinder_cleanup_reset(
+    GBinderCleanup* self)
+{
+    if (G_LIKELY(self)) {
+        guint i;
+
+        for (i = 0; i < self->count; i++) {
+            self->items[i].destroy(self->items[i].pointer);
+        }
+        g_array_set_size((GArray*)self, 0);
+    }
+}
+
 GBinderCleanup*
 gbinder_cleanup_add(
     GBinderCleanup* self,
@@ -39,6 +39,10 @@ void
 gbinder_cleanup_free(
     GBinderCleanup* cleanup);
 
+void
+gbinder_cleanup_reset(
+    GBinderCleanup* cleanup);
+
 GBinderCleanup*
 gbinder_cleanup_add(
     GBinderCleanup* cleanup,
@@ -34,6 +34,7 @@
 #include "gbinder_driver.h"
 #include "gbinder_ipc.h"
 #include "gbinder_output_data.h"
+#include "gbinder_pool.h"
 #include "gbinder_remote_object_p.h"
 #include "gbinder_local_reply_p.h"
 #include "gbinder_local_request_p.h"
@@ -43,12 +44,27 @@
 
 #include <errno.h>
 
+/*
+ * Typical request size per transaction code, used for presizing the
+ * requests created by gbinder_client_new_request2(). The table is
+ * direct-mapped and updated without locking, races (and collisions)
+ * can only make the hint less accurate.
+ */
+typedef struct gbinder_client_size_hint {
+    gint code;
+    gint size;
+} GBinderClientSizeHint;
+
+#define GBINDER_CLIENT_SIZE_HINTS (16)
+
 typedef struct gbinder_client_priv {
     GBinderClient pub;
     guint32 refcount;
     char* iface;
     GBytes* rpc_header;
     GBinderLocalRequest* basic_req;
+    GBinderPool* request_pool;
+    GBinderClientSizeHint size_hints[GBINDER_CLIENT_SIZE_HINTS];
 } GBinderClientPriv;
 
 typedef struct gbinder_client_tx {
@@ -74,11 +90,51 @@ gbinder_client_free(
 
     gbinder_remote_object_unref(self->remote);
     gbinder_local_request_unref(priv->basic_req);
+    gbinder_pool_unref(priv->request_pool);
     g_free(priv->iface);
     g_bytes_unref(priv->rpc_header);
     g_slice_free(GBinderClientPriv, priv);
 }
 
+static
+void
+gbinder_client_learn_size(
+    GBinderClientPriv* priv,
+    guint32 code,
+    GBinderLocalRequest* req)
+{
+    GBinderClientSizeHint* hint = priv->size_hints +
+        (code % GBINDER_CLIENT_SIZE_HINTS);
+    const gint size = gbinder_local_request_data(req)->bytes->len;
+
+    if (g_atomic_int_get(&hint->code) == (gint)code) {
+        const gint prev = g_atomic_int_get(&hint->size);
+
+        /* Grow right away, shrink slowly */
+        if (size < prev) {
+            g_atomic_int_set(&hint->size, prev - (prev - size) / 8);
+        } else if (size > prev) {
+            g_atomic_int_set(&hint->size, size);
+        }
+    } else {
+        g_atomic_int_set(&hint->code, code);
+        g_atomic_int_set(&hint->size, size);
+    }
+}
+
+static
+gsize
+gbinder_client_size_hint(
+    GBinderClientPriv* priv,
+    guint32 code)
+{
+    GBinderClientSizeHint* hint = priv->size_hints +
+        (code % GBINDER_CLIENT_SIZE_HINTS);
+
+    return (g_atomic_int_get(&hint->code) == (gint)code) ?
+        g_atomic_int_get(&hint->size) : 0;
+}
+
 static
 void
 gbinder_client_transact_reply(
@@ -134,6 +190,7 @@ gbinder_client_new(
         priv->basic_req = gbinder_driver_local_request_new(ipc->driver, iface);
         hdr = gbinder_local_request_data(priv->basic_req);
         priv->rpc_header = g_bytes_new(hdr->bytes->data, hdr->bytes->len);
+        priv->request_pool = gbinder_local_request_pool_new();
 
         self->remote = gbinder_remote_object_ref(remote);
         self->iface = priv->iface = g_strdup(iface);
@@ -176,7 +233,40 @@ gbinder_client_new_request(
     if (G_LIKELY(self)) {
         GBinderClientPriv* priv = gbinder_client_cast(self);
         const GBinderIo* io = gbinder_driver_io(self->remote->ipc->driver);
-        return gbinder_local_request_new(io, priv->rpc_header);
+
+        return gbinder_local_request_new_pooled(priv->request_pool, io,
+            priv->rpc_header, 0);
+    }
+    return NULL;
+}
+
+GBinderLocalRequest*
+gbinder_client_new_request2(
+    GBinderClient* self,
+    guint32 code)
+{
+    if (G_LIKELY(self)) {
+        GBinderClientPriv* priv = gbinder_client_cast(self);
+        const GBinderIo* io = gbinder_driver_io(self->remote->ipc->driver);
+
+        return gbinder_local_request_new_pooled(priv->request_pool, io,
+            priv->rpc_header, gbinder_client_size_hint(priv, code));
+    }
+    return NULL;
+}
+
+GBinderLocalRequest*
+gbinder_client_init_request(
+    GBinderClient* self,
+    void* buf,
+    gsize size)
+{
+    if (G_LIKELY(self)) {
+        GBinderClientPriv* priv = gbinder_client_cast(self);
+        const GBinderIo* io = gbinder_driver_io(self->remote->ipc->driver);
+
+        return gbinder_local_request_new_in_buf(io, priv->rpc_header,
+            buf, size);
     }
     return NULL;
 }
@@ -194,6 +284,8 @@ gbinder_client_transact_sync_reply(
         if (!req) {
             /* Default empty request (just the header, no parameters) */
             req = gbinder_client_cast(self)->basic_req;
+        } else {
+            gbinder_client_learn_size(gbinder_client_cast(self), code, req);
         }
         return gbinder_ipc_transact_sync_reply(obj->ipc, obj->handle,
             code, req, status);
@@ -213,6 +305,8 @@ gbinder_client_transact_sync_oneway(
         if (!req) {
             /* Default empty request (just the header, no parameters) */
             req = gbinder_client_cast(self)->basic_req;
+        } else {
+            gbinder_client_learn_size(gbinder_client_cast(self), code, req);
         }
         return gbinder_ipc_transact_sync_oneway(obj->ipc, obj->handle,
             code, req);
@@ -231,7 +325,10 @@ gbinder_client_transact(
     GDestroyNotify destroy,
     void* user_data)
 {
-    if (G_LIKELY(self)) {
+    if (G_UNLIKELY(gbinder_local_request_in_buf(req))) {
+        GWARN("Request from caller storage can only be sent synchronously");
+        return 0;
+    } else if (G_LIKELY(self)) {
         GBinderRemoteObject* obj = self->remote;
         GBinderClientTx* tx = g_slice_new0(GBinderClientTx);
 
@@ -243,6 +340,8 @@ gbinder_client_transact(
         if (!req) {
             /* Default empty request (just the header, no parameters) */
             req = gbinder_client_cast(self)->basic_req;
+        } else {
+            gbinder_client_learn_size(gbinder_client_cast(self), code, req);
         }
 
         return gbinder_ipc_transact(obj->ipc, obj->handle, code, flags, req,
@@ -411,6 +411,9 @@ gbinder_driver_reply_data(
     write.size = len;
     write.consumed = 0;
     status = gbinder_driver_write(self, &write) >= 0;
+    if (status) {
+        gbinder_output_data_consumed(data);
+    }
 
     g_free(offsets_buf);
     return status >= 0;
@@ -434,7 +437,7 @@ gbinder_driver_handle_transaction(
     self->io->decode_transaction_data(data, &tx);
     gbinder_driver_verbose_transaction_data("BR_TRANSACTION", &tx);
     req = gbinder_remote_request_new(reg, self->protocol, tx.pid, tx.euid);
-    obj = gbinder_object_registry_get_local(reg, tx.target);
+    obj = gbinder_object_registry_get_local(reg, tx.target, tx.cookie);
 
     /* Transfer data ownership to the request */
     if (tx.data && tx.size) {
@@ -478,6 +481,19 @@ gbinder_driver_handle_transaction(
     gbinder_local_object_unref(obj);
 }
 
+static
+GBinderLocalObject*
+gbinder_driver_local_object(
+    GBinderDriver* self,
+    GBinderObjectRegistry* reg,
+    const void* data)
+{
+    guint64 cookie = 0;
+    void* ptr = self->io->decode_binder_ptr_cookie(data, &cookie);
+
+    return gbinder_object_registry_get_local(reg, ptr, cookie);
+}
+
 static
 void
 gbinder_driver_handle_command(
@@ -501,8 +517,8 @@ gbinder_driver_handle_command(
         GVERBOSE("> BR_FINISHED");
     } else if (cmd == io->br.increfs) {
         guint8 buf[4 + GBINDER_MAX_PTR_COOKIE_SIZE];
-        GBinderLocalObject* obj = gbinder_object_registry_get_local
-            (reg, io->decode_binder_ptr_cookie(data));
+        GBinderLocalObject* obj =
+            gbinder_driver_local_object(self, reg, data);
 
         GVERBOSE("> BR_INCREFS %p", obj);
         gbinder_local_object_handle_increfs(obj);
@@ -510,16 +526,16 @@ gbinder_driver_handle_command(
         GVERBOSE("< BC_INCREFS_DONE %p", obj);
         gbinder_driver_cmd_data(self, io->bc.increfs_done, data, buf);
     } else if (cmd == io->br.decrefs) {
-        GBinderLocalObject* obj = gbinder_object_registry_get_local
-            (reg, io->decode_binder_ptr_cookie(data));
+        GBinderLocalObject* obj =
+            gbinder_driver_local_object(self, reg, data);
 
         GVERBOSE("> BR_DECREFS %p", obj);
         gbinder_local_object_handle_decrefs(obj);
         gbinder_local_object_unref(obj);
     } else if (cmd == io->br.acquire) {
         guint8 buf[4 + GBINDER_MAX_PTR_COOKIE_SIZE];
-        GBinderLocalObject* obj = gbinder_object_registry_get_local
-            (reg, io->decode_binder_ptr_cookie(data));
+        GBinderLocalObject* obj =
+            gbinder_driver_local_object(self, reg, data);
 
         GVERBOSE("> BR_ACQUIRE %p", obj);
         gbinder_local_object_handle_acquire(obj);
@@ -527,8 +543,8 @@ gbinder_driver_handle_command(
         GVERBOSE("< BC_ACQUIRE_DONE %p", obj);
         gbinder_driver_cmd_data(self, io->bc.acquire_done, data, buf);
     } else if (cmd == io->br.release) {
-        GBinderLocalObject* obj = gbinder_object_registry_get_local
-            (reg, io->decode_binder_ptr_cookie(data));
+        GBinderLocalObject* obj =
+            gbinder_driver_local_object(self, reg, data);
 
         GVERBOSE("> BR_RELEASE %p", obj);
         gbinder_local_object_handle_release(obj);
@@ -948,6 +964,11 @@ gbinder_driver_transact(
     guint len = sizeof(*cmd);
     int txstatus = (-EAGAIN);
 
+    if (gbinder_output_data_spent(data)) {
+        GWARN("Request buffers have been released by the previous call");
+        return (-EINVAL);
+    }
+
     gbinder_driver_read_init(&rb);
 
     /* Build BC_TRANSACTION */
@@ -986,6 +1007,10 @@ gbinder_driver_transact(
         if (err < 0) {
             txstatus = err;
         } else {
+            if (write.consumed == write.size) {
+                /* The kernel has copied everything it needed */
+                gbinder_output_data_consumed(data);
+            }
             txstatus = gbinder_driver_txstatus(self, reg, NULL, &rb, reply);
         }
     }
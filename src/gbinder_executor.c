@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* sched_getcpu */
+#endif
+
+#include "gbinder_executor.h"
+#include "gbinder_sched.h"
+#include "gbinder_log.h"
+
+#include <sched.h>
+
+/*
+ * The executor has a queue per CPU (up to GBINDER_EXECUTOR_MAX_QUEUES).
+ * The work is queued to the queue of the CPU the caller is running on,
+ * and each worker thread has a home queue. When home queue is empty,
+ * the worker steals the work from other queues. Idle workers sleep on
+ * a single condition.
+ *
+ * Since the work is blocking, a new thread is started whenever there's
+ * more work queued than there are idle threads (up to max_threads).
+ * Workers also keep track of how long the work has been waiting in the
+ * queue. If it takes too long, they start an extra thread to make sure
+ * that the next piece of work won't have to wait. Idle threads exit
+ * when they stay idle for a while and the measured wait time is low,
+ * but the number of threads never drops below min_threads.
+ */
+
+#define GBINDER_EXECUTOR_MAX_QUEUES (8)
+#define GBINDER_EXECUTOR_STEAL_INTERVAL (8)
+#define GBINDER_EXECUTOR_IDLE_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+#define GBINDER_EXECUTOR_WAIT_THRESHOLD (G_TIME_SPAN_MILLISECOND)
+
+typedef struct gbinder_executor_queue {
+    GMutex mutex;
+    GBinderExecutorWork* first;
+    GBinderExecutorWork* last;
+} GBinderExecutorQueue;
+
+typedef struct gbinder_executor_thread {
+    GBinderExecutor* executor;
+    GThread* thread;
+    guint home;
+    gint sched_gen;
+} GBinderExecutorThread;
+
+struct gbinder_executor {
+    char* name;
+    GBinderExecutorFunc func;
+    void* user_data;
+    GBinderExecutorQueue* queues;
+    guint nqueues;
+    gint queued;
+    gint wait_avg;
+    gint next_queue;
+    GMutex mutex;
+    GCond cond;
+    GCond exit_cond;
+    GBinderSchedSlot sched;
+    GSList* threads;
+    GSList* zombies;
+    guint nthreads;
+    guint idle;
+    guint min_threads;
+    guint max_threads;
+    guint next_home;
+    gboolean stopped;
+    gboolean orphan;
+};
+
+static GPrivate gbinder_executor_current_thread;
+
+/*==========================================================================*
+ * Implementation
+ *==========================================================================*/
+
+static
+guint
+gbinder_executor_queue_index(
+    GBinderExecutor* self)
+{
+    const GBinderExecutorThread* thread =
+        g_private_get(&gbinder_executor_current_thread);
+
+    if (thread && thread->executor == self) {
+        /* The work is coming from our own worker thread */
+        return thread->home;
+    } else {
+        int cpu = sched_getcpu();
+
+        if (cpu < 0) {
+            cpu = g_atomic_int_add(&self->next_queue, 1);
+        }
+        return ((guint)cpu) % self->nqueues;
+    }
+}
+
+static
+void
+gbinder_executor_queue_unlink(
+    GBinderExecutorQueue* queue,
+    GBinderExecutorWork* work)
+{
+    if (work->prev) {
+        work->prev->next = work->next;
+    } else {
+        g_atomic_pointer_set(&queue->first, work->next);
+    }
+    if (work->next) {
+        work->next->prev = work->prev;
+    } else {
+        queue->last = work->prev;
+    }
+    work->next = work->prev = NULL;
+    g_atomic_pointer_set(&work->queue, NULL);
+}
+
+static
+GBinderExecutorWork*
+gbinder_executor_take(
+    GBinderExecutor* self,
+    guint start)
+{
+    guint i;
+
+    for (i = 0; i < self->nqueues; i++) {
+        GBinderExecutorQueue* queue = self->queues +
+            ((start + i) % self->nqueues);
+
+        /* Don't even lock the queue if it looks empty */
+        if (g_atomic_pointer_get(&queue->first)) {
+            GBinderExecutorWork* work;
+
+            /* Lock */
+            g_mutex_lock(&queue->mutex);
+            work = queue->first;
+            if (work) {
+                gbinder_executor_queue_unlink(queue, work);
+            }
+            g_mutex_unlock(&queue->mutex);
+            /* Unlock */
+
+            if (work) {
+                g_atomic_int_add(&self->queued, -1);
+                return work;
+            }
+        }
+    }
+    return NULL;
+}
+
+static
+void
+gbinder_executor_reap_locked(
+    GBinderExecutor* self)
+{
+    while (self->zombies) {
+        GSList* link = self->zombies;
+        GBinderExecutorThread* thread = link->data;
+
+        self->zombies = g_slist_delete_link(self->zombies, link);
+        g_thread_join(thread->thread);
+        g_slice_free(GBinderExecutorThread, thread);
+    }
+}
+
+static
+gpointer
+gbinder_executor_thread_proc(
+    gpointer data);
+
+static
+gboolean
+gbinder_executor_spawn_locked(
+    GBinderExecutor* self)
+{
+    GError* error = NULL;
+    GBinderExecutorThread* thread = g_slice_new0(GBinderExecutorThread);
+
+    gbinder_executor_reap_locked(self);
+    thread->executor = self;
+    thread->home = (self->next_home++) % self->nqueues;
+    thread->thread = g_thread_try_new(self->name,
+        gbinder_executor_thread_proc, thread, &error);
+    if (thread->thread) {
+        self->threads = g_slist_prepend(self->threads, thread);
+        self->nthreads++;
+        GVERBOSE_("%s %u", self->name, self->nthreads);
+        return TRUE;
+    } else {
+        GERR("Failed to create %s thread: %s", self->name, GERRMSG(error));
+        g_error_free(error);
+        g_slice_free(GBinderExecutorThread, thread);
+        return FALSE;
+    }
+}
+
+static
+void
+gbinder_executor_run(
+    GBinderExecutor* self,
+    GBinderExecutorWork* work)
+{
+    const gint64 wait = MIN(g_get_monotonic_time() - work->queued, G_MAXINT);
+    const gint avg = g_atomic_int_get(&self->wait_avg);
+
+    /* Moving average, lost updates don't really matter */
+    g_atomic_int_set(&self->wait_avg, avg + (gint)((wait - avg) / 8));
+    if (wait > GBINDER_EXECUTOR_WAIT_THRESHOLD) {
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        if (!self->idle && !self->stopped &&
+            self->nthreads < self->max_threads) {
+            /* Add some headroom, the next one may not have to wait */
+            gbinder_executor_spawn_locked(self);
+        }
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+    self->func(work, self->user_data);
+}
+
+/* Returns TRUE if the calling thread is done and should exit */
+static
+gboolean
+gbinder_executor_wait(
+    GBinderExecutor* self,
+    GBinderExecutorThread* thread,
+    gboolean* last)
+{
+    gboolean done = FALSE;
+
+    /* Lock */
+    g_mutex_lock(&self->mutex);
+    while (!g_atomic_int_get(&self->queued) && !done) {
+        if (self->stopped) {
+            done = TRUE;
+        } else {
+            const gint64 deadline = g_get_monotonic_time() +
+                GBINDER_EXECUTOR_IDLE_TIMEOUT;
+            gboolean timed_out;
+
+            self->idle++;
+            timed_out = !g_cond_wait_until(&self->cond, &self->mutex,
+                deadline);
+            self->idle--;
+            if (timed_out && !g_atomic_int_get(&self->queued)) {
+                const gint avg = g_atomic_int_get(&self->wait_avg) / 2;
+
+                /* Cool down the statistics while nothing is happening */
+                g_atomic_int_set(&self->wait_avg, avg);
+                if (self->nthreads > self->min_threads &&
+                    avg < GBINDER_EXECUTOR_WAIT_THRESHOLD) {
+                    GVERBOSE_("%s %u", self->name, self->nthreads - 1);
+                    done = TRUE;
+                }
+            }
+        }
+    }
+    if (done) {
+        self->threads = g_slist_remove(self->threads, thread);
+        self->nthreads--;
+        if (self->orphan && !self->nthreads) {
+            /* The last one turns off the lights */
+            *last = TRUE;
+        } else {
+            /* Will be joined by someone else */
+            self->zombies = g_slist_prepend(self->zombies, thread);
+        }
+        g_cond_broadcast(&self->exit_cond);
+    }
+    g_mutex_unlock(&self->mutex);
+    /* Unlock */
+    return done;
+}
+
+static
+void
+gbinder_executor_destroy(
+    GBinderExecutor* self)
+{
+    guint i;
+
+    for (i = 0; i < self->nqueues; i++) {
+        GASSERT(!self->queues[i].first);
+        g_mutex_clear(&self->queues[i].mutex);
+    }
+    g_free(self->queues);
+    g_mutex_clear(&self->mutex);
+    g_cond_clear(&self->cond);
+    g_cond_clear(&self->exit_cond);
+    gbinder_sched_slot_clear(&self->sched);
+    g_free(self->name);
+    g_slice_free(GBinderExecutor, self);
+}
+
+static
+gpointer
+gbinder_executor_thread_proc(
+    gpointer data)
+{
+    GBinderExecutorThread* thread = data;
+    GBinderExecutor* self = thread->executor;
+    guint start = thread->home;
+    guint count = 0;
+    gboolean last = FALSE;
+
+    g_private_set(&gbinder_executor_current_thread, thread);
+    do {
+        GBinderExecutorWork* work;
+
+        gbinder_sched_slot_apply(&self->sched, &thread->sched_gen);
+        work = gbinder_executor_take(self, start);
+
+        if (work) {
+            /* Periodically look elsewhere first to avoid starvation */
+            if (!((++count) % GBINDER_EXECUTOR_STEAL_INTERVAL)) {
+                start = (start + 1) % self->nqueues;
+            } else {
+                start = thread->home;
+            }
+            gbinder_executor_run(self, work);
+        }
+    } while (!gbinder_executor_wait(self, thread, &last));
+    g_private_set(&gbinder_executor_current_thread, NULL);
+
+    if (last) {
+        /* gbinder_executor_free() has been called by one of the workers */
+        gbinder_executor_reap_locked(self);
+        g_thread_unref(thread->thread);
+        g_slice_free(GBinderExecutorThread, thread);
+        gbinder_executor_destroy(self);
+    }
+    return NULL;
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+GBinderExecutor*
+gbinder_executor_new(
+    const char* name,
+    GBinderExecutorFunc func,
+    void* user_data,
+    guint min_threads,
+    guint max_threads)
+{
+    GBinderExecutor* self = g_slice_new0(GBinderExecutor);
+    const guint ncpu = g_get_num_processors();
+    guint i;
+
+    self->name = g_strdup(name);
+    self->func = func;
+    self->user_data = user_data;
+    self->max_threads = MAX(max_threads, 1);
+    self->nqueues = MIN(MIN(MAX(ncpu, 1), self->max_threads),
+        GBINDER_EXECUTOR_MAX_QUEUES);
+    self->queues = g_new0(GBinderExecutorQueue, self->nqueues);
+    for (i = 0; i < self->nqueues; i++) {
+        g_mutex_init(&self->queues[i].mutex);
+    }
+    g_mutex_init(&self->mutex);
+    g_cond_init(&self->cond);
+    g_cond_init(&self->exit_cond);
+    gbinder_sched_slot_init(&self->sched, NULL);
+    gbinder_executor_set_min_threads(self, min_threads);
+    return self;
+}
+
+/*
+ * Waits for the queued work to complete. May be invoked by one of the
+ * workers, in which case it returns immediately and the last exiting
+ * worker thread deallocates the executor.
+ */
+void
+gbinder_executor_free(
+    GBinderExecutor* self)
+{
+    if (G_LIKELY(self)) {
+        const GBinderExecutorThread* current =
+            g_private_get(&gbinder_executor_current_thread);
+
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        self->stopped = TRUE;
+        g_cond_broadcast(&self->cond);
+        if (current && current->executor == self) {
+            self->orphan = TRUE;
+            g_mutex_unlock(&self->mutex);
+            /* Unlock */
+        } else {
+            while (self->nthreads) {
+                g_cond_wait(&self->exit_cond, &self->mutex);
+            }
+            gbinder_executor_reap_locked(self);
+            g_mutex_unlock(&self->mutex);
+            /* Unlock */
+            gbinder_executor_destroy(self);
+        }
+    }
+}
+
+void
+gbinder_executor_push(
+    GBinderExecutor* self,
+    GBinderExecutorWork* work)
+{
+    if (G_LIKELY(self) && G_LIKELY(work)) {
+        GBinderExecutorQueue* queue = self->queues +
+            gbinder_executor_queue_index(self);
+        guint queued;
+
+        work->next = NULL;
+        work->queued = g_get_monotonic_time();
+
+        /* Lock */
+        g_mutex_lock(&queue->mutex);
+        work->prev = queue->last;
+        if (queue->last) {
+            queue->last->next = work;
+        } else {
+            g_atomic_pointer_set(&queue->first, work);
+        }
+        queue->last = work;
+        g_atomic_pointer_set(&work->queue, queue);
+        g_mutex_unlock(&queue->mutex);
+        /* Unlock */
+
+        queued = g_atomic_int_add(&self->queued, 1) + 1;
+
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        GASSERT(!self->stopped);
+        if (self->idle) {
+            g_cond_signal(&self->cond);
+        }
+        if (queued > self->idle && self->nthreads < self->max_threads) {
+            /* The work is blocking, don't let it wait */
+            gbinder_executor_spawn_locked(self);
+        }
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+}
+
+/*
+ * The work can be cancelled by the same thread which has queued it.
+ * That guarantees that it's not going to be queued again while we
+ * are looking at it.
+ */
+gboolean
+gbinder_executor_cancel(
+    GBinderExecutor* self,
+    GBinderExecutorWork* work)
+{
+    gboolean removed = FALSE;
+
+    if (G_LIKELY(self) && G_LIKELY(work)) {
+        GBinderExecutorQueue* queue = g_atomic_pointer_get(&work->queue);
+
+        if (queue) {
+            /* Lock */
+            g_mutex_lock(&queue->mutex);
+            if (work->queue == queue) {
+                gbinder_executor_queue_unlink(queue, work);
+                removed = TRUE;
+            }
+            g_mutex_unlock(&queue->mutex);
+            /* Unlock */
+
+            if (removed) {
+                g_atomic_int_add(&self->queued, -1);
+            }
+        }
+    }
+    return removed;
+}
+
+void
+gbinder_executor_set_min_threads(
+    GBinderExecutor* self,
+    guint min_threads)
+{
+    if (G_LIKELY(self)) {
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        self->min_threads = MIN(min_threads, self->max_threads);
+        while (!self->stopped && self->nthreads < self->min_threads &&
+            gbinder_executor_spawn_locked(self));
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+}
+
+guint
+gbinder_executor_threads(
+    GBinderExecutor* self)
+{
+    guint n = 0;
+
+    if (G_LIKELY(self)) {
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        n = self->nthreads;
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+    return n;
+}
+
+/*
+ * Existing threads pick up the new parameters before running the next
+ * piece of work, new threads apply them right after they start.
+ */
+void
+gbinder_executor_set_sched(
+    GBinderExecutor* self,
+    GBinderSched* sched)
+{
+    if (G_LIKELY(self)) {
+        gbinder_sched_slot_set(&self->sched, sched);
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
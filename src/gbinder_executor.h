@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GBINDER_EXECUTOR_H
+#define GBINDER_EXECUTOR_H
+
+#include "gbinder_types_p.h"
+
+/*
+ * Executor for the blocking work (mostly synchronous binder calls made
+ * on behalf of asynchronous API). The work items are embedded into the
+ * caller's structures, the executor doesn't allocate anything per item.
+ */
+typedef struct gbinder_executor_work GBinderExecutorWork;
+struct gbinder_executor_work {
+    GBinderExecutorWork* next;
+    GBinderExecutorWork* prev;
+    struct gbinder_executor_queue* queue; /* Non-NULL while queued */
+    gint64 queued;
+};
+
+typedef
+void
+(*GBinderExecutorFunc)(
+    GBinderExecutorWork* work,
+    void* user_data);
+
+GBinderExecutor*
+gbinder_executor_new(
+    const char* name,
+    GBinderExecutorFunc func,
+    void* user_data,
+    guint min_threads,
+    guint max_threads);
+
+void
+gbinder_executor_free(
+    GBinderExecutor* executor);
+
+void
+gbinder_executor_push(
+    GBinderExecutor* executor,
+    GBinderExecutorWork* work);
+
+/* Returns TRUE if the work has been removed from the queue */
+gboolean
+gbinder_executor_cancel(
+    GBinderExecutor* executor,
+    GBinderExecutorWork* work);
+
+void
+gbinder_executor_set_min_threads(
+    GBinderExecutor* executor,
+    guint min_threads);
+
+guint
+gbinder_executor_threads(
+    GBinderExecutor* executor);
+
+void
+gbinder_executor_set_sched(
+    GBinderExecutor* executor,
+    GBinderSched* sched);
+
+#endif /* GBINDER_EXECUTOR_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
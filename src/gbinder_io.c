@@ -116,6 +116,10 @@ GBINDER_IO_FN(encode_local_object)(
     dest->hdr.type = BINDER_TYPE_BINDER;
     dest->flags = 0x7f | FLAT_BINDER_FLAG_ACCEPTS_FDS;
     dest->binder = (uintptr_t)obj;
+    if (obj) {
+        /* Stays the same until the kernel drops the node */
+        dest->cookie = obj->cookie;
+    }
     return sizeof(*dest);
 }
 
@@ -281,6 +285,7 @@ GBINDER_IO_FN(decode_transaction_data)(
     tx->pid = tr->sender_pid;
     tx->euid = tr->sender_euid;
     tx->target = (void*)(uintptr_t)tr->target.ptr;
+    tx->cookie = tr->cookie;
     tx->data = (void*)(uintptr_t)tr->data.ptr.buffer;
     if (tr->flags & TF_STATUS_CODE) {
         GASSERT(tr->data_size == 4);
@@ -339,12 +344,12 @@ GBINDER_IO_FN(decode_cookie)(
 static
 void*
 GBINDER_IO_FN(decode_binder_ptr_cookie)(
-    const void* data)
+    const void* data,
+    guint64* cookie)
 {
     const struct binder_ptr_cookie* ptr = data;
 
-    /* We never send cookie and don't expect it back */
-    GASSERT(!ptr->cookie);
+    if (cookie) *cookie = ptr->cookie;
     return (void*)(uintptr_t)ptr->ptr;
 }
 
@@ -50,6 +50,7 @@ typedef struct gbinder_io_tx_data {
     pid_t pid;
     uid_t euid;
     void* target;
+    guint64 cookie;
     void* data;
     gsize size;
     void** objects;
@@ -158,7 +159,7 @@ struct gbinder_io {
     void (*decode_transaction_data)(const void* data, GBinderIoTxData* tx);
 
 #define GBINDER_MAX_PTR_COOKIE_SIZE (16)
-    void* (*decode_binder_ptr_cookie)(const void* data);
+    void* (*decode_binder_ptr_cookie)(const void* data, guint64* cookie);
     guint (*decode_cookie)(const void* data, guint64* cookie);
     guint (*decode_binder_object)(const void* data, gsize size,
        GBinderObjectRegistry* reg, GBinderRemoteObject** obj);
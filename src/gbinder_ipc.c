@@ -31,7 +31,9 @@
  */
 
 #include "gbinder_ipc.h"
+#include "gbinder_admission.h"
 #include "gbinder_driver.h"
+#include "gbinder_executor.h"
 #include "gbinder_handler.h"
 #include "gbinder_io.h"
 #include "gbinder_object_registry.h"
@@ -41,6 +43,7 @@
 #include "gbinder_remote_object_p.h"
 #include "gbinder_remote_reply_p.h"
 #include "gbinder_remote_request_p.h"
+#include "gbinder_sched.h"
 #include "gbinder_writer.h"
 #include "gbinder_log.h"
 
@@ -53,24 +56,129 @@
 #include <errno.h>
 
 typedef struct gbinder_ipc_looper GBinderIpcLooper;
+typedef struct gbinder_ipc_tx_priv GBinderIpcTxPriv;
+typedef struct gbinder_ipc_tx_record GBinderIpcTxRecord;
+
+/*
+ * Remote objects are indexed by handle in a radix tree with 8 bits per
+ * level. Handles are small integers allocated by the kernel, so normally
+ * only one node per level is used. Nodes are never freed until GBinderIpc
+ * is finalized.
+ */
+#define GBINDER_IPC_REMOTE_BITS (8)
+#define GBINDER_IPC_REMOTE_FANOUT (1 << GBINDER_IPC_REMOTE_BITS)
+#define GBINDER_IPC_REMOTE_MASK (GBINDER_IPC_REMOTE_FANOUT - 1)
+#define GBINDER_IPC_REMOTE_LEVELS (32 / GBINDER_IPC_REMOTE_BITS)
+
+/*
+ * Local objects are identified by the cookie which we pass to the
+ * kernel together with the object pointer, and which comes back with
+ * every incoming transaction and refcount command. The cookie contains
+ * the index of the slot (plus one, so that it's never zero) and the
+ * generation of the slot, bumped every time the slot is released.
+ * The object (and therefore its slot) is kept alive for as long as the
+ * kernel holds references to it, so the cookie passed to the kernel for
+ * a given pointer never changes while the kernel node exists. Lookups
+ * are lock-free.
+ */
+#define GBINDER_IPC_LOCAL_INDEX_BITS (16)
+#define GBINDER_IPC_LOCAL_INDEX_MASK ((1u << GBINDER_IPC_LOCAL_INDEX_BITS) - 1)
+#define GBINDER_IPC_LOCAL_CHUNK_BITS (8)
+#define GBINDER_IPC_LOCAL_CHUNK_SIZE (1 << GBINDER_IPC_LOCAL_CHUNK_BITS)
+#define GBINDER_IPC_LOCAL_CHUNKS (1 << (GBINDER_IPC_LOCAL_INDEX_BITS - \
+    GBINDER_IPC_LOCAL_CHUNK_BITS))
+#define GBINDER_IPC_LOCAL_MAX_SLOTS GBINDER_IPC_LOCAL_INDEX_MASK
+
+typedef struct gbinder_ipc_local_slot {
+    GBinderLocalObject* obj;
+    guint generation;
+    guint next_free; /* Index plus one, zero terminates the list */
+} GBinderIpcLocalSlot;
+
+/*
+ * Lock-free readers register themselves in one of two counters.
+ * See gbinder_ipc_epoch_synchronize()
+ */
+typedef struct gbinder_ipc_epoch {
+    gint current;
+    gint readers[2];
+} GBinderIpcEpoch;
+
+/*
+ * With fair scheduling enabled, incoming transactions are queued per
+ * caller and the main thread serves the callers round-robin, one
+ * transaction at a time. The kernel doesn't tell us the sender pid of
+ * one-way transactions (it's always zero), so callers are identified
+ * by pid and euid. One-way transactions from the same euid share one
+ * queue, separate from the two-way ones. Idle callers are kept around for the sake of
+ * statistics. Once there are too many of them, the one which has been
+ * idle for the longest time is dropped.
+ */
+typedef struct gbinder_ipc_caller GBinderIpcCaller;
+struct gbinder_ipc_caller {
+    GBinderIpcCaller* next; /* Next active caller */
+    GList idle_link; /* Position in the idle queue (data points back) */
+    GBinderIpcLooperTx* first;
+    GBinderIpcLooperTx* last;
+    pid_t pid;
+    uid_t euid;
+    guint pending;
+    guint handled;
+    gint64 busy;
+    gboolean active;
+};
+
+#define GBINDER_IPC_MAX_IDLE_CALLERS (64)
 
 struct gbinder_ipc_priv {
     GBinderIpc* self;
-    GThreadPool* tx_pool;
-    GHashTable* tx_table;
+    GBinderExecutor* tx_pool;
+    GBinderExecutor* tx_pool_high;
+    GBinderIpcTxRecord** tx_chunks;
+    GBinderIpcTxRecord* tx_free;
+    guint tx_nchunks;
+    guint tx_count;
+    GSource* tx_done_source;
+    GBinderIpcTxPriv* tx_done_stack;
+    GBinderIpcTxPriv* tx_done_first;
+    GBinderIpcTxPriv* tx_done_last;
+    guint tx_done_batch;
+    GBinderAdmission incoming;
+    gboolean incoming_drop_oneway;
     GMainContext* context;
     char* key;
     GBinderObjectRegistry object_registry;
 
+    /* Lookups are lock-free, the mutex serializes updates */
     GMutex remote_objects_mutex;
-    GHashTable* remote_objects;
+    gpointer remote_objects[GBINDER_IPC_REMOTE_FANOUT];
+    guint remote_count;
+    GBinderIpcEpoch remote_epoch;
 
+    /* Same here, lookups don't need the mutex */
     GMutex local_objects_mutex;
-    GHashTable* local_objects;
-
-    /* We may need more loopers... But let's start with just one */
+    GBinderIpcLocalSlot* local_objects[GBINDER_IPC_LOCAL_CHUNKS];
+    guint local_slots;
+    guint local_free;
+    guint local_count;
+    GBinderIpcEpoch local_epoch;
+
+    /* Incoming transactions waiting for the main thread */
+    GMutex incoming_mutex;
+    GSource* incoming_source;
+    GBinderIpcLooperTx* incoming_first;
+    GBinderIpcLooperTx* incoming_last;
+    gboolean incoming_fair;
+    GHashTable* callers;
+    GBinderIpcCaller* callers_first; /* Active ones */
+    GBinderIpcCaller* callers_last;
+    GQueue idle_callers; /* Least recently active first */
+
+    /* Blocked loopers are waiting for the reply, another one is reading */
     GMutex looper_mutex;
     GBinderIpcLooper* looper;
+    GSList* blocked_loopers;
+    GBinderSched* looper_sched;
 };
 
 typedef GObjectClass GBinderIpcClass;
@@ -86,14 +194,22 @@ G_DEFINE_TYPE(GBinderIpc, gbinder_ipc, G_TYPE_OBJECT)
 static GHashTable* gbinder_ipc_table = NULL;
 static pthread_mutex_t gbinder_ipc_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-#define GBINDER_IPC_MAX_TX_THREADS (15)
+/* Transaction threads are started on demand unless prewarmed */
+#define GBINDER_IPC_MIN_TX_THREADS (0)
+#define GBINDER_IPC_MAX_TX_THREADS (64)
+#define GBINDER_IPC_MIN_HIGH_PRIORITY_TX_THREADS (0)
+#define GBINDER_IPC_MAX_HIGH_PRIORITY_TX_THREADS (4)
+#define GBINDER_IPC_PREWARM_TX_THREADS (1)
+#define GBINDER_IPC_PREWARM_HIGH_PRIORITY_TX_THREADS (1)
 #define GBINDER_IPC_MAX_LOOPERS (15)
+#define GBINDER_IPC_DEFAULT_INCOMING_PRIORITY G_PRIORITY_DEFAULT_IDLE
+#define GBINDER_IPC_DEFAULT_TX_DONE_BATCH (64)
 
 /*
  * When looper receives the transaction:
  *
  * 1. Finds the target object and allocates GBinderIpcLooperTx.
- * 2. Posts the GBinderIpcLooperTx reference to the main thread
+ * 2. Queues the GBinderIpcLooperTx reference for the main thread
  * 4. Waits for (any) byte from the receiving end of the tx pipe.
  *
  * When the main thread receives GBinderIpcLooperTx:
@@ -110,23 +226,52 @@ static pthread_mutex_t gbinder_ipc_mutex = PTHREAD_MUTEX_INITIALIZER;
  * Note that GBinderIpcLooperTx can be deallocated on either looper or
  * main thread, depending on whether looper gives up on the transaction
  * before it gets processed.
+ *
+ * One-way transactions don't need a response, so the looper doesn't
+ * wait for those unless the number of pending incoming transactions
+ * exceeds the limit (in which case two-way transactions are rejected
+ * with -EBUSY). Such transactions have no pipe.
+ *
+ * If the handler blocks the request, the main thread writes TX_BLOCKED
+ * to the pipe and leaves TX_DONE to gbinder_remote_request_complete()
+ * which may be called later on any thread. The reply has to be sent by
+ * the thread which has received the transaction, so the blocked looper
+ * keeps waiting and another looper takes over reading from the driver.
+ * The blocked one exits after sending the reply. If it's asked to exit
+ * before that, the request is completed with an error.
  */
 
 #define TX_DONE (0x2a)
+#define TX_BLOCKED (0x2b)
 
-typedef struct gbinder_ipc_looper_tx {
+/*
+ * The handler may block the request and complete it later, possibly
+ * on another thread. The state resolves the race between the handler
+ * returning on the main thread and gbinder_remote_request_complete().
+ */
+typedef enum gbinder_ipc_looper_tx_state {
+    GBINDER_IPC_LOOPER_TX_PROCESSING,
+    GBINDER_IPC_LOOPER_TX_BLOCKING,     /* Blocked, handler still running */
+    GBINDER_IPC_LOOPER_TX_BLOCKED,      /* Blocked, handler has returned */
+    GBINDER_IPC_LOOPER_TX_COMPLETING,   /* Completed, handler still running */
+    GBINDER_IPC_LOOPER_TX_DONE
+} GBINDER_IPC_LOOPER_TX_STATE;
+
+struct gbinder_ipc_looper_tx {
     /* Reference count */
     gint refcount;
+    gint state; /* GBINDER_IPC_LOOPER_TX_STATE */
     /* These are filled by the looper: */
     int pipefd[2];
     guint32 code;
     guint32 flags;
     GBinderLocalObject* obj;
     GBinderRemoteRequest* req;
+    GBinderIpcLooperTx* next; /* Incoming queue */
     /* And these by the main thread processing the transaction: */
     GBinderLocalReply* reply;
     int status;
-} GBinderIpcLooperTx;
+};
 
 struct gbinder_ipc_looper {
     gint refcount;
@@ -134,21 +279,38 @@ struct gbinder_ipc_looper {
     GBinderDriver* driver;
     GBinderIpc* ipc; /* Not a reference! */
     GThread* thread;
+    GBinderSchedSlot sched;
+    gboolean blocked; /* Replaced by another looper */
     int pipefd[2];
     int txfd[2];
 };
 
-typedef struct gbinder_ipc_tx_priv GBinderIpcTxPriv;
-
 typedef
 void
 (*GBinderIpcTxPrivFunc)(
     GBinderIpcTxPriv* tx);
 
+/*
+ * The state is needed to resolve the race between the completion
+ * delivered on the worker thread (or the worker thread touching the
+ * user data in any other way) and gbinder_ipc_cancel() which is invoked
+ * on the main thread.
+ */
+typedef enum gbinder_ipc_tx_state {
+    GBINDER_IPC_TX_PENDING,
+    GBINDER_IPC_TX_COMPLETED,
+    GBINDER_IPC_TX_CANCELLED
+} GBINDER_IPC_TX_STATE;
+
 typedef struct gbinder_ipc_tx_priv {
     GBinderIpcTx pub;
+    GBinderExecutorWork work;
+    GBinderIpcTxPriv* done_next;
+    gint state; /* GBINDER_IPC_TX_STATE */
+    GBinderExecutor* executor;
     GBinderIpcTxPrivFunc fn_exec;
     GBinderIpcTxPrivFunc fn_done;
+    GBinderIpcTxPrivFunc fn_detach;
     GBinderIpcTxPrivFunc fn_free;
 } GBinderIpcTxPriv;
 
@@ -171,9 +333,69 @@ typedef struct gbinder_ipc_tx_custom {
     GDestroyNotify fn_custom_destroy;
 } GBinderIpcTxCustom;
 
+/*
+ * Transaction records are allocated from the slab of fixed size chunks
+ * (which never move) and recycled via the free list. Transaction id
+ * encodes the index of the record and its generation which gets bumped
+ * every time the record is released, so that stale ids don't match.
+ * The generation takes the rest of the id, i.e. 44 bits on 64-bit
+ * systems (which never wrap in practice) and 12 bits on 32-bit ones.
+ * The index is incremented by one, so that ids are never zero. Records
+ * are only allocated, looked up and released by the main thread.
+ */
+struct gbinder_ipc_tx_record {
+    union {
+        GBinderIpcTxPriv tx;
+        GBinderIpcTxInternal internal;
+        GBinderIpcTxCustom custom;
+    } u;
+    GBinderIpcTxRecord* next_free;
+    guint index;
+    gulong generation;
+    gboolean pending; /* Until completed or cancelled */
+};
+
+#define GBINDER_IPC_TX_CHUNK_SIZE (64)
+#define GBINDER_IPC_TX_INDEX_BITS (20)
+#define GBINDER_IPC_TX_INDEX_MASK ((1u << GBINDER_IPC_TX_INDEX_BITS) - 1)
+#define GBINDER_IPC_TX_GENERATION_MASK \
+    (G_MAXULONG >> GBINDER_IPC_TX_INDEX_BITS)
+#define GBINDER_IPC_TX_MAX_RECORDS GBINDER_IPC_TX_INDEX_MASK
+
 GBINDER_INLINE_FUNC const char* gbinder_ipc_name(GBinderIpc* self)
     { return gbinder_driver_dev(self->driver); }
 
+/*==========================================================================*
+ * Admission control
+ *==========================================================================*/
+
+static
+gboolean
+gbinder_ipc_incoming_enter(
+    GBinderIpcPriv* priv,
+    GBinderLocalObject* obj,
+    gboolean force)
+{
+    if (gbinder_admission_enter(&priv->incoming, force)) {
+        if (gbinder_admission_enter(gbinder_local_object_admission(obj),
+            force)) {
+            return TRUE;
+        }
+        gbinder_admission_leave(&priv->incoming);
+    }
+    return FALSE;
+}
+
+static
+void
+gbinder_ipc_incoming_leave(
+    GBinderIpcPriv* priv,
+    GBinderLocalObject* obj)
+{
+    gbinder_admission_leave(gbinder_local_object_admission(obj));
+    gbinder_admission_leave(&priv->incoming);
+}
+
 /*==========================================================================*
  * GBinderIpcLooperTx
  *==========================================================================*/
@@ -241,33 +463,368 @@ gbinder_ipc_looper_tx_unref(
     return dropped;
 }
 
-/*==========================================================================*
- * GBinderIpcLooper
- *==========================================================================*/
+gboolean
+gbinder_ipc_looper_tx_block(
+    GBinderIpcLooperTx* tx)
+{
+    /* Only two-way transactions with the looper waiting can be blocked */
+    if (tx->pipefd[1] >= 0 && !(tx->flags & GBINDER_TX_FLAG_ONEWAY) &&
+        g_atomic_int_compare_and_exchange(&tx->state,
+        GBINDER_IPC_LOOPER_TX_PROCESSING, GBINDER_IPC_LOOPER_TX_BLOCKING)) {
+        /* This reference is released by gbinder_ipc_looper_tx_complete */
+        gbinder_ipc_looper_tx_ref(tx);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void
+gbinder_ipc_looper_tx_complete(
+    GBinderIpcLooperTx* tx,
+    GBinderLocalReply* reply,
+    int status)
+{
+    guint8 done = TX_DONE;
+
+    tx->reply = gbinder_local_reply_ref(reply);
+    tx->status = status;
+    if (!g_atomic_int_compare_and_exchange(&tx->state,
+        GBINDER_IPC_LOOPER_TX_BLOCKING, GBINDER_IPC_LOOPER_TX_COMPLETING) &&
+        g_atomic_int_compare_and_exchange(&tx->state,
+        GBINDER_IPC_LOOPER_TX_BLOCKED, GBINDER_IPC_LOOPER_TX_DONE)) {
+        /* The handler has returned, wake up the looper */
+        (void)write(tx->pipefd[1], &done, sizeof(done));
+    }
+    gbinder_ipc_looper_tx_unref(tx, FALSE);
+}
 
 static
-gboolean
+void
 gbinder_ipc_looper_tx_handle(
-    gpointer data)
+    GBinderIpcLooperTx* tx)
 {
-    GBinderIpcLooperTx* tx = data;
     guint8 done = TX_DONE;
+    guint8 blocked = TX_BLOCKED;
+
+    GBinderLocalReply* reply;
+    int status = -EFAULT;
 
     /* Actually handle the transaction */
-    tx->reply = gbinder_local_object_handle_transaction(tx->obj, tx->req,
-        tx->code, tx->flags, &tx->status);
+    gbinder_remote_request_set_looper_tx(tx->req, tx);
+    reply = gbinder_local_object_handle_transaction(tx->obj, tx->req,
+        tx->code, tx->flags, &status);
+    gbinder_remote_request_set_looper_tx(tx->req, NULL);
+
+    if (g_atomic_int_compare_and_exchange(&tx->state,
+        GBINDER_IPC_LOOPER_TX_PROCESSING, GBINDER_IPC_LOOPER_TX_DONE)) {
+        tx->reply = reply;
+        tx->status = status;
+    } else {
+        /* The reply has been (or will be) provided by the completion */
+        gbinder_local_reply_unref(reply);
+        /* This has to get to the looper before TX_DONE */
+        (void)write(tx->pipefd[1], &blocked, sizeof(blocked));
+        if (g_atomic_int_compare_and_exchange(&tx->state,
+            GBINDER_IPC_LOOPER_TX_BLOCKING, GBINDER_IPC_LOOPER_TX_BLOCKED)) {
+            return;
+        }
+        GASSERT(tx->state == GBINDER_IPC_LOOPER_TX_COMPLETING);
+        g_atomic_int_set(&tx->state, GBINDER_IPC_LOOPER_TX_DONE);
+    }
 
-    /* And wake up the looper */
-    (void)write(tx->pipefd[1], &done, sizeof(done));
-    return G_SOURCE_REMOVE;
+    /* And wake up the looper (if it's waiting) */
+    if (tx->pipefd[1] >= 0) {
+        (void)write(tx->pipefd[1], &done, sizeof(done));
+    }
 }
 
 static
 void
 gbinder_ipc_looper_tx_done(
+    GBinderIpcLooperTx* tx)
+{
+    gbinder_ipc_incoming_leave(tx->obj->ipc->priv, tx->obj);
+    gbinder_ipc_looper_tx_unref(tx, FALSE);
+}
+
+/*==========================================================================*
+ * Incoming queue
+ *==========================================================================*/
+
+static
+void
+gbinder_ipc_caller_free(
     gpointer data)
 {
-    gbinder_ipc_looper_tx_unref(data, FALSE);
+    GBinderIpcCaller* caller = data;
+
+    /* Queued transactions hold references to the IPC object */
+    GASSERT(!caller->first);
+    g_slice_free(GBinderIpcCaller, caller);
+}
+
+static
+guint
+gbinder_ipc_caller_hash(
+    gconstpointer key)
+{
+    const GBinderIpcCaller* caller = key;
+
+    return ((guint)caller->pid * 31) ^ (guint)caller->euid;
+}
+
+static
+gboolean
+gbinder_ipc_caller_equal(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const GBinderIpcCaller* c1 = a;
+    const GBinderIpcCaller* c2 = b;
+
+    return c1->pid == c2->pid && c1->euid == c2->euid;
+}
+
+static
+void
+gbinder_ipc_callers_idle_locked(
+    GBinderIpcPriv* priv,
+    GBinderIpcCaller* caller)
+{
+    caller->active = FALSE;
+    g_queue_push_tail_link(&priv->idle_callers, &caller->idle_link);
+    if (priv->idle_callers.length > GBINDER_IPC_MAX_IDLE_CALLERS) {
+        GList* oldest = g_queue_pop_head_link(&priv->idle_callers);
+        g_hash_table_remove(priv->callers, oldest->data);
+    }
+}
+
+static
+void
+gbinder_ipc_callers_push_locked(
+    GBinderIpcPriv* priv,
+    GBinderIpcLooperTx* tx)
+{
+    GBinderIpcCaller* caller;
+    GBinderIpcCaller key;
+
+    key.pid = gbinder_remote_request_sender_pid(tx->req);
+    key.euid = gbinder_remote_request_sender_euid(tx->req);
+    caller = g_hash_table_lookup(priv->callers, &key);
+    if (!caller) {
+        caller = g_slice_new0(GBinderIpcCaller);
+        caller->pid = key.pid;
+        caller->euid = key.euid;
+        caller->idle_link.data = caller;
+        g_hash_table_insert(priv->callers, caller, caller);
+    } else if (!caller->active) {
+        g_queue_unlink(&priv->idle_callers, &caller->idle_link);
+    }
+    caller->pending++;
+    if (caller->last) {
+        caller->last->next = tx;
+    } else {
+        caller->first = tx;
+    }
+    caller->last = tx;
+    if (!caller->active) {
+        caller->active = TRUE;
+        if (priv->callers_last) {
+            priv->callers_last->next = caller;
+        } else {
+            priv->callers_first = caller;
+        }
+        priv->callers_last = caller;
+    }
+}
+
+/* Takes the next transaction from the first active caller */
+static
+GBinderIpcLooperTx*
+gbinder_ipc_callers_take_locked(
+    GBinderIpcPriv* priv)
+{
+    GBinderIpcCaller* caller = priv->callers_first;
+    GBinderIpcLooperTx* tx = caller->first;
+
+    caller->first = tx->next;
+    caller->pending--;
+    tx->next = NULL;
+    priv->callers_first = caller->next;
+    caller->next = NULL;
+    if (caller->first) {
+        /* Back to the end of the line */
+        if (priv->callers_first) {
+            priv->callers_last->next = caller;
+        } else {
+            priv->callers_first = caller;
+        }
+        priv->callers_last = caller;
+    } else {
+        caller->last = NULL;
+        if (!priv->callers_first) {
+            priv->callers_last = NULL;
+        }
+        gbinder_ipc_callers_idle_locked(priv, caller);
+    }
+    return tx;
+}
+
+/*
+ * Incoming transactions are queued by the looper and handled by the
+ * main thread one per main loop iteration, at the priority configured
+ * with gbinder_ipc_set_incoming_priority(). The source is only ready
+ * while the queue is not empty.
+ */
+typedef struct gbinder_ipc_incoming_source {
+    GSource source;
+    GBinderIpc* ipc; /* Not a reference! */
+} GBinderIpcIncomingSource;
+
+static
+gboolean
+gbinder_ipc_incoming_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    GBinderIpcIncomingSource* incoming = G_CAST(source,
+        GBinderIpcIncomingSource, source);
+    /* The last transaction may be holding the last reference */
+    GBinderIpc* self = gbinder_ipc_ref(incoming->ipc);
+    GBinderIpcPriv* priv = self->priv;
+    GBinderIpcLooperTx* tx = NULL;
+    GBinderIpcCaller key;
+    gboolean fair = FALSE;
+
+    /* Lock */
+    g_mutex_lock(&priv->incoming_mutex);
+    if (priv->incoming_first) {
+        tx = priv->incoming_first;
+        priv->incoming_first = tx->next;
+        if (!priv->incoming_first) {
+            priv->incoming_last = NULL;
+        }
+        tx->next = NULL;
+    } else if (priv->callers_first) {
+        key.pid = priv->callers_first->pid;
+        key.euid = priv->callers_first->euid;
+        fair = TRUE;
+        tx = gbinder_ipc_callers_take_locked(priv);
+    }
+    if (!priv->incoming_first && !priv->callers_first) {
+        g_source_set_ready_time(source, -1);
+    }
+    g_mutex_unlock(&priv->incoming_mutex);
+    /* Unlock */
+
+    if (tx) {
+        const gint64 start = g_get_monotonic_time();
+
+        gbinder_ipc_looper_tx_handle(tx);
+        if (fair) {
+            GBinderIpcCaller* caller;
+
+            /* Lock */
+            g_mutex_lock(&priv->incoming_mutex);
+            /* Idle caller may have been expired in the meantime */
+            caller = g_hash_table_lookup(priv->callers, &key);
+            if (caller) {
+                caller->handled++;
+                caller->busy += g_get_monotonic_time() - start;
+            }
+            g_mutex_unlock(&priv->incoming_mutex);
+            /* Unlock */
+        }
+        gbinder_ipc_looper_tx_done(tx);
+    }
+
+    /* This may actually deallocate GBinderIpc object: */
+    gbinder_ipc_unref(self);
+    return G_SOURCE_CONTINUE;
+}
+
+static
+GSource*
+gbinder_ipc_incoming_source_new(
+    GBinderIpc* self)
+{
+    static GSourceFuncs gbinder_ipc_incoming_source_funcs = {
+        .dispatch = gbinder_ipc_incoming_dispatch
+    };
+    GSource* source = g_source_new(&gbinder_ipc_incoming_source_funcs,
+        sizeof(GBinderIpcIncomingSource));
+
+    G_CAST(source, GBinderIpcIncomingSource, source)->ipc = self;
+    g_source_set_priority(source, GBINDER_IPC_DEFAULT_INCOMING_PRIORITY);
+    g_source_attach(source, self->priv->context);
+    return source;
+}
+
+/* Lets GBinderLocalObject handle the transaction on the main thread */
+static
+void
+gbinder_ipc_looper_tx_post(
+    GBinderIpcPriv* priv,
+    GBinderIpcLooperTx* tx)
+{
+    gbinder_ipc_looper_tx_ref(tx);
+
+    /* Lock */
+    g_mutex_lock(&priv->incoming_mutex);
+    if (!priv->incoming_first && !priv->callers_first) {
+        /* Wake up the main thread */
+        g_source_set_ready_time(priv->incoming_source, 0);
+    }
+    if (priv->incoming_fair) {
+        gbinder_ipc_callers_push_locked(priv, tx);
+    } else {
+        if (priv->incoming_last) {
+            priv->incoming_last->next = tx;
+        } else {
+            priv->incoming_first = tx;
+        }
+        priv->incoming_last = tx;
+    }
+    g_mutex_unlock(&priv->incoming_mutex);
+    /* Unlock */
+}
+
+/*==========================================================================*
+ * GBinderIpcLooper
+ *==========================================================================*/
+
+static
+GBinderIpcLooper*
+gbinder_ipc_looper_new(
+    GBinderIpc* ipc);
+
+/* Called on the looper thread when the transaction gets blocked */
+static
+void
+gbinder_ipc_looper_block(
+    GBinderIpcLooper* looper)
+{
+    GBinderIpc* ipc = looper->ipc;
+    GBinderIpcPriv* priv = ipc->priv;
+
+    /* Lock */
+    g_mutex_lock(&priv->looper_mutex);
+    if (priv->looper == looper) {
+        if (g_slist_length(priv->blocked_loopers) < GBINDER_IPC_MAX_LOOPERS) {
+            GDEBUG("Looper %s is blocked, starting another one",
+                gbinder_ipc_name(ipc));
+            /* The reference moves to the list */
+            looper->blocked = TRUE;
+            priv->blocked_loopers = g_slist_append(priv->blocked_loopers,
+                looper);
+            priv->looper = gbinder_ipc_looper_new(ipc);
+        } else {
+            GWARN("Too many blocked loopers");
+        }
+    }
+    g_mutex_unlock(&priv->looper_mutex);
+    /* Unlock */
 }
 
 static
@@ -281,10 +838,39 @@ gbinder_ipc_looper_transact(
     int* result)
 {
     GBinderIpcLooper* looper = G_CAST(handler,GBinderIpcLooper,handler);
-    GBinderIpc* ipc = looper->ipc;
+    GBinderIpcPriv* priv = looper->ipc->priv;
     GBinderLocalReply* reply = NULL;
     int status = -EFAULT;
 
+    if (gbinder_ipc_incoming_enter(priv, obj, FALSE)) {
+        if (flags & GBINDER_TX_FLAG_ONEWAY) {
+            static const int nopipe[2] = { -1, -1 };
+            GBinderIpcLooperTx* tx = gbinder_ipc_looper_tx_new(obj, code,
+                flags, req, nopipe);
+
+            /* Nothing to wait for */
+            gbinder_ipc_looper_tx_post(priv, tx);
+            gbinder_ipc_looper_tx_unref(tx, FALSE);
+            *result = GBINDER_STATUS_OK;
+            return NULL;
+        }
+    } else if (!(flags & GBINDER_TX_FLAG_ONEWAY)) {
+        GWARN("Rejecting incoming transaction 0x%08x", code);
+        gbinder_admission_reject(&priv->incoming);
+        gbinder_admission_reject(gbinder_local_object_admission(obj));
+        *result = -EBUSY;
+        return NULL;
+    } else if (priv->incoming_drop_oneway) {
+        GWARN("Dropping incoming transaction 0x%08x", code);
+        gbinder_admission_drop(&priv->incoming);
+        gbinder_admission_drop(gbinder_local_object_admission(obj));
+        *result = GBINDER_STATUS_OK;
+        return NULL;
+    } else {
+        /* Stop reading from the driver until the main thread catches up */
+        gbinder_ipc_incoming_enter(priv, obj, TRUE);
+    }
+
     if (looper->txfd[0] < 0 && pipe(looper->txfd)) {
         GERR("Failed to create a tx pipe: %s", strerror(errno));
     }
@@ -292,16 +878,10 @@ gbinder_ipc_looper_transact(
     if (looper->txfd[0] >= 0) {
         GBinderIpcLooperTx* tx = gbinder_ipc_looper_tx_new(obj, code, flags,
             req, looper->txfd);
-        GBinderIpcPriv* priv = ipc->priv;
         struct pollfd fds[2];
-        guint8 done = 0;
-        GSource* source = g_idle_source_new();
+        guint8 done;
 
-        /* Let GBinderLocalObject handle the transaction on the main thread */
-        g_source_set_callback(source, gbinder_ipc_looper_tx_handle,
-            gbinder_ipc_looper_tx_ref(tx), gbinder_ipc_looper_tx_done);
-        g_source_attach(source, priv->context);
-        g_source_unref(source);
+        gbinder_ipc_looper_tx_post(priv, tx);
 
         /* Wait for either transaction completion or looper shutdown */
         memset(fds, 0, sizeof(fds));
@@ -309,21 +889,31 @@ gbinder_ipc_looper_transact(
         fds[0].events = POLLIN | POLLERR | POLLHUP | POLLNVAL;
         fds[1].fd = tx->pipefd[0];
         fds[1].events = POLLIN | POLLERR | POLLHUP | POLLNVAL;
-        poll(fds, 2, -1);
+        do {
+            done = 0;
+            poll(fds, 2, -1);
+            if ((fds[1].revents & POLLIN) &&
+                read(fds[1].fd, &done, sizeof(done)) == 1 &&
+                done == TX_BLOCKED) {
+                /* Let another looper read from the driver meanwhile */
+                gbinder_ipc_looper_block(looper);
+            }
+        } while (done == TX_BLOCKED);
 
-        if ((fds[1].revents & POLLIN) &&
-            read(fds[1].fd, &done, sizeof(done)) == 1) {
+        if (done == TX_DONE) {
             /* Normal completion */
-            GASSERT(done == TX_DONE);
             reply = gbinder_local_reply_ref(tx->reply);
             status = tx->status;
-            if (!gbinder_ipc_looper_tx_unref(tx, TRUE)) {
-                /* gbinder_ipc_looper_tx_free() will close those */
-                looper->txfd[0] = looper->txfd[1] = -1;
-            }
         } else {
-            gbinder_ipc_looper_tx_unref(tx, FALSE);
+            /* Nobody is going to wait for the blocked request anymore */
+            gbinder_remote_request_cancel(req, status);
+        }
+        if (!gbinder_ipc_looper_tx_unref(tx, TRUE)) {
+            /* gbinder_ipc_looper_tx_free() will close those */
+            looper->txfd[0] = looper->txfd[1] = -1;
         }
+    } else {
+        gbinder_ipc_incoming_leave(priv, obj);
     }
     *result = status;
     return reply;
@@ -344,6 +934,7 @@ gbinder_ipc_looper_free(
         close(looper->txfd[1]);
     }
     gbinder_driver_unref(looper->driver);
+    gbinder_sched_slot_clear(&looper->sched);
     g_slice_free(GBinderIpcLooper, looper);
 }
 
@@ -375,7 +966,9 @@ gbinder_ipc_looper_thread(
 {
     GBinderIpcLooper* looper = data;
     GBinderDriver* driver = looper->driver;
+    gint sched_gen = 0;
 
+    gbinder_sched_slot_apply(&looper->sched, &sched_gen);
     if (gbinder_driver_enter_looper(driver)) {
         struct pollfd pipefd;
         int result;
@@ -387,6 +980,7 @@ gbinder_ipc_looper_thread(
 
         result = gbinder_driver_poll(driver, &pipefd);
         while (looper->ipc && ((result & POLLIN) || !result)) {
+            gbinder_sched_slot_apply(&looper->sched, &sched_gen);
             if (result & POLLIN) {
                 /* No need to synchronize access to looper->ipc because
                  * the other thread would wait until this thread exits
@@ -402,6 +996,12 @@ gbinder_ipc_looper_thread(
                     GDEBUG("Looper %s failed", gbinder_driver_dev(driver));
                     break;
                 }
+                if (looper->blocked) {
+                    /* Another looper has taken over */
+                    GDEBUG("Looper %s is replaced",
+                        gbinder_driver_dev(driver));
+                    break;
+                }
             }
             if (pipefd.revents) {
                 /* Any event from this pipe terminates the loop */
@@ -427,6 +1027,12 @@ gbinder_ipc_looper_thread(
                 /* Spontaneous exit */
                 priv->looper = NULL;
                 GDEBUG("Looper %s exits", gbinder_driver_dev(driver));
+            } else if (g_slist_find(priv->blocked_loopers, looper)) {
+                /* Done with the blocked transaction */
+                priv->blocked_loopers = g_slist_remove(priv->blocked_loopers,
+                    looper);
+                gbinder_ipc_looper_unref(looper);
+                GDEBUG("Looper %s is done", gbinder_driver_dev(driver));
             } else {
                 /* Main thread is shutting it down */
                 GDEBUG("Looper %s done", gbinder_driver_dev(driver));
@@ -463,6 +1069,7 @@ gbinder_ipc_looper_new(
         looper->handler.f = &handler_functions;
         looper->ipc = ipc;
         looper->driver = gbinder_driver_ref(ipc->driver);
+        gbinder_sched_slot_init(&looper->sched, ipc->priv->looper_sched);
         looper->thread = g_thread_try_new(gbinder_ipc_name(ipc),
             gbinder_ipc_looper_thread, looper, &error);
         if (looper->thread) {
@@ -480,92 +1087,319 @@ gbinder_ipc_looper_new(
     return NULL;
 }
 
+/* Releases the reference */
+static
+void
+gbinder_ipc_looper_stop(
+    GBinderIpcLooper* looper)
+{
+    if (looper->thread && looper->thread != g_thread_self()) {
+        guint8 done = TX_DONE;
+
+        GDEBUG("Stopping looper %s", gbinder_ipc_name(looper->ipc));
+        if (write(looper->pipefd[1], &done, sizeof(done)) > 0) {
+            g_thread_join(looper->thread);
+            looper->thread = NULL;
+        }
+    }
+    looper->ipc = NULL;
+    gbinder_ipc_looper_unref(looper);
+}
+
 void
 gbinder_ipc_looper_check(
     GBinderIpc* self)
 {
-    if (G_LIKELY(self)) {
-        GBinderIpcPriv* priv = self->priv;
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+
+        if (!priv->looper) {
+            /* Lock */
+            g_mutex_lock(&priv->looper_mutex);
+            if (!priv->looper) {
+                GDEBUG("Starting looper %s", gbinder_ipc_name(self));
+                priv->looper = gbinder_ipc_looper_new(self);
+            }
+            g_mutex_unlock(&priv->looper_mutex);
+            /* Unlock */
+        }
+    }
+}
+
+/*==========================================================================*
+ * Object tables
+ *==========================================================================*/
+
+GBINDER_INLINE_FUNC
+int
+gbinder_ipc_epoch_enter(
+    GBinderIpcEpoch* epoch)
+{
+    const int i = g_atomic_int_get(&epoch->current) & 1;
+
+    g_atomic_int_inc(epoch->readers + i);
+    return i;
+}
+
+GBINDER_INLINE_FUNC
+void
+gbinder_ipc_epoch_leave(
+    GBinderIpcEpoch* epoch,
+    int i)
+{
+    g_atomic_int_add(epoch->readers + i, -1);
+}
+
+/*
+ * Waits until the readers which may have seen the object before it was
+ * removed from the table are finished. Each counter has to be seen at
+ * zero at least once. New readers are directed to the other counter,
+ * so that we don't wait forever. Readers never block, so the wait is
+ * short, but it must not be done under the table lock.
+ */
+static
+void
+gbinder_ipc_epoch_synchronize(
+    GBinderIpcEpoch* epoch)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        g_atomic_int_set(&epoch->current, !i);
+        while (g_atomic_int_get(epoch->readers + i)) {
+            g_thread_yield();
+        }
+    }
+}
+
+/*
+ * Takes a reference only if the object is still alive. The refcount is
+ * our own, not GObject's, so that once it has dropped to zero, nobody
+ * can bring the object back. The caller makes sure that the memory is
+ * still there (by being a registered reader).
+ */
+static
+gboolean
+gbinder_ipc_object_try_ref(
+    gint* refcount)
+{
+    int n;
+
+    do {
+        n = g_atomic_int_get(refcount);
+    } while (n > 0 && !g_atomic_int_compare_and_exchange(refcount, n, n + 1));
+    return n > 0;
+}
+
+/*
+ * Returns the slot for the handle, optionally creating the missing nodes
+ * (which requires the lock). Nodes are published atomically, so that
+ * lock-free lookups never see partially initialized ones.
+ */
+static
+gpointer*
+gbinder_ipc_remote_slot(
+    GBinderIpcPriv* priv,
+    guint32 handle,
+    gboolean create)
+{
+    gpointer* node = priv->remote_objects;
+    int shift = (GBINDER_IPC_REMOTE_LEVELS - 1) * GBINDER_IPC_REMOTE_BITS;
+
+    for (; shift > 0; shift -= GBINDER_IPC_REMOTE_BITS) {
+        gpointer* slot = node + ((handle >> shift) & GBINDER_IPC_REMOTE_MASK);
+        gpointer* next = g_atomic_pointer_get(slot);
+
+        if (!next) {
+            if (!create) {
+                return NULL;
+            }
+            next = g_new0(gpointer, GBINDER_IPC_REMOTE_FANOUT);
+            g_atomic_pointer_set(slot, next);
+        }
+        node = next;
+    }
+    return node + (handle & GBINDER_IPC_REMOTE_MASK);
+}
+
+static
+void
+gbinder_ipc_remote_free_nodes(
+    gpointer* node,
+    int level)
+{
+    if (level > 1) {
+        int i;
+
+        for (i = 0; i < GBINDER_IPC_REMOTE_FANOUT; i++) {
+            if (node[i]) {
+                gbinder_ipc_remote_free_nodes(node[i], level - 1);
+                g_free(node[i]);
+            }
+        }
+    }
+}
+
+/* Lock-free lookup, falls back to the slow path if it returns NULL */
+static
+GBinderRemoteObject*
+gbinder_ipc_remote_lookup(
+    GBinderIpcPriv* priv,
+    guint32 handle)
+{
+    const int epoch = gbinder_ipc_epoch_enter(&priv->remote_epoch);
+    gpointer* slot = gbinder_ipc_remote_slot(priv, handle, FALSE);
+    GBinderRemoteObject* obj = slot ? g_atomic_pointer_get(slot) : NULL;
+
+    if (obj && !gbinder_ipc_object_try_ref(&obj->refcount)) {
+        /* It's on its way out */
+        obj = NULL;
+    }
+    gbinder_ipc_epoch_leave(&priv->remote_epoch, epoch);
+    return obj;
+}
+
+/* Chunks are published atomically, see gbinder_ipc_local_slot_alloc() */
+static
+GBinderIpcLocalSlot*
+gbinder_ipc_local_slot(
+    GBinderIpcPriv* priv,
+    guint32 cookie)
+{
+    const guint index = cookie & GBINDER_IPC_LOCAL_INDEX_MASK;
+
+    if (index) {
+        const guint i = index - 1;
+        GBinderIpcLocalSlot* chunk = g_atomic_pointer_get
+            (priv->local_objects + (i >> GBINDER_IPC_LOCAL_CHUNK_BITS));
+
+        if (chunk) {
+            return chunk + (i & (GBINDER_IPC_LOCAL_CHUNK_SIZE - 1));
+        }
+    }
+    return NULL;
+}
+
+/* Must be called under the lock. Returns index plus one, zero on failure */
+static
+guint
+gbinder_ipc_local_slot_alloc(
+    GBinderIpcPriv* priv)
+{
+    const guint index = priv->local_free;
+
+    if (index) {
+        GBinderIpcLocalSlot* slot = gbinder_ipc_local_slot(priv, index);
+
+        priv->local_free = slot->next_free;
+        slot->next_free = 0;
+        return index;
+    } else if (priv->local_slots < GBINDER_IPC_LOCAL_MAX_SLOTS) {
+        const guint i = priv->local_slots++;
+        GBinderIpcLocalSlot** chunk = priv->local_objects +
+            (i >> GBINDER_IPC_LOCAL_CHUNK_BITS);
+
+        if (!*chunk) {
+            g_atomic_pointer_set(chunk, g_new0(GBinderIpcLocalSlot,
+                GBINDER_IPC_LOCAL_CHUNK_SIZE));
+        }
+        return i + 1;
+    }
+    return 0;
+}
+
+/*
+ * Lock-free lookup. Both the pointer and the cookie must match, which
+ * protects us from stale pointers and cookies. The cookie never changes
+ * after the object has been published and the slot is cleared before
+ * its generation is bumped, so if the object found in the slot carries
+ * the right cookie, it's the right object. It can't be deallocated while
+ * we are inside the epoch, but it may already be on its way out.
+ */
+static
+GBinderLocalObject*
+gbinder_ipc_local_lookup(
+    GBinderIpcPriv* priv,
+    void* pointer,
+    guint32 cookie)
+{
+    const int epoch = gbinder_ipc_epoch_enter(&priv->local_epoch);
+    GBinderIpcLocalSlot* slot = gbinder_ipc_local_slot(priv, cookie);
+    GBinderLocalObject* obj = slot ? g_atomic_pointer_get(&slot->obj) : NULL;
 
-        if (!priv->looper) {
-            /* Lock */
-            g_mutex_lock(&priv->looper_mutex);
-            if (!priv->looper) {
-                GDEBUG("Starting looper %s", gbinder_ipc_name(self));
-                priv->looper = gbinder_ipc_looper_new(self);
-            }
-            g_mutex_unlock(&priv->looper_mutex);
-            /* Unlock */
-        }
+    if (obj && (obj != pointer || obj->cookie != cookie ||
+        !gbinder_ipc_object_try_ref(&obj->refcount))) {
+        obj = NULL;
     }
+    gbinder_ipc_epoch_leave(&priv->local_epoch, epoch);
+    return obj;
 }
 
 /*==========================================================================*
  * GBinderObjectRegistry
  *==========================================================================*/
 
-/**
- * Internal function called by gbinder_object_dispose(). Among other things,
- * it means that it doesn't have to check GBinderIpc pointer for NULL.
- *
- * Note the following scenario (where object may be either local or remote):
- *
- * 1. Last reference to GBinderObject goes away.
- * 2. gbinder_ipc_object_disposed() is invoked by gbinder_object_dispose()
- * 3. Before gbinder_ipc_object_disposed() grabs the lock,
- *    gbinder_ipc_new_remote_object() gets there first, finds the
- *    object in the hashtable, bumps its refcount (under the lock)
- *    and returns new reference to the caller.
- * 4. gbinder_ipc_object_disposed() finally gets its lock, finds
- *    that the object's refcount is greater than zero and leaves
- *    the object in the table.
- *
- * It's OK for a GObject to get re-referenced in dispose. glib will
- * recheck the refcount once dispose returns, the object stays alive
- * and gbinder_object_finalize() won't be called this time around,
+/*
+ * Called by gbinder_local_object_unref() when the last reference is
+ * gone, before the object gets deallocated. The kernel holds a reference
+ * to the object for as long as it knows about it (see
+ * gbinder_local_object_handle_increfs()), so by now nobody can send us
+ * this pointer and cookie anymore and the slot can be reused. We still
+ * have to wait for the lock-free lookups which may be looking at it.
  */
 void
-gbinder_ipc_local_object_disposed(
+gbinder_ipc_local_object_released(
     GBinderIpc* self,
     GBinderLocalObject* obj)
 {
     GBinderIpcPriv* priv = self->priv;
+    GBinderIpcLocalSlot* slot;
 
     /* Lock */
     g_mutex_lock(&priv->local_objects_mutex);
-    if (obj->object.ref_count == 1 && priv->local_objects) {
-        g_hash_table_remove(priv->local_objects, obj);
-        if (g_hash_table_size(priv->local_objects) == 0) {
-            g_hash_table_unref(priv->local_objects);
-            priv->local_objects = NULL;
-        }
+    slot = gbinder_ipc_local_slot(priv, obj->cookie);
+    if (slot && slot->obj == obj) {
+        GVERBOSE_("%p 0x%08x", obj, obj->cookie);
+        g_atomic_pointer_set(&slot->obj, NULL);
+        slot->generation++;
+        slot->next_free = priv->local_free;
+        priv->local_free = obj->cookie & GBINDER_IPC_LOCAL_INDEX_MASK;
+        priv->local_count--;
     }
     g_mutex_unlock(&priv->local_objects_mutex);
     /* Unlock */
+
+    gbinder_ipc_epoch_synchronize(&priv->local_epoch);
 }
 
+/*
+ * Called by gbinder_remote_object_unref() when the last reference is
+ * gone, before the object gets deallocated. The refcount can't go back
+ * up from zero, so all we need to do is to remove the object from the
+ * table (unless the slot has been taken by a new object for the same
+ * handle already) and wait for the lock-free lookups which may still
+ * be looking at it.
+ */
 void
-gbinder_ipc_remote_object_disposed(
+gbinder_ipc_remote_object_released(
     GBinderIpc* self,
     GBinderRemoteObject* obj)
 {
     GBinderIpcPriv* priv = self->priv;
+    gpointer* slot;
 
     /* Lock */
     g_mutex_lock(&priv->remote_objects_mutex);
-    if (obj->object.ref_count == 1 && priv->remote_objects) {
-        void* key = GINT_TO_POINTER(obj->handle);
-
+    slot = gbinder_ipc_remote_slot(priv, obj->handle, FALSE);
+    if (slot && g_atomic_pointer_get(slot) == obj) {
         GVERBOSE_("handle %u", obj->handle);
-        GASSERT(g_hash_table_contains(priv->remote_objects, key));
-        g_hash_table_remove(priv->remote_objects, key);
-        if (g_hash_table_size(priv->remote_objects) == 0) {
-            g_hash_table_unref(priv->remote_objects);
-            priv->remote_objects = NULL;
-        }
+        g_atomic_pointer_set(slot, NULL);
+        priv->remote_count--;
     }
     g_mutex_unlock(&priv->remote_objects_mutex);
     /* Unlock */
+
+    gbinder_ipc_epoch_synchronize(&priv->remote_epoch);
 }
 
 GBinderLocalObject*
@@ -578,46 +1412,49 @@ gbinder_ipc_new_local_object(
     GBinderIpcPriv* priv = self->priv;
     GBinderLocalObject* obj = gbinder_local_object_new
         (self, iface, txproc, data);
+    guint index;
 
     /* Lock */
     g_mutex_lock(&priv->local_objects_mutex);
-    if (!priv->local_objects) {
-        priv->local_objects = g_hash_table_new(g_direct_hash, g_direct_equal);
+    index = gbinder_ipc_local_slot_alloc(priv);
+    if (index) {
+        GBinderIpcLocalSlot* slot = gbinder_ipc_local_slot(priv, index);
+
+        obj->cookie = (slot->generation << GBINDER_IPC_LOCAL_INDEX_BITS) |
+            index;
+        priv->local_count++;
+        g_atomic_pointer_set(&slot->obj, obj);
     }
-    g_hash_table_insert(priv->local_objects, obj, obj);
     g_mutex_unlock(&priv->local_objects_mutex);
     /* Unlock */
 
-    GVERBOSE_("%p", obj);
-    gbinder_ipc_looper_check(self);
-    return obj;
+    if (index) {
+        GVERBOSE_("%p 0x%08x", obj, obj->cookie);
+        gbinder_ipc_looper_check(self);
+        return obj;
+    } else {
+        GERR("Too many local objects");
+        gbinder_local_object_unref(obj);
+        return NULL;
+    }
 }
 
 static
 GBinderLocalObject*
 gbinder_ipc_priv_get_local_object(
     GBinderIpcPriv* priv,
-    void* pointer)
+    void* pointer,
+    guint64 cookie)
 {
     GBinderLocalObject* obj = NULL;
 
     if (pointer) {
-        /* Lock */
-        g_mutex_lock(&priv->local_objects_mutex);
-        if (priv->local_objects) {
-            obj = g_hash_table_lookup(priv->local_objects, pointer);
-            if (obj) {
-                gbinder_local_object_ref(obj);
-            } else {
-                GWARN("Unknown local object %p", pointer);
-            }
-        } else {
-            GWARN("Unknown local object %p", pointer);
+        obj = gbinder_ipc_local_lookup(priv, pointer, (guint32)cookie);
+        if (!obj) {
+            GWARN("Unknown local object %p 0x%08llx", pointer,
+                (long long unsigned int)cookie);
         }
-        g_mutex_unlock(&priv->local_objects_mutex);
-        /* Unlock */
     }
-
     return obj;
 }
 
@@ -627,27 +1464,32 @@ gbinder_ipc_priv_get_remote_object(
     GBinderIpcPriv* priv,
     guint32 handle)
 {
-    GBinderRemoteObject* obj = NULL;
-    void* key = GINT_TO_POINTER(handle);
+    GBinderRemoteObject* obj = gbinder_ipc_remote_lookup(priv, handle);
 
-    /* Lock */
-    g_mutex_lock(&priv->remote_objects_mutex);
-    if (priv->remote_objects) {
-        obj = g_hash_table_lookup(priv->remote_objects, key);
-    }
-    if (obj) {
-        gbinder_remote_object_ref(obj);
-    } else {
-        obj = gbinder_remote_object_new(priv->self, handle);
-        if (!priv->remote_objects) {
-            priv->remote_objects = g_hash_table_new
-                (g_direct_hash, g_direct_equal);
+    if (!obj) {
+        GBinderRemoteObject* dying;
+        gpointer* slot;
+
+        /* Lock */
+        g_mutex_lock(&priv->remote_objects_mutex);
+        slot = gbinder_ipc_remote_slot(priv, handle, TRUE);
+        dying = g_atomic_pointer_get(slot);
+        if (dying && gbinder_ipc_object_try_ref(&dying->refcount)) {
+            /* Someone has just inserted it */
+            obj = dying;
+        } else {
+            obj = gbinder_remote_object_new(priv->self, handle);
+            if (obj) {
+                /* The dying one (if any) won't touch the slot anymore */
+                if (!dying) {
+                    priv->remote_count++;
+                }
+                g_atomic_pointer_set(slot, obj);
+            }
         }
-        g_hash_table_replace(priv->remote_objects, key, obj);
+        g_mutex_unlock(&priv->remote_objects_mutex);
+        /* Unlock */
     }
-    g_mutex_unlock(&priv->remote_objects_mutex);
-    /* Unlock */
-
     return obj;
 }
 
@@ -696,10 +1538,11 @@ static
 GBinderLocalObject*
 gbinder_ipc_object_registry_get_local(
     GBinderObjectRegistry* reg,
-    void* pointer)
+    void* pointer,
+    guint64 cookie)
 {
     return gbinder_ipc_priv_get_local_object
-        (gbinder_ipc_priv_from_object_registry(reg), pointer);
+        (gbinder_ipc_priv_from_object_registry(reg), pointer, cookie);
 }
 
 static
@@ -716,29 +1559,98 @@ gbinder_ipc_object_registry_get_remote(
  * Implementation
  *==========================================================================*/
 
-static
-gulong
-gbinder_ipc_tx_new_id()
+GBINDER_INLINE_FUNC
+GBinderIpcTxRecord*
+gbinder_ipc_tx_record(
+    GBinderIpcTxPriv* tx)
 {
-    static gint gbinder_ipc_next_id = 1;
-    gulong id = (guint)g_atomic_int_add(&gbinder_ipc_next_id, 1);
-
-    if (!id) id = (guint)g_atomic_int_add(&gbinder_ipc_next_id, 1);
-    return id;
+    return G_CAST(tx, GBinderIpcTxRecord, u.tx);
 }
 
 static
-gulong
-gbinder_ipc_tx_get_id(
+GBinderIpcTxPriv*
+gbinder_ipc_tx_alloc(
     GBinderIpc* self)
 {
     GBinderIpcPriv* priv = self->priv;
-    gulong id = gbinder_ipc_tx_new_id();
+    GBinderIpcTxRecord* rec = priv->tx_free;
+
+    if (rec) {
+        priv->tx_free = rec->next_free;
+        rec->next_free = NULL;
+    } else if (priv->tx_count < GBINDER_IPC_TX_MAX_RECORDS) {
+        const guint index = priv->tx_count++;
+        const guint chunk = index / GBINDER_IPC_TX_CHUNK_SIZE;
+
+        if (chunk == priv->tx_nchunks) {
+            priv->tx_chunks = g_renew(GBinderIpcTxRecord*, priv->tx_chunks,
+                priv->tx_nchunks + 1);
+            priv->tx_chunks[priv->tx_nchunks++] =
+                g_new0(GBinderIpcTxRecord, GBINDER_IPC_TX_CHUNK_SIZE);
+        }
+        rec = priv->tx_chunks[chunk] + (index % GBINDER_IPC_TX_CHUNK_SIZE);
+        rec->index = index;
+    } else {
+        GWARN("Too many pending transactions");
+        return NULL;
+    }
+
+    memset(&rec->u, 0, sizeof(rec->u));
+    rec->u.tx.pub.id = (rec->generation << GBINDER_IPC_TX_INDEX_BITS) |
+        (rec->index + 1);
+    rec->pending = TRUE;
+    return &rec->u.tx;
+}
 
-    while (g_hash_table_contains(priv->tx_table, GINT_TO_POINTER(id))) {
-        id = gbinder_ipc_tx_new_id();
+static
+void
+gbinder_ipc_tx_release(
+    GBinderIpcPriv* priv,
+    GBinderIpcTxPriv* tx)
+{
+    GBinderIpcTxRecord* rec = gbinder_ipc_tx_record(tx);
+
+    rec->u.tx.pub.id = 0;
+    rec->pending = FALSE;
+    rec->generation = (rec->generation + 1) & GBINDER_IPC_TX_GENERATION_MASK;
+    rec->next_free = priv->tx_free;
+    priv->tx_free = rec;
+}
+
+static
+void
+gbinder_ipc_tx_free_records(
+    GBinderIpcPriv* priv)
+{
+    guint i;
+
+    /* All records must have been released by now */
+    for (i = 0; i < priv->tx_nchunks; i++) {
+        g_free(priv->tx_chunks[i]);
+    }
+    g_free(priv->tx_chunks);
+}
+
+/* Returns the pending transaction or NULL if the id is stale or invalid */
+static
+GBinderIpcTxPriv*
+gbinder_ipc_tx_lookup(
+    GBinderIpcPriv* priv,
+    gulong id)
+{
+    /* Zero index part wraps around and fails the range check */
+    const guint index = (guint)(id & GBINDER_IPC_TX_INDEX_MASK) - 1;
+
+    if (index < priv->tx_count) {
+        GBinderIpcTxRecord* rec = priv->tx_chunks
+            [index / GBINDER_IPC_TX_CHUNK_SIZE] +
+            (index % GBINDER_IPC_TX_CHUNK_SIZE);
+
+        if (rec->pending && rec->u.tx.pub.id == id) {
+            return &rec->u.tx;
+        }
     }
-    return id;
+    return NULL;
 }
 
 static
@@ -746,10 +1658,8 @@ void
 gbinder_ipc_tx_pub_init(
     GBinderIpcTx* tx,
     GBinderIpc* self,
-    gulong id,
     void* user_data)
 {
-    tx->id = id;
     tx->ipc = gbinder_ipc_ref(self);
     tx->user_data = user_data;
 }
@@ -776,7 +1686,25 @@ gbinder_ipc_tx_internal_free(
     if (tx->fn_destroy) {
         tx->fn_destroy(pub->user_data);
     }
-    g_slice_free(GBinderIpcTxInternal, tx);
+}
+
+/*
+ * Cancelled internal transaction doesn't need the user data anymore,
+ * even if it's still being executed.
+ */
+static
+void
+gbinder_ipc_tx_internal_detach(
+    GBinderIpcTxPriv* priv)
+{
+    GBinderIpcTxInternal* tx = gbinder_ipc_tx_internal_cast(priv);
+    GDestroyNotify destroy = tx->fn_destroy;
+
+    tx->fn_reply = NULL;
+    tx->fn_destroy = NULL;
+    if (destroy) {
+        destroy(priv->pub.user_data);
+    }
 }
 
 static
@@ -787,7 +1715,8 @@ gbinder_ipc_tx_internal_done(
     GBinderIpcTxInternal* tx = gbinder_ipc_tx_internal_cast(priv);
     GBinderIpcTx* pub = &priv->pub;
 
-    if (tx->fn_reply) {
+    /* Direct replies have already been delivered by the worker thread */
+    if (tx->fn_reply && !(tx->flags & GBINDER_TX_FLAG_DIRECT_REPLY)) {
         tx->fn_reply(pub->ipc, tx->reply, tx->status, pub->user_data);
     }
 }
@@ -812,13 +1741,19 @@ gbinder_ipc_tx_internal_exec(
         gbinder_remote_reply_unref(tx->reply);
         tx->reply = NULL;
     }
+    if ((tx->flags & GBINDER_TX_FLAG_DIRECT_REPLY) &&
+        g_atomic_int_compare_and_exchange(&priv->state,
+        GBINDER_IPC_TX_PENDING, GBINDER_IPC_TX_COMPLETED) &&
+        tx->fn_reply) {
+        /* Not cancelled (yet), deliver the reply right here */
+        tx->fn_reply(self, tx->reply, tx->status, pub->user_data);
+    }
 }
 
 static
 GBinderIpcTxPriv*
 gbinder_ipc_tx_internal_new(
     GBinderIpc* self,
-    gulong id,
     guint32 handle,
     guint32 code,
     guint32 flags,
@@ -827,12 +1762,18 @@ gbinder_ipc_tx_internal_new(
     GDestroyNotify destroy,
     void* user_data)
 {
-    GBinderIpcTxInternal* tx = g_slice_new0(GBinderIpcTxInternal);
-    GBinderIpcTxPriv* priv = &tx->tx;
+    GBinderIpcTxPriv* priv = gbinder_ipc_tx_alloc(self);
+    GBinderIpcTxInternal* tx;
+
+    if (!priv) {
+        return NULL;
+    }
 
-    gbinder_ipc_tx_pub_init(&priv->pub, self, id, user_data);
+    tx = gbinder_ipc_tx_internal_cast(priv);
+    gbinder_ipc_tx_pub_init(&priv->pub, self, user_data);
     priv->fn_exec = gbinder_ipc_tx_internal_exec;
     priv->fn_done = gbinder_ipc_tx_internal_done;
+    priv->fn_detach = gbinder_ipc_tx_internal_detach;
     priv->fn_free = gbinder_ipc_tx_internal_free;
 
     tx->code = code;
@@ -864,7 +1805,6 @@ gbinder_ipc_tx_custom_free(
     if (tx->fn_custom_destroy) {
         tx->fn_custom_destroy(priv->pub.user_data);
     }
-    g_slice_free(GBinderIpcTxCustom, tx);
 }
 
 static
@@ -895,16 +1835,20 @@ static
 GBinderIpcTxPriv*
 gbinder_ipc_tx_custom_new(
     GBinderIpc* self,
-    gulong id,
     GBinderIpcTxFunc exec,
     GBinderIpcTxFunc done,
     GDestroyNotify destroy,
     void* user_data)
 {
-    GBinderIpcTxCustom* tx = g_slice_new0(GBinderIpcTxCustom);
-    GBinderIpcTxPriv* priv = &tx->tx;
+    GBinderIpcTxPriv* priv = gbinder_ipc_tx_alloc(self);
+    GBinderIpcTxCustom* tx;
+
+    if (!priv) {
+        return NULL;
+    }
 
-    gbinder_ipc_tx_pub_init(&priv->pub, self, id, user_data);
+    tx = gbinder_ipc_tx_custom_cast(priv);
+    gbinder_ipc_tx_pub_init(&priv->pub, self, user_data);
     priv->fn_exec = gbinder_ipc_tx_custom_exec;
     priv->fn_done = gbinder_ipc_tx_custom_done;
     priv->fn_free = gbinder_ipc_tx_custom_free;
@@ -919,48 +1863,155 @@ gbinder_ipc_tx_custom_new(
 static
 void
 gbinder_ipc_tx_free(
-    gpointer data)
+    GBinderIpcTxPriv* tx)
 {
-    GBinderIpcTxPriv* tx = data;
     GBinderIpcTx* pub = &tx->pub;
     GBinderIpc* self = pub->ipc;
     GBinderIpcPriv* priv = self->priv;
 
-    g_hash_table_remove(priv->tx_table, GINT_TO_POINTER(pub->id));
     tx->fn_free(tx);
+    gbinder_ipc_tx_release(priv, tx);
 
     /* This may actually deallocate GBinderIpc object: */
     gbinder_ipc_unref(self);
 }
 
 static
-gboolean
+void
 gbinder_ipc_tx_done(
-    gpointer data)
+    GBinderIpcTxPriv* tx)
 {
-    GBinderIpcTxPriv* tx = data;
     GBinderIpcTx* pub = &tx->pub;
-    GBinderIpc* self = pub->ipc;
-    GBinderIpcPriv* priv = self->priv;
+    GBinderIpcTxRecord* rec = gbinder_ipc_tx_record(tx);
 
-    if (g_hash_table_remove(priv->tx_table, GINT_TO_POINTER(tx->pub.id))) {
+    if (rec->pending) {
+        rec->pending = FALSE;
         GASSERT(!pub->cancelled);
         tx->fn_done(tx);
     }
+}
+
+/*
+ * Completed transactions are pushed by the worker threads to a lock-free
+ * stack and picked up by the main thread in batches. Only the thread
+ * which finds the stack empty needs to wake up the main thread.
+ */
+typedef struct gbinder_ipc_tx_done_source {
+    GSource source;
+    GBinderIpc* ipc; /* Not a reference! */
+} GBinderIpcTxDoneSource;
+
+static
+gboolean
+gbinder_ipc_tx_done_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    GBinderIpcTxDoneSource* done = G_CAST(source, GBinderIpcTxDoneSource,
+        source);
+    /* The last transaction may be holding the last reference */
+    GBinderIpc* self = gbinder_ipc_ref(done->ipc);
+    GBinderIpcPriv* priv = self->priv;
+    GBinderIpcTxPriv* stack;
+    guint n = 0;
+
+    /* Must be reset before picking up the stack to avoid losing wakeups */
+    g_source_set_ready_time(source, -1);
+    do {
+        stack = g_atomic_pointer_get(&priv->tx_done_stack);
+    } while (stack && !g_atomic_pointer_compare_and_exchange
+        (&priv->tx_done_stack, stack, NULL));
+
+    if (stack) {
+        /* Stack is LIFO, reverse it and append to the queue */
+        GBinderIpcTxPriv* first = NULL;
+        GBinderIpcTxPriv* last = stack;
+
+        while (stack) {
+            GBinderIpcTxPriv* next = stack->done_next;
+
+            stack->done_next = first;
+            first = stack;
+            stack = next;
+        }
+        if (priv->tx_done_last) {
+            priv->tx_done_last->done_next = first;
+        } else {
+            priv->tx_done_first = first;
+        }
+        priv->tx_done_last = last;
+    }
+
+    while (priv->tx_done_first && (!priv->tx_done_batch ||
+        n < priv->tx_done_batch)) {
+        GBinderIpcTxPriv* tx = priv->tx_done_first;
+
+        priv->tx_done_first = tx->done_next;
+        if (!priv->tx_done_first) {
+            priv->tx_done_last = NULL;
+        }
+        tx->done_next = NULL;
+        gbinder_ipc_tx_done(tx);
+        gbinder_ipc_tx_free(tx);
+        n++;
+    }
+
+    if (priv->tx_done_first) {
+        /* Give others a chance to run and come back */
+        g_source_set_ready_time(source, 0);
+    }
+
+    /* This may actually deallocate GBinderIpc object: */
+    gbinder_ipc_unref(self);
+    return G_SOURCE_CONTINUE;
+}
+
+static
+GSource*
+gbinder_ipc_tx_done_source_new(
+    GBinderIpc* self)
+{
+    static GSourceFuncs gbinder_ipc_tx_done_source_funcs = {
+        .dispatch = gbinder_ipc_tx_done_dispatch
+    };
+    GSource* source = g_source_new(&gbinder_ipc_tx_done_source_funcs,
+        sizeof(GBinderIpcTxDoneSource));
 
-    return G_SOURCE_REMOVE;
+    G_CAST(source, GBinderIpcTxDoneSource, source)->ipc = self;
+    g_source_set_priority(source, G_PRIORITY_DEFAULT);
+    g_source_attach(source, self->priv->context);
+    return source;
+}
+
+static
+void
+gbinder_ipc_tx_complete(
+    GBinderIpcTxPriv* tx)
+{
+    GBinderIpcPriv* priv = tx->pub.ipc->priv;
+    GBinderIpcTxPriv* first;
+
+    do {
+        first = g_atomic_pointer_get(&priv->tx_done_stack);
+        tx->done_next = first;
+    } while (!g_atomic_pointer_compare_and_exchange
+        (&priv->tx_done_stack, first, tx));
+
+    if (!first) {
+        /* Wake up the main thread */
+        g_source_set_ready_time(priv->tx_done_source, 0);
+    }
 }
 
-/* Invoked on a thread from tx_pool */
+/* Invoked on a thread from tx_pool or tx_pool_high */
 static
 void
 gbinder_ipc_tx_proc(
-    gpointer data,
-    gpointer object)
+    GBinderExecutorWork* work,
+    void* object)
 {
-    GBinderIpcTxPriv* tx = data;
-    GBinderIpc* self = GBINDER_IPC(object);
-    GBinderIpcPriv* priv = self->priv;
+    GBinderIpcTxPriv* tx = G_CAST(work, GBinderIpcTxPriv, work);
 
     if (!tx->pub.cancelled) {
         tx->fn_exec(tx);
@@ -969,8 +2020,7 @@ gbinder_ipc_tx_proc(
     }
 
     /* The result is handled by the main thread */
-    g_main_context_invoke_full(priv->context, G_PRIORITY_DEFAULT,
-        gbinder_ipc_tx_done, tx, gbinder_ipc_tx_free);
+    gbinder_ipc_tx_complete(tx);
 }
 
 /*==========================================================================*
@@ -1098,19 +2148,24 @@ gbinder_ipc_transact(
     GDestroyNotify destroy,
     void* user_data)
 {
-    if (G_LIKELY(self)) {
+    if (G_UNLIKELY(gbinder_local_request_in_buf(req))) {
+        /* The storage may be gone by the time it's sent */
+        GWARN("Can't send request from caller storage asynchronously");
+    } else if (G_LIKELY(self)) {
         GBinderIpcPriv* priv = self->priv;
         GBinderIpcTxPriv* tx = gbinder_ipc_tx_internal_new(self,
-            gbinder_ipc_tx_get_id(self), handle, code, flags, req, reply,
-            destroy, user_data);
-        const gulong id = tx->pub.id;
+            handle, code, flags, req, reply, destroy, user_data);
 
-        g_hash_table_insert(priv->tx_table, GINT_TO_POINTER(id), tx);
-        g_thread_pool_push(priv->tx_pool, tx, NULL);
-        return id;
-    } else {
-        return 0;
+        if (tx) {
+            const gulong id = tx->pub.id;
+
+            tx->executor = (flags & GBINDER_TX_FLAG_HIGH_PRIORITY) ?
+                priv->tx_pool_high : priv->tx_pool;
+            gbinder_executor_push(tx->executor, &tx->work);
+            return id;
+        }
     }
+    return 0;
 }
 
 gulong
@@ -1124,15 +2179,220 @@ gbinder_ipc_transact_custom(
     if (G_LIKELY(self)) {
         GBinderIpcPriv* priv = self->priv;
         GBinderIpcTxPriv* tx = gbinder_ipc_tx_custom_new(self,
-            gbinder_ipc_tx_get_id(self), exec, done, destroy, user_data);
-        const gulong id = tx->pub.id;
+            exec, done, destroy, user_data);
 
-        g_hash_table_insert(priv->tx_table, GINT_TO_POINTER(id), tx);
-        g_thread_pool_push(priv->tx_pool, tx, NULL);
-        return id;
-    } else {
-        return 0;
+        if (tx) {
+            const gulong id = tx->pub.id;
+
+            tx->executor = priv->tx_pool;
+            gbinder_executor_push(tx->executor, &tx->work);
+            return id;
+        }
+    }
+    return 0;
+}
+
+void
+gbinder_ipc_set_tx_done_batch(
+    GBinderIpc* self,
+    guint max)
+{
+    if (G_LIKELY(self)) {
+        self->priv->tx_done_batch = max;
+    }
+}
+
+void
+gbinder_ipc_set_max_pending_incoming(
+    GBinderIpc* self,
+    guint max,
+    gboolean drop_oneway)
+{
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+
+        priv->incoming_drop_oneway = drop_oneway;
+        gbinder_admission_set_limit(&priv->incoming, max);
+    }
+}
+
+void
+gbinder_ipc_set_fair_incoming(
+    GBinderIpc* self,
+    gboolean fair)
+{
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+
+        /* Transactions which are already queued are handled either way */
+        /* Lock */
+        g_mutex_lock(&priv->incoming_mutex);
+        priv->incoming_fair = (fair != FALSE);
+        g_mutex_unlock(&priv->incoming_mutex);
+        /* Unlock */
+    }
+}
+
+void
+gbinder_ipc_set_incoming_priority(
+    GBinderIpc* self,
+    int priority)
+{
+    if (G_LIKELY(self)) {
+        g_source_set_priority(self->priv->incoming_source, priority);
+    }
+}
+
+GBinderCallerStats*
+gbinder_ipc_get_caller_stats(
+    GBinderIpc* self,
+    guint* count)
+{
+    GBinderCallerStats* stats = NULL;
+    guint n = 0;
+
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+        GHashTableIter it;
+        gpointer value;
+
+        /* Lock */
+        g_mutex_lock(&priv->incoming_mutex);
+        n = g_hash_table_size(priv->callers);
+        if (n) {
+            GBinderCallerStats* ptr = stats = g_new(GBinderCallerStats, n);
+
+            g_hash_table_iter_init(&it, priv->callers);
+            while (g_hash_table_iter_next(&it, NULL, &value)) {
+                const GBinderIpcCaller* caller = value;
+
+                ptr->pid = caller->pid;
+                ptr->euid = caller->euid;
+                ptr->pending = caller->pending;
+                ptr->handled = caller->handled;
+                ptr->busy = caller->busy;
+                ptr++;
+            }
+        }
+        g_mutex_unlock(&priv->incoming_mutex);
+        /* Unlock */
+    }
+    if (count) {
+        *count = n;
+    }
+    return stats;
+}
+
+void
+gbinder_ipc_set_thread_params(
+    GBinderIpc* self,
+    GBINDER_THREADS threads,
+    const GBinderThreadParams* params)
+{
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+        GBinderSched* sched = gbinder_sched_new(params);
+        GSList* l;
+
+        switch (threads) {
+        case GBINDER_THREADS_LOOPER:
+            /* Lock */
+            g_mutex_lock(&priv->looper_mutex);
+            gbinder_sched_unref(priv->looper_sched);
+            priv->looper_sched = gbinder_sched_ref(sched);
+            /* Applied when the loopers wake up next time */
+            if (priv->looper) {
+                gbinder_sched_slot_set(&priv->looper->sched, sched);
+            }
+            for (l = priv->blocked_loopers; l; l = l->next) {
+                GBinderIpcLooper* looper = l->data;
+
+                gbinder_sched_slot_set(&looper->sched, sched);
+            }
+            g_mutex_unlock(&priv->looper_mutex);
+            /* Unlock */
+            break;
+        case GBINDER_THREADS_POOL:
+            gbinder_executor_set_sched(priv->tx_pool, sched);
+            gbinder_executor_set_sched(priv->tx_pool_high, sched);
+            break;
+        default:
+            GWARN("Unexpected thread kind %d", threads);
+            break;
+        }
+        gbinder_sched_unref(sched);
+    }
+}
+
+gboolean
+gbinder_ipc_prewarm(
+    GBinderIpc* self,
+    guint threads,
+    GBinderPrewarmStats* stats)
+{
+    if (G_LIKELY(self)) {
+        GBinderIpcPriv* priv = self->priv;
+        GBinderIpcTxPriv* tx;
+        GBinderPrewarmStats t;
+        gint64 start, now;
+
+        memset(&t, 0, sizeof(t));
+
+        /* Looper */
+        start = now = g_get_monotonic_time();
+        gbinder_ipc_looper_check(self);
+        t.looper = g_get_monotonic_time() - now;
+
+        /* Transaction threads (they stay alive from now on) */
+        now = g_get_monotonic_time();
+        gbinder_executor_set_min_threads(priv->tx_pool,
+            MAX(threads, GBINDER_IPC_PREWARM_TX_THREADS));
+        gbinder_executor_set_min_threads(priv->tx_pool_high,
+            GBINDER_IPC_PREWARM_HIGH_PRIORITY_TX_THREADS);
+        t.threads = g_get_monotonic_time() - now;
+
+        /* Tables */
+        now = g_get_monotonic_time();
+        /* Lock */
+        g_mutex_lock(&priv->remote_objects_mutex);
+        gbinder_ipc_remote_slot(priv, 0, TRUE); /* Context manager */
+        g_mutex_unlock(&priv->remote_objects_mutex);
+        /* Unlock */
+        /* Lock */
+        g_mutex_lock(&priv->local_objects_mutex);
+        if (!priv->local_objects[0]) {
+            g_atomic_pointer_set(priv->local_objects,
+                g_new0(GBinderIpcLocalSlot, GBINDER_IPC_LOCAL_CHUNK_SIZE));
+        }
+        g_mutex_unlock(&priv->local_objects_mutex);
+        /* Unlock */
+        if (!priv->tx_nchunks && (tx = gbinder_ipc_tx_alloc(self)) != NULL) {
+            gbinder_ipc_tx_release(priv, tx);
+        }
+        t.tables = g_get_monotonic_time() - now;
+        t.total = g_get_monotonic_time() - start;
+
+        GDEBUG("%s prewarmed in %lld us (looper %lld, threads %lld, "
+            "tables %lld)", gbinder_ipc_name(self), (long long)t.total,
+            (long long)t.looper, (long long)t.threads, (long long)t.tables);
+        if (stats) {
+            *stats = t;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+gbinder_ipc_get_incoming_stats(
+    GBinderIpc* self,
+    GBinderIncomingStats* stats)
+{
+    if (G_LIKELY(self) && G_LIKELY(stats)) {
+        gbinder_admission_get_stats(&self->priv->incoming, stats);
+        return TRUE;
     }
+    return FALSE;
 }
 
 void
@@ -1141,14 +2401,29 @@ gbinder_ipc_cancel(
     gulong id)
 {
     if (G_LIKELY(self) && G_LIKELY(id)) {
-        gconstpointer key = GINT_TO_POINTER(id);
-        GBinderIpcPriv* priv = self->priv;
-        GBinderIpcTx* tx = g_hash_table_lookup(priv->tx_table, key);
+        GBinderIpcTxPriv* tx = gbinder_ipc_tx_lookup(self->priv, id);
 
         if (tx) {
-            GVERIFY(g_hash_table_remove(priv->tx_table, key));
-            tx->cancelled = TRUE;
-            GVERBOSE_("%lu", id);
+            gbinder_ipc_tx_record(tx)->pending = FALSE;
+            tx->pub.cancelled = TRUE;
+            if (gbinder_executor_cancel(tx->executor, &tx->work)) {
+                /* Hasn't reached the worker thread, drop it right away */
+                GVERBOSE_("%lu (dequeued)", id);
+                g_atomic_int_set(&tx->state, GBINDER_IPC_TX_CANCELLED);
+                gbinder_ipc_ref(self);
+                gbinder_ipc_tx_free(tx);
+                gbinder_ipc_unref(self);
+            } else if (g_atomic_int_compare_and_exchange(&tx->state,
+                GBINDER_IPC_TX_PENDING, GBINDER_IPC_TX_CANCELLED)) {
+                /* In flight, let the worker finish it without us */
+                GVERBOSE_("%lu", id);
+                if (tx->fn_detach) {
+                    tx->fn_detach(tx);
+                }
+            } else {
+                /* Direct reply has already been (or is being) delivered */
+                GVERBOSE_("%lu (too late)", id);
+            }
         } else {
             GWARN("Invalid transaction id %lu", id);
         }
@@ -1174,15 +2449,28 @@ gbinder_ipc_init(
         GBinderIpcPriv);
 
     g_mutex_init(&priv->looper_mutex);
+    g_mutex_init(&priv->incoming_mutex);
     g_mutex_init(&priv->local_objects_mutex);
     g_mutex_init(&priv->remote_objects_mutex);
     priv->context = g_main_context_default();
-    priv->tx_table = g_hash_table_new(g_direct_hash, g_direct_equal);
-    priv->tx_pool = g_thread_pool_new(gbinder_ipc_tx_proc, self,
-        GBINDER_IPC_MAX_TX_THREADS, FALSE, NULL);
+    priv->tx_done_batch = GBINDER_IPC_DEFAULT_TX_DONE_BATCH;
+    g_queue_init(&priv->idle_callers);
+    priv->callers = g_hash_table_new_full(gbinder_ipc_caller_hash,
+        gbinder_ipc_caller_equal, NULL, gbinder_ipc_caller_free);
+    priv->tx_pool = gbinder_executor_new("gbinder-tx", gbinder_ipc_tx_proc,
+        self, GBINDER_IPC_MIN_TX_THREADS, GBINDER_IPC_MAX_TX_THREADS);
+    /*
+     * High priority transactions have their own threads, so that they
+     * don't get stuck in the queue behind the normal ones.
+     */
+    priv->tx_pool_high = gbinder_executor_new("gbinder-tx-high",
+        gbinder_ipc_tx_proc, self, GBINDER_IPC_MIN_HIGH_PRIORITY_TX_THREADS,
+        GBINDER_IPC_MAX_HIGH_PRIORITY_TX_THREADS);
     priv->object_registry.f = &object_registry_functions;
     priv->self = self;
     self->priv = priv;
+    priv->tx_done_source = gbinder_ipc_tx_done_source_new(self);
+    priv->incoming_source = gbinder_ipc_incoming_source_new(self);
     self->pool = gutil_idle_pool_new();
 }
 
@@ -1194,6 +2482,7 @@ gbinder_ipc_dispose(
     GBinderIpc* self = GBINDER_IPC(object);
     GBinderIpcPriv* priv = self->priv;
     GBinderIpcLooper* looper;
+    GSList* blocked;
 
     GVERBOSE_("%s", self->dev);
     /* Lock */
@@ -1215,22 +2504,19 @@ gbinder_ipc_dispose(
     /* Lock */
     g_mutex_lock(&priv->looper_mutex);
     looper = priv->looper;
+    blocked = priv->blocked_loopers;
     priv->looper = NULL;
+    priv->blocked_loopers = NULL;
     g_mutex_unlock(&priv->looper_mutex);
     /* Unlock */
 
     if (looper) {
-        if (looper->thread && looper->thread != g_thread_self()) {
-            guint8 done = TX_DONE;
-
-            GDEBUG("Stopping looper %s", gbinder_ipc_name(looper->ipc));
-            if (write(looper->pipefd[1], &done, sizeof(done)) > 0) {
-                g_thread_join(looper->thread);
-                looper->thread = NULL;
-            }
-        }
-        looper->ipc = NULL;
-        gbinder_ipc_looper_unref(looper);
+        gbinder_ipc_looper_stop(looper);
+    }
+    while (blocked) {
+        /* This completes the blocked request with an error */
+        gbinder_ipc_looper_stop(blocked->data);
+        blocked = g_slist_delete_link(blocked, blocked);
     }
 
     G_OBJECT_CLASS(gbinder_ipc_parent_class)->finalize(object);
@@ -1243,15 +2529,33 @@ gbinder_ipc_finalize(
 {
     GBinderIpc* self = GBINDER_IPC(object);
     GBinderIpcPriv* priv = self->priv;
-
-    GASSERT(!priv->local_objects);
-    GASSERT(!priv->remote_objects);
+    guint i;
+
+    GASSERT(!priv->local_count);
+    GASSERT(!priv->remote_count);
+    gbinder_ipc_remote_free_nodes(priv->remote_objects,
+        GBINDER_IPC_REMOTE_LEVELS);
+    for (i = 0; i < GBINDER_IPC_LOCAL_CHUNKS && priv->local_objects[i]; i++) {
+        g_free(priv->local_objects[i]);
+    }
+    gbinder_sched_unref(priv->looper_sched);
+    GASSERT(!priv->blocked_loopers);
+    GASSERT(!priv->incoming_first);
+    GASSERT(!priv->callers_first);
+    g_source_destroy(priv->incoming_source);
+    g_source_unref(priv->incoming_source);
+    g_hash_table_destroy(priv->callers);
+    g_mutex_clear(&priv->incoming_mutex);
     g_mutex_clear(&priv->looper_mutex);
     g_mutex_clear(&priv->local_objects_mutex);
     g_mutex_clear(&priv->remote_objects_mutex);
-    g_thread_pool_free(priv->tx_pool, FALSE, TRUE);
-    GASSERT(!g_hash_table_size(priv->tx_table));
-    g_hash_table_unref(priv->tx_table);
+    gbinder_executor_free(priv->tx_pool);
+    gbinder_executor_free(priv->tx_pool_high);
+    GASSERT(!priv->tx_done_stack);
+    GASSERT(!priv->tx_done_first);
+    g_source_destroy(priv->tx_done_source);
+    g_source_unref(priv->tx_done_source);
+    gbinder_ipc_tx_free_records(priv);
     gutil_idle_pool_unref(self->pool);
     gbinder_driver_unref(self->driver);
     g_free(priv->key);
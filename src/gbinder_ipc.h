@@ -139,15 +139,95 @@ gbinder_ipc_cancel(
     GBinderIpc* ipc,
     gulong id);
 
+/* Max number of completions delivered per main loop iteration, 0 = all */
+void
+gbinder_ipc_set_tx_done_batch(
+    GBinderIpc* ipc,
+    guint max);
+
+/*
+ * Fair scheduling queues incoming transactions per sender (pid and
+ * euid, one-way transactions have no pid) and handles them round-robin,
+ * so that a single sender can't starve the others. The returned array of stats is allocated with g_malloc.
+ */
+void
+gbinder_ipc_set_fair_incoming(
+    GBinderIpc* ipc,
+    gboolean fair);
+
+/*
+ * Priority of the source which delivers incoming transactions to the
+ * main thread, G_PRIORITY_DEFAULT_IDLE by default.
+ */
+void
+gbinder_ipc_set_incoming_priority(
+    GBinderIpc* ipc,
+    int priority);
+
+GBinderCallerStats*
+gbinder_ipc_get_caller_stats(
+    GBinderIpc* ipc,
+    guint* count);
+
+/*
+ * Parameters are applied by the threads themselves. Threads which are
+ * already running apply them when they wake up next time.
+ */
+void
+gbinder_ipc_set_thread_params(
+    GBinderIpc* ipc,
+    GBINDER_THREADS threads,
+    const GBinderThreadParams* params);
+
+/*
+ * Must be invoked on the main thread. Starts the looper and the
+ * transaction threads and allocates the tables which are otherwise
+ * allocated on the first call, so that the first transaction doesn't
+ * have to pay for all that.
+ */
+gboolean
+gbinder_ipc_prewarm(
+    GBinderIpc* ipc,
+    guint threads,
+    GBinderPrewarmStats* stats);
+
+/*
+ * Max number of incoming transactions waiting for the main thread,
+ * 0 = no limit. When the limit is reached, two-way transactions are
+ * rejected with -EBUSY and one-way transactions are either dropped
+ * or block the looper until the main thread catches up.
+ */
+void
+gbinder_ipc_set_max_pending_incoming(
+    GBinderIpc* ipc,
+    guint max,
+    gboolean drop_oneway);
+
+gboolean
+gbinder_ipc_get_incoming_stats(
+    GBinderIpc* ipc,
+    GBinderIncomingStats* stats);
+
+/* Internal for GBinderRemoteRequest */
+gboolean
+gbinder_ipc_looper_tx_block(
+    GBinderIpcLooperTx* tx);
+
+void
+gbinder_ipc_looper_tx_complete(
+    GBinderIpcLooperTx* tx,
+    GBinderLocalReply* reply,
+    int status);
+
 /* Internal for GBinderLocalObject */
 void
-gbinder_ipc_local_object_disposed(
+gbinder_ipc_local_object_released(
     GBinderIpc* self,
     GBinderLocalObject* obj);
 
 /* Internal for GBinderRemoteObject */
 void
-gbinder_ipc_remote_object_disposed(
+gbinder_ipc_remote_object_released(
     GBinderIpc* self,
     GBinderRemoteObject* obj);
 
@@ -30,10 +30,12 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "gbinder_admission.h"
 #include "gbinder_driver.h"
 #include "gbinder_ipc.h"
 #include "gbinder_local_object_p.h"
 #include "gbinder_local_reply_p.h"
+#include "gbinder_pool.h"
 #include "gbinder_remote_request.h"
 #include "gbinder_writer.h"
 #include "gbinder_log.h"
@@ -45,8 +47,21 @@ struct gbinder_local_object_priv {
     char* iface;
     GBinderLocalTransactFunc txproc;
     void* user_data;
+    GBinderAdmission incoming;
+    GBinderPool* reply_pool;
+    /* Refcount changes accumulated by the looper */
+    gint refs_pending;
+    gint refs_events;
+    gint weak_delta;
+    gint strong_delta;
+    /* References held by the kernel, see gbinder_local_object_node_ref() */
+    gint node_refs;
 };
 
+/* Bits of refs_events */
+#define REFS_EVENT_WEAK (0x01)
+#define REFS_EVENT_STRONG (0x02)
+
 G_DEFINE_TYPE(GBinderLocalObject, gbinder_local_object, G_TYPE_OBJECT)
 
 #define GBINDER_LOCAL_OBJECT_GET_CLASS(obj) \
@@ -56,11 +71,13 @@ G_DEFINE_TYPE(GBinderLocalObject, gbinder_local_object, G_TYPE_OBJECT)
 enum gbinder_local_object_signal {
     SIGNAL_WEAK_REFS_CHANGED,
     SIGNAL_STRONG_REFS_CHANGED,
+    SIGNAL_REFS_CHANGED,
     SIGNAL_COUNT
 };
 
 #define SIGNAL_WEAK_REFS_CHANGED_NAME    "weak_refs_changed"
 #define SIGNAL_STRONG_REFS_CHANGED_NAME  "strong_refs_changed"
+#define SIGNAL_REFS_CHANGED_NAME         "refs_changed"
 
 static guint gbinder_local_object_signals[SIGNAL_COUNT] = { 0 };
 
@@ -119,7 +136,8 @@ gbinder_local_object_hidl_ping_transaction(
 {
     /*android.hidl.base@1.0::IBase interfaceDescriptor() */
     const GBinderIo* io = gbinder_local_object_io(self);
-    GBinderLocalReply* reply = gbinder_local_reply_new(io);
+    GBinderLocalReply* reply = gbinder_local_reply_new_pooled
+        (self->priv->reply_pool, io);
     GBinderWriter writer;
 
     GVERBOSE("  HIDL_PING_TRANSACTION \"%s\"",
@@ -139,7 +157,8 @@ gbinder_local_object_hidl_get_descriptor_transaction(
 {
     /*android.hidl.base@1.0::IBase interfaceDescriptor() */
     const GBinderIo* io = gbinder_local_object_io(self);
-    GBinderLocalReply* reply = gbinder_local_reply_new(io);
+    GBinderLocalReply* reply = gbinder_local_reply_new_pooled
+        (self->priv->reply_pool, io);
     GBinderWriter writer;
 
     GVERBOSE("  HIDL_GET_DESCRIPTOR_TRANSACTION \"%s\"",
@@ -161,7 +180,8 @@ gbinder_local_object_hidl_descriptor_chain_transaction(
 {
     /*android.hidl.base@1.0::IBase interfaceChain() */
     const GBinderIo* io = gbinder_local_object_io(self);
-    GBinderLocalReply* reply = gbinder_local_reply_new(io);
+    GBinderLocalReply* reply = gbinder_local_reply_new_pooled
+        (self->priv->reply_pool, io);
     GBinderWriter writer;
     const char* chain[2];
     int n = 0;
@@ -207,71 +227,114 @@ gbinder_local_object_default_handle_looper_transaction(
 }
 
 static
-void
-gbinder_local_object_handle_later(
-    GBinderLocalObject* self,
-    GSourceFunc function)
+int
+gbinder_local_object_atomic_take(
+    gint* ptr)
 {
-    if (G_LIKELY(self)) {
-        GBinderLocalObjectPriv* priv = self->priv;
+    int value;
 
-        g_main_context_invoke_full(priv->context, G_PRIORITY_DEFAULT, function,
-            gbinder_local_object_ref(self), g_object_unref);
-    }
+    do {
+        value = g_atomic_int_get(ptr);
+    } while (!g_atomic_int_compare_and_exchange(ptr, value, 0));
+    return value;
 }
 
 static
 gboolean
-gbinder_local_object_handle_increfs_proc(
+gbinder_local_object_refs_changed_proc(
     gpointer local)
 {
     GBinderLocalObject* self = GBINDER_LOCAL_OBJECT(local);
-
-    self->weak_refs++;
-    g_signal_emit(self, gbinder_local_object_signals
-        [SIGNAL_WEAK_REFS_CHANGED], 0);
+    GBinderLocalObjectPriv* priv = self->priv;
+    int events, weak_delta, strong_delta;
+
+    /* Any change made after this point will schedule another callback */
+    g_atomic_int_set(&priv->refs_pending, FALSE);
+    events = gbinder_local_object_atomic_take(&priv->refs_events);
+    weak_delta = gbinder_local_object_atomic_take(&priv->weak_delta);
+    strong_delta = gbinder_local_object_atomic_take(&priv->strong_delta);
+
+    self->weak_refs += weak_delta;
+    self->strong_refs += strong_delta;
+    GASSERT(self->weak_refs >= 0);
+    GASSERT(self->strong_refs >= 0);
+    if (events & REFS_EVENT_WEAK) {
+        g_signal_emit(self, gbinder_local_object_signals
+            [SIGNAL_WEAK_REFS_CHANGED], 0);
+    }
+    if (events & REFS_EVENT_STRONG) {
+        g_signal_emit(self, gbinder_local_object_signals
+            [SIGNAL_STRONG_REFS_CHANGED], 0);
+    }
+    if (events) {
+        g_signal_emit(self, gbinder_local_object_signals
+            [SIGNAL_REFS_CHANGED], 0, weak_delta, strong_delta);
+    }
     return G_SOURCE_REMOVE;
 }
 
 static
-gboolean
-gbinder_local_object_handle_decrefs_proc(
-    gpointer local)
+void
+gbinder_local_object_unref_func(
+    gpointer self)
 {
-    GBinderLocalObject* self = GBINDER_LOCAL_OBJECT(local);
+    gbinder_local_object_unref(self);
+}
 
-    GASSERT(self->weak_refs > 0);
-    self->weak_refs--;
-    g_signal_emit(self, gbinder_local_object_signals
-        [SIGNAL_WEAK_REFS_CHANGED], 0);
-    return G_SOURCE_REMOVE;
+/*
+ * The kernel refers to the object by its pointer and expects the cookie
+ * to stay the same for as long as the node exists. That's only true as
+ * long as the object (and therefore its slot in GBinderIpc) is alive,
+ * so the object can't go away until BR_DECREFS and BR_RELEASE balance
+ * BR_INCREFS and BR_ACQUIRE, even if the app has dropped it.
+ */
+static
+void
+gbinder_local_object_node_ref(
+    GBinderLocalObject* self)
+{
+    if (!g_atomic_int_add(&self->priv->node_refs, 1)) {
+        gbinder_local_object_ref(self);
+    }
 }
 
 static
-gboolean
-gbinder_local_object_handle_acquire_proc(
-    gpointer local)
+void
+gbinder_local_object_node_unref(
+    GBinderLocalObject* self)
 {
-    GBinderLocalObject* self = GBINDER_LOCAL_OBJECT(local);
+    GBinderLocalObjectPriv* priv = self->priv;
 
-    self->strong_refs++;
-    g_signal_emit(self, gbinder_local_object_signals
-        [SIGNAL_STRONG_REFS_CHANGED], 0);
-    return G_SOURCE_REMOVE;
+    if (g_atomic_int_get(&priv->node_refs) > 0) {
+        if (g_atomic_int_dec_and_test(&priv->node_refs)) {
+            gbinder_local_object_unref(self);
+        }
+    } else {
+        GWARN("Unbalanced refcount command for %p", self);
+    }
 }
 
+/*
+ * Refcount changes arrive in bursts. They are accumulated by the looper
+ * and applied on the main thread by a single callback.
+ */
 static
-gboolean
-gbinder_local_object_handle_release_proc(
-    gpointer local)
+void
+gbinder_local_object_refs_changed(
+    GBinderLocalObject* self,
+    gint* delta,
+    int change,
+    int event)
 {
-    GBinderLocalObject* self = GBINDER_LOCAL_OBJECT(local);
+    GBinderLocalObjectPriv* priv = self->priv;
 
-    GASSERT(self->strong_refs > 0);
-    self->strong_refs--;
-    g_signal_emit(self, gbinder_local_object_signals
-        [SIGNAL_STRONG_REFS_CHANGED], 0);
-    return G_SOURCE_REMOVE;
+    g_atomic_int_add(delta, change);
+    g_atomic_int_or(&priv->refs_events, event);
+    if (g_atomic_int_compare_and_exchange(&priv->refs_pending, FALSE, TRUE)) {
+        g_main_context_invoke_full(priv->context, G_PRIORITY_DEFAULT,
+            gbinder_local_object_refs_changed_proc,
+            gbinder_local_object_ref(self), gbinder_local_object_unref_func);
+    }
 }
 
 /*==========================================================================*
@@ -291,6 +354,7 @@ gbinder_local_object_new(
             (GBINDER_TYPE_LOCAL_OBJECT, NULL);
         GBinderLocalObjectPriv* priv = self->priv;
 
+        g_atomic_int_set(&self->refcount, 1);
         self->ipc = gbinder_ipc_ref(ipc);
         self->iface = priv->iface = g_strdup(iface);
         priv->txproc = txproc;
@@ -305,7 +369,8 @@ gbinder_local_object_ref(
     GBinderLocalObject* self)
 {
     if (G_LIKELY(self)) {
-        g_object_ref(GBINDER_LOCAL_OBJECT(self));
+        GASSERT(self->refcount > 0);
+        g_atomic_int_inc(&self->refcount);
         return self;
     } else {
         return NULL;
@@ -317,7 +382,12 @@ gbinder_local_object_unref(
     GBinderLocalObject* self)
 {
     if (G_LIKELY(self)) {
-        g_object_unref(GBINDER_LOCAL_OBJECT(self));
+        GASSERT(self->refcount > 0);
+        if (g_atomic_int_dec_and_test(&self->refcount)) {
+            /* Once it's zero, GBinderIpc won't hand it out anymore */
+            gbinder_ipc_local_object_released(self->ipc, self);
+            g_object_unref(GBINDER_LOCAL_OBJECT(self));
+        }
     }
 }
 
@@ -331,7 +401,7 @@ gbinder_local_object_drop(
         /* Clear the transaction callback */
         priv->txproc = NULL;
         priv->user_data = NULL;
-        g_object_unref(GBINDER_LOCAL_OBJECT(self));
+        gbinder_local_object_unref(self);
     }
 }
 
@@ -340,11 +410,41 @@ gbinder_local_object_new_reply(
     GBinderLocalObject* self)
 {
     if (G_LIKELY(self)) {
-        return gbinder_local_reply_new(gbinder_local_object_io(self));
+        return gbinder_local_reply_new_pooled(self->priv->reply_pool,
+            gbinder_local_object_io(self));
     }
     return NULL;
 }
 
+void
+gbinder_local_object_set_max_pending(
+    GBinderLocalObject* self,
+    guint max)
+{
+    if (G_LIKELY(self)) {
+        gbinder_admission_set_limit(&self->priv->incoming, max);
+    }
+}
+
+gboolean
+gbinder_local_object_get_incoming_stats(
+    GBinderLocalObject* self,
+    GBinderIncomingStats* stats)
+{
+    if (G_LIKELY(self) && G_LIKELY(stats)) {
+        gbinder_admission_get_stats(&self->priv->incoming, stats);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+GBinderAdmission*
+gbinder_local_object_admission(
+    GBinderLocalObject* self)
+{
+    return &self->priv->incoming;
+}
+
 gulong
 gbinder_local_object_add_weak_refs_changed_handler(
     GBinderLocalObject* self,
@@ -365,6 +465,16 @@ gbinder_local_object_add_strong_refs_changed_handler(
         SIGNAL_STRONG_REFS_CHANGED_NAME, G_CALLBACK(func), user_data) : 0;
 }
 
+gulong
+gbinder_local_object_add_refs_changed_handler(
+    GBinderLocalObject* self,
+    GBinderLocalObjectRefsFunc func,
+    void* user_data)
+{
+    return (G_LIKELY(self) && G_LIKELY(func)) ? g_signal_connect(self,
+        SIGNAL_REFS_CHANGED_NAME, G_CALLBACK(func), user_data) : 0;
+}
+
 void
 gbinder_local_object_remove_handler(
     GBinderLocalObject* self,
@@ -424,32 +534,44 @@ void
 gbinder_local_object_handle_increfs(
     GBinderLocalObject* self)
 {
-    gbinder_local_object_handle_later(self,
-        gbinder_local_object_handle_increfs_proc);
+    if (G_LIKELY(self)) {
+        gbinder_local_object_node_ref(self);
+        gbinder_local_object_refs_changed(self, &self->priv->weak_delta, 1,
+            REFS_EVENT_WEAK);
+    }
 }
 
 void
 gbinder_local_object_handle_decrefs(
     GBinderLocalObject* self)
 {
-    gbinder_local_object_handle_later(self,
-        gbinder_local_object_handle_decrefs_proc);
+    if (G_LIKELY(self)) {
+        gbinder_local_object_refs_changed(self, &self->priv->weak_delta, -1,
+            REFS_EVENT_WEAK);
+        gbinder_local_object_node_unref(self);
+    }
 }
 
 void
 gbinder_local_object_handle_acquire(
     GBinderLocalObject* self)
 {
-    gbinder_local_object_handle_later(self,
-        gbinder_local_object_handle_acquire_proc);
+    if (G_LIKELY(self)) {
+        gbinder_local_object_node_ref(self);
+        gbinder_local_object_refs_changed(self, &self->priv->strong_delta, 1,
+            REFS_EVENT_STRONG);
+    }
 }
 
 void
 gbinder_local_object_handle_release(
     GBinderLocalObject* self)
 {
-    gbinder_local_object_handle_later(self,
-        gbinder_local_object_handle_release_proc);
+    if (G_LIKELY(self)) {
+        gbinder_local_object_refs_changed(self, &self->priv->strong_delta, -1,
+            REFS_EVENT_STRONG);
+        gbinder_local_object_node_unref(self);
+    }
 }
 
 /*==========================================================================*
@@ -465,20 +587,10 @@ gbinder_local_object_init(
         GBINDER_TYPE_LOCAL_OBJECT, GBinderLocalObjectPriv);
 
     priv->context = g_main_context_default();
+    priv->reply_pool = gbinder_local_reply_pool_new();
     self->priv = priv;
 }
 
-static
-void
-gbinder_local_object_dispose(
-    GObject* local)
-{
-    GBinderLocalObject* self = GBINDER_LOCAL_OBJECT(local);
-
-    gbinder_ipc_local_object_disposed(self->ipc, self);
-    G_OBJECT_CLASS(gbinder_local_object_parent_class)->dispose(local);
-}
-
 static
 void
 gbinder_local_object_finalize(
@@ -488,6 +600,7 @@ gbinder_local_object_finalize(
     GBinderLocalObjectPriv* priv = self->priv;
 
     gbinder_ipc_unref(self->ipc);
+    gbinder_pool_unref(priv->reply_pool);
     g_free(priv->iface);
     G_OBJECT_CLASS(gbinder_local_object_parent_class)->finalize(local);
 }
@@ -499,7 +612,6 @@ gbinder_local_object_class_init(
 {
     GObjectClass* object_class = G_OBJECT_CLASS(klass);
 
-    object_class->dispose = gbinder_local_object_dispose;
     object_class->finalize = gbinder_local_object_finalize;
 
     g_type_class_add_private(klass, sizeof(GBinderLocalObjectPriv));
@@ -518,6 +630,10 @@ gbinder_local_object_class_init(
         g_signal_new(SIGNAL_STRONG_REFS_CHANGED_NAME,
             G_OBJECT_CLASS_TYPE(klass), G_SIGNAL_RUN_FIRST, 0,
             NULL, NULL, NULL, G_TYPE_NONE, 0);
+    gbinder_local_object_signals[SIGNAL_REFS_CHANGED] =
+        g_signal_new(SIGNAL_REFS_CHANGED_NAME,
+            G_OBJECT_CLASS_TYPE(klass), G_SIGNAL_RUN_FIRST, 0,
+            NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_INT, G_TYPE_INT);
 }
 
 /*
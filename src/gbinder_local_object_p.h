@@ -50,14 +50,25 @@ void
     GBinderLocalObject* obj,
     void* user_data);
 
+/* Net changes since the last callback, always invoked on the main thread */
+typedef
+void
+(*GBinderLocalObjectRefsFunc)(
+    GBinderLocalObject* obj,
+    int weak_delta,
+    int strong_delta,
+    void* user_data);
+
 typedef struct gbinder_local_object_priv GBinderLocalObjectPriv;
 struct gbinder_local_object {
     GObject object;
     GBinderLocalObjectPriv* priv;
+    gint refcount; /* Holds the GObject reference while non-zero */
     GBinderIpc* ipc;
     const char* iface;
     gint weak_refs;
     gint strong_refs;
+    guint32 cookie; /* Assigned by GBinderIpc */
 };
 
 typedef enum gbinder_local_transaction_support {
@@ -107,6 +118,12 @@ gbinder_local_object_add_strong_refs_changed_handler(
     GBinderLocalObjectFunc func,
     void* user_data);
 
+gulong
+gbinder_local_object_add_refs_changed_handler(
+    GBinderLocalObject* obj,
+    GBinderLocalObjectRefsFunc func,
+    void* user_data);
+
 void
 gbinder_local_object_remove_handler(
     GBinderLocalObject* obj,
@@ -134,6 +151,11 @@ gbinder_local_object_handle_looper_transaction(
     guint flags,
     int* status);
 
+/* Counters of incoming transactions, updated by GBinderIpc */
+GBinderAdmission*
+gbinder_local_object_admission(
+    GBinderLocalObject* obj);
+
 void
 gbinder_local_object_handle_increfs(
     GBinderLocalObject* obj);
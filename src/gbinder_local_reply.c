@@ -32,6 +32,7 @@
 
 #include "gbinder_local_reply_p.h"
 #include "gbinder_output_data.h"
+#include "gbinder_pool.h"
 #include "gbinder_writer_p.h"
 #include "gbinder_log.h"
 
@@ -42,8 +43,12 @@ struct gbinder_local_reply {
     gint refcount;
     GBinderWriterData data;
     GBinderOutputData out;
+    GBinderPool* pool;
 };
 
+/* Number of idle replies kept by each pool */
+#define GBINDER_LOCAL_REPLY_POOL_SIZE (4)
+
 GBINDER_INLINE_FUNC
 GBinderLocalReply*
 gbinder_local_reply_output_cast(
@@ -68,6 +73,14 @@ gbinder_local_reply_output_buffers_size(
     return gbinder_local_reply_output_cast(out)->data.buffers_size;
 }
 
+static
+void
+gbinder_local_reply_output_consumed(
+    GBinderOutputData* out)
+{
+    gbinder_cleanup_reset(gbinder_local_reply_output_cast(out)->data.consumed);
+}
+
 GBinderLocalReply*
 gbinder_local_reply_new(
     const GBinderIo* io)
@@ -80,7 +93,8 @@ gbinder_local_reply_new(
 
         static const GBinderOutputDataFunctions local_reply_output_fn = {
             .offsets = gbinder_local_reply_output_offsets,
-            .buffers_size = gbinder_local_reply_output_buffers_size
+            .buffers_size = gbinder_local_reply_output_buffers_size,
+            .consumed = gbinder_local_reply_output_consumed
         };
 
         g_atomic_int_set(&self->refcount, 1);
@@ -101,10 +115,65 @@ gbinder_local_reply_free(
 
     gutil_int_array_free(data->offsets, TRUE);
     g_byte_array_free(data->bytes, TRUE);
+    gbinder_cleanup_free(data->consumed);
     gbinder_cleanup_free(data->cleanup);
+    gbinder_arena_free(data->arena);
+    if (data->slots) {
+        g_array_free(data->slots, TRUE);
+    }
     g_slice_free(GBinderLocalReply, self);
 }
 
+static
+void
+gbinder_local_reply_pool_free_item(
+    gpointer item)
+{
+    gbinder_local_reply_free(item);
+}
+
+static
+void
+gbinder_local_reply_recycle(
+    GBinderLocalReply* self)
+{
+    GBinderPool* pool = self->pool;
+
+    self->pool = NULL;
+    gbinder_local_reply_reset(self);
+    if (!gbinder_pool_put(pool, self)) {
+        gbinder_local_reply_free(self);
+    }
+    gbinder_pool_unref(pool);
+}
+
+GBinderPool*
+gbinder_local_reply_pool_new(
+    void)
+{
+    return gbinder_pool_new(GBINDER_LOCAL_REPLY_POOL_SIZE,
+        gbinder_local_reply_pool_free_item);
+}
+
+GBinderLocalReply*
+gbinder_local_reply_new_pooled(
+    GBinderPool* pool,
+    const GBinderIo* io)
+{
+    GBinderLocalReply* self = gbinder_pool_take(pool);
+
+    if (self) {
+        GASSERT(self->data.io == io);
+        g_atomic_int_set(&self->refcount, 1);
+    } else {
+        self = gbinder_local_reply_new(io);
+    }
+    if (self) {
+        self->pool = gbinder_pool_ref(pool);
+    }
+    return self;
+}
+
 GBinderLocalReply*
 gbinder_local_reply_ref(
     GBinderLocalReply* self)
@@ -123,7 +192,11 @@ gbinder_local_reply_unref(
     if (G_LIKELY(self)) {
         GASSERT(self->refcount > 0);
         if (g_atomic_int_dec_and_test(&self->refcount)) {
-            gbinder_local_reply_free(self);
+            if (self->pool) {
+                gbinder_local_reply_recycle(self);
+            } else {
+                gbinder_local_reply_free(self);
+            }
         }
     }
 }
@@ -150,6 +223,18 @@ gbinder_local_reply_cleanup(
     }
 }
 
+void
+gbinder_local_reply_reset(
+    GBinderLocalReply* self)
+{
+    if (G_LIKELY(self)) {
+        GBinderWriterData* data = &self->data;
+
+        gbinder_writer_data_reset(data, 0);
+        self->out.bytes = data->bytes;
+    }
+}
+
 void
 gbinder_local_reply_init_writer(
     GBinderLocalReply* self,
@@ -41,6 +41,15 @@ GBinderLocalReply*
 gbinder_local_reply_new(
     const GBinderIo* io);
 
+GBinderPool*
+gbinder_local_reply_pool_new(
+    void);
+
+GBinderLocalReply*
+gbinder_local_reply_new_pooled(
+    GBinderPool* pool,
+    const GBinderIo* io);
+
 GBinderOutputData*
 gbinder_local_reply_data(
     GBinderLocalReply* reply);
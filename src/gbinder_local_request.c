@@ -32,6 +32,7 @@
 
 #include "gbinder_local_request_p.h"
 #include "gbinder_output_data.h"
+#include "gbinder_pool.h"
 #include "gbinder_writer_p.h"
 #include "gbinder_log.h"
 
@@ -42,8 +43,18 @@ struct gbinder_local_request {
     gint refcount;
     GBinderWriterData data;
     GBinderOutputData out;
+    gsize header_size;
+    GBinderPool* pool;
+    /* Requests used as templates keep a pool of their instances */
+    GBinderLocalRequest* tmpl;
+    GBinderPool* instances;
+    /* The request itself lives in the caller provided storage */
+    gboolean in_buf;
 };
 
+/* Number of idle requests kept by each pool */
+#define GBINDER_LOCAL_REQUEST_POOL_SIZE (4)
+
 GBINDER_INLINE_FUNC
 GBinderLocalRequest*
 gbinder_local_request_output_cast(
@@ -68,39 +79,119 @@ gbinder_local_request_output_buffers_size(
     return gbinder_local_request_output_cast(out)->data.buffers_size;
 }
 
+static
+void
+gbinder_local_request_output_consumed(
+    GBinderOutputData* out)
+{
+    GBinderWriterData* data = &gbinder_local_request_output_cast(out)->data;
+
+    if (data->consumed) {
+        gbinder_cleanup_reset(data->consumed);
+        data->spent = TRUE;
+    }
+}
+
+static
+gboolean
+gbinder_local_request_output_spent(
+    GBinderOutputData* out)
+{
+    return gbinder_local_request_output_cast(out)->data.spent;
+}
+
 GBinderLocalRequest*
 gbinder_local_request_new(
     const GBinderIo* io,
     GBytes* init)
+{
+    return gbinder_local_request_new_sized(io, init, 0);
+}
+
+static
+void
+gbinder_local_request_init(
+    GBinderLocalRequest* self,
+    const GBinderIo* io)
+{
+    static const GBinderOutputDataFunctions local_request_output_fn = {
+        .offsets = gbinder_local_request_output_offsets,
+        .buffers_size = gbinder_local_request_output_buffers_size,
+        .consumed = gbinder_local_request_output_consumed,
+        .spent = gbinder_local_request_output_spent
+    };
+
+    g_atomic_int_set(&self->refcount, 1);
+    self->data.io = io;
+    self->out.f = &local_request_output_fn;
+}
+
+GBinderLocalRequest*
+gbinder_local_request_new_sized(
+    const GBinderIo* io,
+    GBytes* init,
+    gsize size_hint)
 {
     GASSERT(io);
     if (io) {
         GBinderLocalRequest* self = g_slice_new0(GBinderLocalRequest);
         GBinderWriterData* writer = &self->data;
-        GBinderOutputData* out = &self->out;
 
-        static const GBinderOutputDataFunctions local_request_output_fn = {
-            .offsets = gbinder_local_request_output_offsets,
-            .buffers_size = gbinder_local_request_output_buffers_size
-        };
-
-        g_atomic_int_set(&self->refcount, 1);
-        writer->io = io;
+        gbinder_local_request_init(self, io);
         if (init) {
             gsize size;
             gconstpointer data = g_bytes_get_data(init, &size);
-            writer->bytes = g_byte_array_sized_new(size);
+            writer->bytes = g_byte_array_sized_new(MAX(size, size_hint));
             g_byte_array_append(writer->bytes, data, size);
+            self->header_size = size;
         } else {
-            writer->bytes = g_byte_array_new();
+            writer->bytes = g_byte_array_sized_new(size_hint);
         }
-        out->f = &local_request_output_fn;
-        out->bytes = writer->bytes;
+        self->out.bytes = writer->bytes;
         return self;
     }
     return NULL;
 }
 
+GBinderLocalRequest*
+gbinder_local_request_new_in_buf(
+    const GBinderIo* io,
+    GBytes* init,
+    void* buf,
+    gsize size)
+{
+    /* The request structure goes first, followed by the data */
+    guint8* start = (guint8*)G_ALIGN8(GPOINTER_TO_SIZE(buf));
+    const gsize skip = (start - (guint8*)buf) + sizeof(GBinderLocalRequest);
+    gsize init_size = 0;
+    gconstpointer init_data = init ? g_bytes_get_data(init, &init_size) : NULL;
+
+    GASSERT(io);
+    if (io && buf && size >= skip + init_size) {
+        GBinderLocalRequest* self = (GBinderLocalRequest*)start;
+        GBinderWriterData* writer = &self->data;
+
+        memset(self, 0, sizeof(*self));
+        gbinder_local_request_init(self, io);
+        self->in_buf = TRUE;
+        gbinder_writer_data_init_buf(writer, start + sizeof(*self),
+            size - skip);
+        gbinder_writer_data_append(writer, init_data, init_size);
+        self->header_size = init_size;
+        self->out.bytes = writer->bytes;
+        return self;
+    }
+    /* Not even the header fits, use the heap */
+    return gbinder_local_request_new_sized(io, init, size);
+}
+
+gboolean
+gbinder_local_request_in_buf(
+    GBinderLocalRequest* self)
+{
+    return G_LIKELY(self) && self->in_buf;
+}
+
 static
 void
 gbinder_local_request_free(
@@ -108,10 +199,101 @@ gbinder_local_request_free(
 {
     GBinderWriterData* data = &self->data;
 
-    g_byte_array_free(data->bytes, TRUE);
+    gbinder_writer_data_free_bytes(data);
     gutil_int_array_free(data->offsets, TRUE);
+    gbinder_cleanup_free(data->consumed);
     gbinder_cleanup_free(data->cleanup);
-    g_slice_free(GBinderLocalRequest, self);
+    gbinder_arena_free(data->arena);
+    if (data->slots) {
+        g_array_free(data->slots, TRUE);
+    }
+    gbinder_pool_unref(self->instances);
+    gbinder_local_request_unref(self->tmpl);
+    if (!self->in_buf) {
+        g_slice_free(GBinderLocalRequest, self);
+    }
+}
+
+static
+void
+gbinder_local_request_pool_free_item(
+    gpointer item)
+{
+    gbinder_local_request_free(item);
+}
+
+static
+void
+gbinder_local_request_recycle(
+    GBinderLocalRequest* self)
+{
+    GBinderPool* pool = self->pool;
+    GBinderLocalRequest* tmpl = self->tmpl;
+
+    self->pool = NULL;
+    self->tmpl = NULL;
+    gbinder_local_request_reset(self);
+    if (!gbinder_pool_put(pool, self)) {
+        gbinder_local_request_free(self);
+    }
+    gbinder_pool_unref(pool);
+    gbinder_local_request_unref(tmpl);
+}
+
+static
+GBinderPool*
+gbinder_local_request_instance_pool(
+    GBinderLocalRequest* self)
+{
+    GBinderPool* pool = g_atomic_pointer_get(&self->instances);
+
+    if (!pool) {
+        GBinderPool* new_pool = gbinder_local_request_pool_new();
+
+        if (g_atomic_pointer_compare_and_exchange(&self->instances,
+            NULL, new_pool)) {
+            pool = new_pool;
+        } else {
+            /* Another thread got there first */
+            gbinder_pool_unref(new_pool);
+            pool = g_atomic_pointer_get(&self->instances);
+        }
+    }
+    return pool;
+}
+
+GBinderPool*
+gbinder_local_request_pool_new(
+    void)
+{
+    return gbinder_pool_new(GBINDER_LOCAL_REQUEST_POOL_SIZE,
+        gbinder_local_request_pool_free_item);
+}
+
+GBinderLocalRequest*
+gbinder_local_request_new_pooled(
+    GBinderPool* pool,
+    const GBinderIo* io,
+    GBytes* init,
+    gsize size_hint)
+{
+    GBinderLocalRequest* self = gbinder_pool_take(pool);
+
+    if (self) {
+        GByteArray* bytes = self->data.bytes;
+
+        GASSERT(self->data.io == io);
+        g_atomic_int_set(&self->refcount, 1);
+        if (size_hint > bytes->len) {
+            gbinder_writer_data_reserve(&self->data, size_hint - bytes->len);
+        }
+    } else {
+        self = gbinder_local_request_new_sized(io, init, size_hint);
+    }
+    if (self) {
+        self->pool = gbinder_pool_ref(pool);
+    }
+    return self;
 }
 
 GBinderLocalRequest*
@@ -132,7 +314,11 @@ gbinder_local_request_unref(
     if (G_LIKELY(self)) {
         GASSERT(self->refcount > 0);
         if (g_atomic_int_dec_and_test(&self->refcount)) {
-            gbinder_local_request_free(self);
+            if (self->pool) {
+                gbinder_local_request_recycle(self);
+            } else {
+                gbinder_local_request_free(self);
+            }
         }
     }
 }
@@ -141,7 +327,12 @@ GBinderOutputData*
 gbinder_local_request_data(
     GBinderLocalRequest* self)
 {
-    return G_LIKELY(self) ? &self->out :  NULL;
+    if (G_LIKELY(self)) {
+        /* Data may have moved from the caller's storage to the heap */
+        self->out.bytes = self->data.bytes;
+        return &self->out;
+    }
+    return NULL;
 }
 
 void
@@ -159,6 +350,97 @@ gbinder_local_request_cleanup(
     }
 }
 
+void
+gbinder_local_request_reset(
+    GBinderLocalRequest* self)
+{
+    if (G_LIKELY(self)) {
+        GBinderWriterData* data = &self->data;
+
+        gbinder_writer_data_reset(data, self->header_size);
+        self->out.bytes = data->bytes;
+        gbinder_pool_unref(self->instances);
+        self->instances = NULL;
+    }
+}
+
+GBinderLocalRequest*
+gbinder_local_request_instantiate(
+    GBinderLocalRequest* tmpl)
+{
+    if (G_LIKELY(tmpl)) {
+        const GBinderWriterData* src = &tmpl->data;
+        GBinderLocalRequest* self = gbinder_local_request_new_pooled
+            (gbinder_local_request_instance_pool(tmpl), src->io, NULL,
+                src->bytes->len);
+        GBinderWriterData* dest = &self->data;
+
+        /* Buffer objects keep pointing to the memory owned by template */
+        g_byte_array_set_size(dest->bytes, 0);
+        g_byte_array_append(dest->bytes, src->bytes->data, src->bytes->len);
+        if (src->offsets && src->offsets->count) {
+            guint i;
+
+            if (!dest->offsets) {
+                dest->offsets = gutil_int_array_sized_new
+                    (src->offsets->count);
+            }
+            for (i = 0; i < src->offsets->count; i++) {
+                gutil_int_array_append(dest->offsets, src->offsets->data[i]);
+            }
+        }
+        dest->buffers_size = src->buffers_size;
+        self->header_size = tmpl->header_size;
+        self->tmpl = gbinder_local_request_ref(tmpl);
+        return self;
+    }
+    return NULL;
+}
+
+static
+gboolean
+gbinder_local_request_patch(
+    GBinderLocalRequest* self,
+    guint slot,
+    const void* value,
+    guint size)
+{
+    /* Instances share the slots with their template */
+    return gbinder_writer_data_patch(&self->data, self->tmpl ?
+        self->tmpl->data.slots : self->data.slots, slot, value, size);
+}
+
+gboolean
+gbinder_local_request_patch_int32(
+    GBinderLocalRequest* self,
+    guint slot,
+    guint32 value)
+{
+    return G_LIKELY(self) &&
+        gbinder_local_request_patch(self, slot, &value, sizeof(value));
+}
+
+gboolean
+gbinder_local_request_patch_int64(
+    GBinderLocalRequest* self,
+    guint slot,
+    guint64 value)
+{
+    return G_LIKELY(self) &&
+        gbinder_local_request_patch(self, slot, &value, sizeof(value));
+}
+
+GBinderLocalRequest*
+gbinder_local_request_reserve(
+    GBinderLocalRequest* self,
+    gsize size)
+{
+    if (G_LIKELY(self)) {
+        gbinder_writer_data_reserve(&self->data, size);
+    }
+    return self;
+}
+
 void
 gbinder_local_request_init_writer(
     GBinderLocalRequest* self,
@@ -42,6 +42,45 @@ gbinder_local_request_new(
     const GBinderIo* io,
     GBytes* init);
 
+/* The buffer can hold size_hint bytes without reallocation */
+GBinderLocalRequest*
+gbinder_local_request_new_sized(
+    const GBinderIo* io,
+    GBytes* init,
+    gsize size_hint);
+
+/*
+ * The request (including its data, as long as they fit) is placed in
+ * the caller provided storage which must outlive it. If the storage is
+ * too small even for the header, the request is allocated from the heap.
+ */
+GBinderLocalRequest*
+gbinder_local_request_new_in_buf(
+    const GBinderIo* io,
+    GBytes* init,
+    void* buf,
+    gsize size);
+
+/* Such requests can only be sent synchronously */
+gboolean
+gbinder_local_request_in_buf(
+    GBinderLocalRequest* req);
+
+/*
+ * Requests returned to the pool are reset to their init (header) data,
+ * which must therefore be the same for all requests sharing the pool.
+ */
+GBinderPool*
+gbinder_local_request_pool_new(
+    void);
+
+GBinderLocalRequest*
+gbinder_local_request_new_pooled(
+    GBinderPool* pool,
+    const GBinderIo* io,
+    GBytes* init,
+    gsize size_hint);
+
 GBinderOutputData*
 gbinder_local_request_data(
     GBinderLocalRequest* req);
@@ -39,7 +39,7 @@ typedef struct gbinder_object_registry_functions {
     void (*ref)(GBinderObjectRegistry* reg);
     void (*unref)(GBinderObjectRegistry* reg);
     GBinderLocalObject* (*get_local)(GBinderObjectRegistry* reg,
-        void* pointer);
+        void* pointer, guint64 cookie);
     GBinderRemoteObject* (*get_remote)(GBinderObjectRegistry* reg,
         guint32 handle);
 } GBinderObjectRegistryFunctions;
@@ -72,9 +72,10 @@ GBINDER_INLINE_FUNC
 GBinderLocalObject*
 gbinder_object_registry_get_local(
     GBinderObjectRegistry* reg,
-    void* pointer)
+    void* pointer,
+    guint64 cookie)
 {
-    return reg ? reg->f->get_local(reg, pointer) : NULL;
+    return reg ? reg->f->get_local(reg, pointer, cookie) : NULL;
 }
 
 GBINDER_INLINE_FUNC
@@ -45,6 +45,8 @@ struct gbinder_output_data {
 struct gbinder_output_data_functions {
     GUtilIntArray* (*offsets)(GBinderOutputData* data);
     gsize (*buffers_size)(GBinderOutputData* data);
+    void (*consumed)(GBinderOutputData* data);
+    gboolean (*spent)(GBinderOutputData* data);
 };
 
 /* Inline wrappers */
@@ -65,6 +67,26 @@ gbinder_output_data_buffers_size(
     return data ? data->f->buffers_size(data) : 0;
 }
 
+/* The driver has copied the data, referenced memory can be released */
+GBINDER_INLINE_FUNC
+void
+gbinder_output_data_consumed(
+    GBinderOutputData* data)
+{
+    if (data && data->f->consumed) {
+        data->f->consumed(data);
+    }
+}
+
+/* The data has been sent and the buffers it referenced are gone */
+GBINDER_INLINE_FUNC
+gboolean
+gbinder_output_data_spent(
+    GBinderOutputData* data)
+{
+    return data && data->f->spent && data->f->spent(data);
+}
+
 #endif /* GBINDER_OUTPUT_DATA_H */
 
 /*
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gbinder_pool.h"
+#include "gbinder_log.h"
+
+struct gbinder_pool {
+    gint refcount;
+    GMutex mutex;
+    GDestroyNotify free_item;
+    guint max_count;
+    guint count;
+    gpointer* items;
+};
+
+GBinderPool*
+gbinder_pool_new(
+    guint max_count,
+    GDestroyNotify free_item)
+{
+    GBinderPool* self = g_slice_new0(GBinderPool);
+
+    g_atomic_int_set(&self->refcount, 1);
+    g_mutex_init(&self->mutex);
+    self->free_item = free_item;
+    self->max_count = max_count;
+    self->items = g_new(gpointer, max_count);
+    return self;
+}
+
+static
+void
+gbinder_pool_free(
+    GBinderPool* self)
+{
+    guint i;
+
+    for (i = 0; i < self->count; i++) {
+        self->free_item(self->items[i]);
+    }
+    g_free(self->items);
+    g_mutex_clear(&self->mutex);
+    g_slice_free(GBinderPool, self);
+}
+
+GBinderPool*
+gbinder_pool_ref(
+    GBinderPool* self)
+{
+    if (G_LIKELY(self)) {
+        GASSERT(self->refcount > 0);
+        g_atomic_int_inc(&self->refcount);
+    }
+    return self;
+}
+
+void
+gbinder_pool_unref(
+    GBinderPool* self)
+{
+    if (G_LIKELY(self)) {
+        GASSERT(self->refcount > 0);
+        if (g_atomic_int_dec_and_test(&self->refcount)) {
+            gbinder_pool_free(self);
+        }
+    }
+}
+
+gpointer
+gbinder_pool_take(
+    GBinderPool* self)
+{
+    gpointer item = NULL;
+
+    if (G_LIKELY(self)) {
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        if (self->count > 0) {
+            item = self->items[--self->count];
+        }
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+    return item;
+}
+
+gboolean
+gbinder_pool_put(
+    GBinderPool* self,
+    gpointer item)
+{
+    gboolean taken = FALSE;
+
+    if (G_LIKELY(self)) {
+        /* Lock */
+        g_mutex_lock(&self->mutex);
+        if (self->count < self->max_count) {
+            self->items[self->count++] = item;
+            taken = TRUE;
+        }
+        g_mutex_unlock(&self->mutex);
+        /* Unlock */
+    }
+    return taken;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
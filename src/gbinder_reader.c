@@ -350,6 +350,188 @@ gbinder_reader_read_hidl_string_vec(
     return NULL;
 }
 
+/*
+ * The data returned by the functions below point directly to the
+ * received buffer. Embedded buffers are checked against the pointers
+ * found in their parents. Nothing is allocated other than temporary
+ * GBinderBuffer wrappers.
+ */
+static
+gboolean
+gbinder_reader_read_buffer_data(
+    GBinderReader* reader,
+    gconstpointer* data,
+    gsize* size)
+{
+    GBinderBuffer* buf = gbinder_reader_read_buffer(reader);
+
+    if (buf) {
+        *data = buf->data;
+        *size = buf->size;
+        gbinder_buffer_free(buf);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static
+gboolean
+gbinder_reader_read_hidl_fields(
+    GBinderReader* reader,
+    gconstpointer base,
+    gsize count,
+    const GBinderHidlType* type);
+
+static
+gboolean
+gbinder_reader_read_hidl_vec_data(
+    GBinderReader* reader,
+    const HidlVec* vec,
+    const GBinderHidlType* type)
+{
+    if (vec->data.ptr) {
+        gconstpointer data;
+        gsize size;
+
+        if (!gbinder_reader_read_buffer_data(reader, &data, &size) ||
+            data != vec->data.ptr || size != vec->count * type->size ||
+            !gbinder_reader_read_hidl_fields(reader, data, vec->count,
+                type)) {
+            GWARN("Invalid hidl_vec<%s>", type->name ? type->name : "?");
+            return FALSE;
+        }
+    } else if (vec->count) {
+        GWARN("Invalid hidl_vec<%s> (NULL data)", type->name ?
+            type->name : "?");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static
+gboolean
+gbinder_reader_read_hidl_fields(
+    GBinderReader* reader,
+    gconstpointer base,
+    gsize count,
+    const GBinderHidlType* type)
+{
+    gsize i;
+
+    for (i = 0; i < count; i++) {
+        const guint8* ptr = (const guint8*)base + i * type->size;
+        const GBinderHidlField* field;
+
+        for (field = type->fields;
+            field && field->kind != GBINDER_HIDL_FIELD_KIND_END;
+            field++) {
+            const guint8* fptr = ptr + field->offset;
+
+            switch (field->kind) {
+            case GBINDER_HIDL_FIELD_KIND_STRING:
+                {
+                    const HidlString* str = (const HidlString*)fptr;
+
+                    if (str->data.str) {
+                        gconstpointer data;
+                        gsize size;
+
+                        if (!gbinder_reader_read_buffer_data(reader,
+                            &data, &size) || data != str->data.str ||
+                            size != str->len + 1 || str->data.str[str->len]) {
+                            GWARN("Invalid hidl_string");
+                            return FALSE;
+                        }
+                    }
+                }
+                break;
+            case GBINDER_HIDL_FIELD_KIND_VEC:
+                if (!gbinder_reader_read_hidl_vec_data(reader,
+                    (const HidlVec*)fptr, field->type)) {
+                    return FALSE;
+                }
+                break;
+            case GBINDER_HIDL_FIELD_KIND_STRUCT:
+                if (!gbinder_reader_read_hidl_fields(reader, fptr, 1,
+                    field->type)) {
+                    return FALSE;
+                }
+                break;
+            case GBINDER_HIDL_FIELD_KIND_END:
+                break;
+            }
+        }
+    }
+    return TRUE;
+}
+
+static
+gboolean
+gbinder_reader_read_hidl_vec_impl(
+    GBinderReader* reader,
+    const GBinderHidlType* type,
+    gconstpointer* out_data,
+    gsize* out_count)
+{
+    gconstpointer data;
+    gsize size;
+
+    /* First buffer contains hidl_vec, then the elements (if any) */
+    if (gbinder_reader_read_buffer_data(reader, &data, &size) &&
+        size == sizeof(HidlVec)) {
+        const HidlVec* vec = data;
+
+        if (gbinder_reader_read_hidl_vec_data(reader, vec, type)) {
+            if (out_data) *out_data = vec->data.ptr;
+            if (out_count) *out_count = vec->count;
+            return TRUE;
+        }
+    }
+    if (out_data) *out_data = NULL;
+    if (out_count) *out_count = 0;
+    return FALSE;
+}
+
+gboolean
+gbinder_reader_read_hidl_vec(
+    GBinderReader* reader,
+    gsize elemsize,
+    gconstpointer* data,
+    gsize* count)
+{
+    GBinderHidlType type;
+
+    memset(&type, 0, sizeof(type));
+    type.size = elemsize;
+    return gbinder_reader_read_hidl_vec_impl(reader, &type, data, count);
+}
+
+gboolean
+gbinder_reader_read_hidl_struct_vec(
+    GBinderReader* reader,
+    const GBinderHidlType* type,
+    gconstpointer* data,
+    gsize* count)
+{
+    return gbinder_reader_read_hidl_vec_impl(reader, type, data, count);
+}
+
+gconstpointer
+gbinder_reader_read_hidl_struct(
+    GBinderReader* reader,
+    const GBinderHidlType* type)
+{
+    gconstpointer data;
+    gsize size;
+
+    if (gbinder_reader_read_buffer_data(reader, &data, &size) &&
+        size == type->size &&
+        gbinder_reader_read_hidl_fields(reader, data, 1, type)) {
+        return data;
+    }
+    return NULL;
+}
+
 const char*
 gbinder_reader_read_string8(
     GBinderReader* reader)
@@ -374,6 +556,213 @@ gbinder_reader_read_string8(
     return NULL;
 }
 
+gboolean
+gbinder_reader_read_byte_array(
+    GBinderReader* reader,
+    gconstpointer* data,
+    gsize* len)
+{
+    GBinderReaderPriv* p = gbinder_reader_cast(reader);
+
+    if ((p->ptr + 4) <= p->end) {
+        const gint32 n = *(gint32*)p->ptr;
+
+        if (n == -1) {
+            /* NULL array */
+            p->ptr += 4;
+            if (data) *data = NULL;
+            if (len) *len = 0;
+            return TRUE;
+        } else if (n >= 0 && (gsize)(p->end - p->ptr - 4) >= G_ALIGN4(n)) {
+            /* The data are not copied */
+            if (data) *data = p->ptr + 4;
+            if (len) *len = n;
+            p->ptr += 4 + G_ALIGN4(n);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Points src to the elements of AIDL array (NULL for a null array),
+ * making sure that they are all there.
+ */
+static
+gboolean
+gbinder_reader_read_array_data(
+    GBinderReaderPriv* p,
+    gsize elemsize,
+    const guint8** src,
+    gsize* count)
+{
+    if ((p->ptr + 4) <= p->end) {
+        const gint32 n = *(gint32*)p->ptr;
+
+        if (n == -1) {
+            /* NULL array */
+            p->ptr += 4;
+            *src = NULL;
+            *count = 0;
+            return TRUE;
+        } else if (n >= 0 && (gsize)(p->end - p->ptr - 4) / elemsize >=
+            (gsize)n) {
+            *src = p->ptr + 4;
+            *count = n;
+            p->ptr += 4 + n * elemsize;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static
+gboolean
+gbinder_reader_read_array(
+    GBinderReader* reader,
+    gsize elemsize,
+    void** values,
+    gsize* count)
+{
+    const guint8* src;
+    gsize n;
+
+    if (gbinder_reader_read_array_data(gbinder_reader_cast(reader),
+        elemsize, &src, &n)) {
+        if (values) {
+            if (src) {
+                /* Empty array is still non-NULL */
+                *values = g_malloc(MAX(n * elemsize, 1));
+                memcpy(*values, src, n * elemsize);
+            } else {
+                *values = NULL;
+            }
+        }
+        if (count) *count = n;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+gbinder_reader_read_int32_array(
+    GBinderReader* reader,
+    gint32** values,
+    gsize* count)
+{
+    return gbinder_reader_read_array(reader, sizeof(**values),
+        (void**)values, count);
+}
+
+gboolean
+gbinder_reader_read_int64_array(
+    GBinderReader* reader,
+    gint64** values,
+    gsize* count)
+{
+    return gbinder_reader_read_array(reader, sizeof(**values),
+        (void**)values, count);
+}
+
+gboolean
+gbinder_reader_read_float_array(
+    GBinderReader* reader,
+    gfloat** values,
+    gsize* count)
+{
+    return gbinder_reader_read_array(reader, sizeof(**values),
+        (void**)values, count);
+}
+
+gboolean
+gbinder_reader_read_double_array(
+    GBinderReader* reader,
+    gdouble** values,
+    gsize* count)
+{
+    return gbinder_reader_read_array(reader, sizeof(**values),
+        (void**)values, count);
+}
+
+gboolean
+gbinder_reader_read_bool_array(
+    GBinderReader* reader,
+    gboolean** values,
+    gsize* count)
+{
+    const guint8* src;
+    gsize n;
+
+    /* Booleans are padded to 4-byte boundary */
+    if (gbinder_reader_read_array_data(gbinder_reader_cast(reader), 4,
+        &src, &n)) {
+        if (values) {
+            if (src) {
+                gboolean* dest = g_new(gboolean, MAX(n, 1));
+                gsize i;
+
+                for (i = 0; i < n; i++) {
+                    dest[i] = (src[i * 4] != 0);
+                }
+                *values = dest;
+            } else {
+                *values = NULL;
+            }
+        }
+        if (count) *count = n;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+gbinder_reader_read_string16_array(
+    GBinderReader* reader,
+    char*** strv,
+    gsize* count)
+{
+    GBinderReaderPriv* p = gbinder_reader_cast(reader);
+
+    if ((p->ptr + 4) <= p->end) {
+        const guint8* start = p->ptr;
+        const gint32 n = *(gint32*)p->ptr;
+
+        if (n == -1) {
+            /* NULL array */
+            p->ptr += 4;
+            if (strv) *strv = NULL;
+            if (count) *count = 0;
+            return TRUE;
+        } else if (n >= 0 && (gsize)(p->end - p->ptr - 4) / 4 >= (gsize)n) {
+            char** out = strv ? g_new0(char*, n + 1) : NULL;
+            gint32 i;
+
+            /* Each string takes at least 4 bytes */
+            p->ptr += 4;
+            for (i = 0; i < n; i++) {
+                if (!gbinder_reader_read_nullable_string16(reader,
+                    out ? (out + i) : NULL)) {
+                    break;
+                }
+            }
+            if (i == n) {
+                if (strv) *strv = out;
+                if (count) *count = n;
+                return TRUE;
+            }
+            /* Not a valid array */
+            if (out) {
+                while (i > 0) {
+                    g_free(out[--i]);
+                }
+                g_free(out);
+            }
+            p->ptr = start;
+        }
+    }
+    return FALSE;
+}
+
 gboolean
 gbinder_reader_read_nullable_string16(
     GBinderReader* reader,
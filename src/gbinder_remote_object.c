@@ -79,6 +79,14 @@ gbinder_remote_object_died_handle(
     return G_SOURCE_REMOVE;
 }
 
+static
+void
+gbinder_remote_object_unref_func(
+    gpointer self)
+{
+    gbinder_remote_object_unref(self);
+}
+
 /*==========================================================================*
  * Interface
  *==========================================================================*/
@@ -92,6 +100,7 @@ gbinder_remote_object_new(
         GBinderRemoteObject* self = g_object_new
             (GBINDER_TYPE_REMOTE_OBJECT, NULL);
 
+        g_atomic_int_set(&self->refcount, 1);
         self->ipc = gbinder_ipc_ref(ipc);
         self->handle = handle;
         gbinder_driver_request_death_notification(ipc->driver, self);
@@ -105,7 +114,8 @@ gbinder_remote_object_ref(
     GBinderRemoteObject* self)
 {
     if (G_LIKELY(self)) {
-        g_object_ref(GBINDER_REMOTE_OBJECT(self));
+        GASSERT(self->refcount > 0);
+        g_atomic_int_inc(&self->refcount);
         return self;
     } else {
         return NULL;
@@ -117,10 +127,16 @@ gbinder_remote_object_unref(
     GBinderRemoteObject* self)
 {
     if (G_LIKELY(self)) {
-        g_object_unref(GBINDER_REMOTE_OBJECT(self));
+        GASSERT(self->refcount > 0);
+        if (g_atomic_int_dec_and_test(&self->refcount)) {
+            /* Once it's zero, GBinderIpc won't hand it out anymore */
+            gbinder_ipc_remote_object_released(self->ipc, self);
+            g_object_unref(GBINDER_REMOTE_OBJECT(self));
+        }
     }
 }
 
+
 gboolean
 gbinder_remote_object_is_dead(
     GBinderRemoteObject* self)
@@ -161,7 +177,7 @@ gbinder_remote_object_handle_death_notification(
     GVERBOSE_("%p %u", self, self->handle);
     g_main_context_invoke_full(self->priv->context, G_PRIORITY_DEFAULT,
         gbinder_remote_object_died_handle, gbinder_remote_object_ref(self),
-        g_object_unref);
+        gbinder_remote_object_unref_func);
 }
 
 /*==========================================================================*
@@ -180,17 +196,6 @@ gbinder_remote_object_init(
     self->priv = priv;
 }
 
-static
-void
-gbinder_remote_object_dispose(
-    GObject* remote)
-{
-    GBinderRemoteObject* self = GBINDER_REMOTE_OBJECT(remote);
-
-    gbinder_ipc_remote_object_disposed(self->ipc, self);
-    G_OBJECT_CLASS(gbinder_remote_object_parent_class)->dispose(remote);
-}
-
 static
 void
 gbinder_remote_object_finalize(
@@ -214,7 +219,6 @@ gbinder_remote_object_class_init(
     GObjectClass* remote_class = G_OBJECT_CLASS(klass);
 
     g_type_class_add_private(klass, sizeof(GBinderRemoteObjectPriv));
-    remote_class->dispose = gbinder_remote_object_dispose;
     remote_class->finalize = gbinder_remote_object_finalize;
 
     gbinder_remote_object_signals[SIGNAL_DEATH] =
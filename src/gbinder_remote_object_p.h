@@ -43,6 +43,7 @@ typedef struct gbinder_remote_object_priv GBinderRemoteObjectPriv;
 struct gbinder_remote_object {
     GObject object;
     GBinderRemoteObjectPriv* priv;
+    gint refcount; /* Holds the GObject reference while non-zero */
     GBinderIpc* ipc;
     guint32 handle;
     gboolean dead;
@@ -32,6 +32,7 @@
 
 #include "gbinder_remote_request_p.h"
 #include "gbinder_reader_p.h"
+#include "gbinder_ipc.h"
 #include "gbinder_rpc_protocol.h"
 #include "gbinder_object_registry.h"
 #include "gbinder_buffer.h"
@@ -48,6 +49,8 @@ struct gbinder_remote_request {
     char* iface2;
     gsize header_size;
     GBinderReaderData data;
+    GBinderIpcLooperTx* tx;       /* While being handled */
+    GBinderIpcLooperTx* blocked;  /* Until completed */
 };
 
 GBinderRemoteRequest*
@@ -158,6 +161,70 @@ gbinder_remote_request_unref(
     }
 }
 
+void
+gbinder_remote_request_set_looper_tx(
+    GBinderRemoteRequest* self,
+    GBinderIpcLooperTx* tx)
+{
+    /* Only called on the main thread */
+    self->tx = tx;
+}
+
+void
+gbinder_remote_request_block(
+    GBinderRemoteRequest* self)
+{
+    if (G_LIKELY(self) && self->tx && !self->blocked &&
+        gbinder_ipc_looper_tx_block(self->tx)) {
+        g_atomic_pointer_set(&self->blocked, self->tx);
+    }
+}
+
+static
+GBinderIpcLooperTx*
+gbinder_remote_request_unblock(
+    GBinderRemoteRequest* self)
+{
+    GBinderIpcLooperTx* tx;
+
+    /* Make sure that it's only completed once */
+    do {
+        tx = g_atomic_pointer_get(&self->blocked);
+    } while (tx && !g_atomic_pointer_compare_and_exchange(&self->blocked,
+        tx, NULL));
+    return tx;
+}
+
+void
+gbinder_remote_request_cancel(
+    GBinderRemoteRequest* self,
+    int status)
+{
+    GBinderIpcLooperTx* tx = gbinder_remote_request_unblock(self);
+
+    if (tx) {
+        GDEBUG("Blocked request is cancelled");
+        gbinder_ipc_looper_tx_complete(tx, NULL, status);
+    }
+}
+
+void
+gbinder_remote_request_complete(
+    GBinderRemoteRequest* self,
+    GBinderLocalReply* reply,
+    int status)
+{
+    if (G_LIKELY(self)) {
+        GBinderIpcLooperTx* tx = gbinder_remote_request_unblock(self);
+
+        if (tx) {
+            gbinder_ipc_looper_tx_complete(tx, reply, status);
+        } else {
+            GWARN("Completing a request which isn't blocked");
+        }
+    }
+}
+
 void
 gbinder_remote_request_init_reader(
     GBinderRemoteRequest* self,
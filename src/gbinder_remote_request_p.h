@@ -50,6 +50,17 @@ gbinder_remote_request_set_data(
     GBinderBuffer* buffer,
     void** objects);
 
+/* Only for GBinderIpc */
+void
+gbinder_remote_request_set_looper_tx(
+    GBinderRemoteRequest* request,
+    GBinderIpcLooperTx* tx);
+
+void
+gbinder_remote_request_cancel(
+    GBinderRemoteRequest* request,
+    int status);
+
 #endif /* GBINDER_REMOTE_REQUEST_PRIVATE_H */
 
 /*
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* CPU_SET, sched_setaffinity */
+#endif
+
+#include "gbinder_sched.h"
+#include "gbinder_log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+struct gbinder_sched {
+    gint refcount;
+    char* name;
+    guint64 cpu_mask;
+    int nice;
+    int fifo_priority;
+    gboolean defaults;
+};
+
+/*==========================================================================*
+ * Implementation
+ *==========================================================================*/
+
+/* Zero mask allows all CPUs */
+static
+void
+gbinder_sched_set_affinity(
+    guint64 mask)
+{
+    cpu_set_t set;
+    guint i;
+
+    CPU_ZERO(&set);
+    if (mask) {
+        for (i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+            if (mask & (G_GUINT64_CONSTANT(1) << i)) {
+                CPU_SET(i, &set);
+            }
+        }
+    } else {
+        /* The kernel drops the CPUs which aren't there */
+        for (i = 0; i < CPU_SETSIZE; i++) {
+            CPU_SET(i, &set);
+        }
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        GWARN("Failed to set CPU affinity 0x%" G_GINT64_MODIFIER "x: %s",
+            mask, strerror(errno));
+    }
+}
+
+static
+void
+gbinder_sched_set_policy(
+    int policy,
+    int priority)
+{
+    struct sched_param param;
+    int current, err;
+
+    memset(&param, 0, sizeof(param));
+    if (!pthread_getschedparam(pthread_self(), &current, &param) &&
+        current == policy && param.sched_priority == priority) {
+        /* Nothing to do */
+        return;
+    }
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err) {
+        GWARN("Failed to set scheduling policy %d priority %d: %s",
+            policy, priority, strerror(err));
+    }
+}
+
+static
+void
+gbinder_sched_set_nice(
+    int nice)
+{
+    /* On Linux, nice level is a per-thread attribute */
+    const id_t tid = (id_t)syscall(SYS_gettid);
+
+    errno = 0;
+    if (getpriority(PRIO_PROCESS, tid) != nice || errno) {
+        if (setpriority(PRIO_PROCESS, tid, nice) < 0) {
+            GWARN("Failed to set nice level %d: %s", nice, strerror(errno));
+        }
+    }
+}
+
+/*==========================================================================*
+ * Interface
+ *==========================================================================*/
+
+/* NULL params restore the defaults */
+GBinderSched*
+gbinder_sched_new(
+    const GBinderThreadParams* params)
+{
+    GBinderSched* self = g_slice_new0(GBinderSched);
+
+    g_atomic_int_set(&self->refcount, 1);
+    if (params) {
+        self->name = g_strdup(params->name);
+        self->cpu_mask = params->cpu_mask;
+        self->nice = params->nice;
+        self->fifo_priority = params->fifo_priority;
+    } else {
+        self->defaults = TRUE;
+    }
+    return self;
+}
+
+GBinderSched*
+gbinder_sched_ref(
+    GBinderSched* self)
+{
+    if (G_LIKELY(self)) {
+        GASSERT(self->refcount > 0);
+        g_atomic_int_inc(&self->refcount);
+    }
+    return self;
+}
+
+void
+gbinder_sched_unref(
+    GBinderSched* self)
+{
+    if (G_LIKELY(self)) {
+        GASSERT(self->refcount > 0);
+        if (g_atomic_int_dec_and_test(&self->refcount)) {
+            g_free(self->name);
+            g_slice_free(GBinderSched, self);
+        }
+    }
+}
+
+void
+gbinder_sched_apply(
+    GBinderSched* self)
+{
+    if (G_LIKELY(self)) {
+        if (self->name) {
+            /* The kernel truncates it to 15 characters */
+            prctl(PR_SET_NAME, self->name, 0, 0, 0);
+        }
+        if (self->defaults) {
+            gbinder_sched_set_affinity(0);
+            gbinder_sched_set_policy(SCHED_OTHER, 0);
+            gbinder_sched_set_nice(0);
+        } else {
+            /* Zero values leave the current settings alone */
+            if (self->cpu_mask) {
+                gbinder_sched_set_affinity(self->cpu_mask);
+            }
+            if (self->fifo_priority) {
+                gbinder_sched_set_policy(SCHED_FIFO, self->fifo_priority);
+            } else if (self->nice) {
+                gbinder_sched_set_nice(self->nice);
+            }
+        }
+    }
+}
+
+void
+gbinder_sched_slot_init(
+    GBinderSchedSlot* slot,
+    GBinderSched* sched)
+{
+    g_mutex_init(&slot->mutex);
+    slot->sched = gbinder_sched_ref(sched);
+    slot->gen = sched ? 1 : 0;
+}
+
+void
+gbinder_sched_slot_clear(
+    GBinderSchedSlot* slot)
+{
+    gbinder_sched_unref(slot->sched);
+    g_mutex_clear(&slot->mutex);
+}
+
+void
+gbinder_sched_slot_set(
+    GBinderSchedSlot* slot,
+    GBinderSched* sched)
+{
+    GBinderSched* prev;
+
+    /* Lock */
+    g_mutex_lock(&slot->mutex);
+    prev = slot->sched;
+    slot->sched = gbinder_sched_ref(sched);
+    g_atomic_int_inc(&slot->gen);
+    g_mutex_unlock(&slot->mutex);
+    /* Unlock */
+    gbinder_sched_unref(prev);
+}
+
+void
+gbinder_sched_slot_apply_changed(
+    GBinderSchedSlot* slot,
+    gint* gen)
+{
+    GBinderSched* sched;
+
+    /* Lock */
+    g_mutex_lock(&slot->mutex);
+    sched = gbinder_sched_ref(slot->sched);
+    *gen = slot->gen;
+    g_mutex_unlock(&slot->mutex);
+    /* Unlock */
+    gbinder_sched_apply(sched);
+    gbinder_sched_unref(sched);
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
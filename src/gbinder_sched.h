@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Copyright (C) 2018 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GBINDER_SCHED_H
+#define GBINDER_SCHED_H
+
+#include "gbinder_types_p.h"
+
+/*
+ * GBinderSched is an immutable snapshot of GBinderThreadParams which
+ * threads apply to themselves. The slot lets a running thread notice
+ * that the parameters have changed at the cost of one atomic read.
+ */
+typedef struct gbinder_sched_slot {
+    GMutex mutex;
+    GBinderSched* sched;
+    gint gen;
+} GBinderSchedSlot;
+
+/*
+ * NULL params restore the defaults (SCHED_OTHER, nice 0, all CPUs) but
+ * leave the thread name alone. Otherwise only non-zero parameters are
+ * applied.
+ */
+GBinderSched*
+gbinder_sched_new(
+    const GBinderThreadParams* params);
+
+GBinderSched*
+gbinder_sched_ref(
+    GBinderSched* sched);
+
+void
+gbinder_sched_unref(
+    GBinderSched* sched);
+
+/* Applies the parameters to the calling thread */
+void
+gbinder_sched_apply(
+    GBinderSched* sched);
+
+void
+gbinder_sched_slot_init(
+    GBinderSchedSlot* slot,
+    GBinderSched* sched);
+
+void
+gbinder_sched_slot_clear(
+    GBinderSchedSlot* slot);
+
+void
+gbinder_sched_slot_set(
+    GBinderSchedSlot* slot,
+    GBinderSched* sched);
+
+void
+gbinder_sched_slot_apply_changed(
+    GBinderSchedSlot* slot,
+    gint* gen);
+
+/* Applies the current parameters if they have changed since last time */
+GBINDER_INLINE_FUNC
+void
+gbinder_sched_slot_apply(
+    GBinderSchedSlot* slot,
+    gint* gen)
+{
+    if (G_UNLIKELY(g_atomic_int_get(&slot->gen) != *gen)) {
+        gbinder_sched_slot_apply_changed(slot, gen);
+    }
+}
+
+#endif /* GBINDER_SCHED_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -285,6 +285,101 @@ gbinder_servicemanager_new_local_object(
     return NULL;
 }
 
+void
+gbinder_servicemanager_set_fair_incoming(
+    GBinderServiceManager* self,
+    gboolean fair)
+{
+    if (G_LIKELY(self)) {
+        gbinder_ipc_set_fair_incoming(gbinder_client_ipc(self->client), fair);
+    }
+}
+
+void
+gbinder_servicemanager_set_incoming_priority(
+    GBinderServiceManager* self,
+    int priority)
+{
+    if (G_LIKELY(self)) {
+        gbinder_ipc_set_incoming_priority(gbinder_client_ipc(self->client),
+            priority);
+    }
+}
+
+GBinderCallerStats*
+gbinder_servicemanager_callers(
+    GBinderServiceManager* self,
+    guint* count)
+{
+    if (G_LIKELY(self)) {
+        return gbinder_ipc_get_caller_stats(gbinder_client_ipc(self->client),
+            count);
+    }
+    if (count) {
+        *count = 0;
+    }
+    return NULL;
+}
+
+void
+gbinder_servicemanager_set_max_pending_incoming(
+    GBinderServiceManager* self,
+    guint max,
+    gboolean drop_oneway)
+{
+    if (G_LIKELY(self)) {
+        gbinder_ipc_set_max_pending_incoming(gbinder_client_ipc
+            (self->client), max, drop_oneway);
+    }
+}
+
+gboolean
+gbinder_servicemanager_get_incoming_stats(
+    GBinderServiceManager* self,
+    GBinderIncomingStats* stats)
+{
+    if (G_LIKELY(self)) {
+        return gbinder_ipc_get_incoming_stats(gbinder_client_ipc
+            (self->client), stats);
+    }
+    return FALSE;
+}
+
+void
+gbinder_servicemanager_set_tx_done_batch(
+    GBinderServiceManager* self,
+    guint max)
+{
+    if (G_LIKELY(self)) {
+        gbinder_ipc_set_tx_done_batch(gbinder_client_ipc(self->client), max);
+    }
+}
+
+void
+gbinder_servicemanager_set_thread_params(
+    GBinderServiceManager* self,
+    GBINDER_THREADS threads,
+    const GBinderThreadParams* params)
+{
+    if (G_LIKELY(self)) {
+        gbinder_ipc_set_thread_params(gbinder_client_ipc(self->client),
+            threads, params);
+    }
+}
+
+gboolean
+gbinder_servicemanager_prewarm(
+    GBinderServiceManager* self,
+    guint threads,
+    GBinderPrewarmStats* stats)
+{
+    if (G_LIKELY(self)) {
+        return gbinder_ipc_prewarm(gbinder_client_ipc(self->client),
+            threads, stats);
+    }
+    return FALSE;
+}
+
 GBinderServiceManager*
 gbinder_servicemanager_ref(
     GBinderServiceManager* self)
@@ -35,36 +35,26 @@
 
 #include <gbinder_types.h>
 
+typedef struct gbinder_admission GBinderAdmission;
+typedef struct gbinder_arena GBinderArena;
 typedef struct gbinder_cleanup GBinderCleanup;
 typedef struct gbinder_driver GBinderDriver;
+typedef struct gbinder_executor GBinderExecutor;
 typedef struct gbinder_handler GBinderHandler;
 typedef struct gbinder_io GBinderIo;
 typedef struct gbinder_ipc GBinderIpc;
+typedef struct gbinder_ipc_looper_tx GBinderIpcLooperTx;
 typedef struct gbinder_object_registry GBinderObjectRegistry;
 typedef struct gbinder_output_data GBinderOutputData;
+typedef struct gbinder_pool GBinderPool;
 typedef struct gbinder_rpc_protocol GBinderRpcProtocol;
+typedef struct gbinder_sched GBinderSched;
 
-typedef struct hidl_vec {
-    union {
-        guint64 value;
-        const void* ptr;
-    } data;
-    guint32 count;
-    guint32 owns_buffer;
-} HidlVec;
+typedef GBinderHidlVec HidlVec;
+typedef GBinderHidlString HidlString;
 
-#define HIDL_VEC_BUFFER_OFFSET (0)
-
-typedef struct hidl_string {
-    union {
-        guint64 value;
-        const char* str;
-    } data;
-    guint32 len;
-    guint32 owns_buffer;
-} HidlString;
-
-#define HIDL_STRING_BUFFER_OFFSET (0)
+#define HIDL_VEC_BUFFER_OFFSET GBINDER_HIDL_VEC_BUFFER_OFFSET
+#define HIDL_STRING_BUFFER_OFFSET GBINDER_HIDL_STRING_BUFFER_OFFSET
 
 #define GBINDER_INLINE_FUNC static inline
 
@@ -40,6 +40,20 @@
 
 #include <stdint.h>
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define GBINDER_WRITER_SIMD_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define GBINDER_WRITER_SIMD_NEON
+#endif
+
+/* Larger buffers are reallocated by gbinder_writer_data_reset() */
+#define GBINDER_WRITER_MAX_RETAINED_SIZE (16 * 1024)
+
+/* Stack buffer for the measuring pass, larger data go to the heap */
+#define GBINDER_WRITER_MEASURE_BUF_SIZE (512)
+
 typedef struct gbinder_writer_priv {
     GBinderWriterData* data;
 } GBinderWriterPriv;
@@ -71,16 +85,16 @@ gbinder_writer_data_write_buffer_object(
     gsize size,
     const GBinderParent* parent)
 {
-    GByteArray* dest = data->bytes;
-    const guint offset = dest->len;
+    const guint offset = data->bytes->len;
     guint n;
 
     /* Preallocate enough space */
-    g_byte_array_set_size(dest, offset + GBINDER_MAX_BUFFER_OBJECT_SIZE);
+    gbinder_writer_data_set_size(data, offset + GBINDER_MAX_BUFFER_OBJECT_SIZE);
     /* Write the object */
-    n = data->io->encode_buffer_object(dest->data + offset, ptr, size, parent);
+    n = data->io->encode_buffer_object(data->bytes->data + offset, ptr, size,
+        parent);
     /* Fix the data size */
-    g_byte_array_set_size(dest, offset + n);
+    gbinder_writer_data_set_size(data, offset + n);
     /* Record the offset */
     gbinder_writer_data_record_offset(data, offset);
     /* The driver seems to require each buffer to be 8-byte aligned */
@@ -96,6 +110,182 @@ gbinder_writer_init(
     gbinder_writer_cast(self)->data = data;
 }
 
+/*
+ * Makes the data live in the caller provided storage for as long as
+ * they fit there. Once they don't, they are moved to the heap.
+ */
+void
+gbinder_writer_data_init_buf(
+    GBinderWriterData* data,
+    void* buf,
+    gsize size)
+{
+    data->buf.data = buf;
+    data->buf.len = 0;
+    data->buf_size = size;
+    data->bytes = &data->buf;
+}
+
+void
+gbinder_writer_data_free_bytes(
+    GBinderWriterData* data)
+{
+    if (data->bytes != &data->buf) {
+        g_byte_array_free(data->bytes, TRUE);
+    }
+    data->bytes = NULL;
+}
+
+/* Note that data->bytes (and data->bytes->data) may change */
+void
+gbinder_writer_data_set_size(
+    GBinderWriterData* data,
+    gsize size)
+{
+    if (data->dry_run && size > data->peak_size) {
+        /* Objects temporarily take more space than they need */
+        data->peak_size = size;
+    }
+    if (data->bytes == &data->buf) {
+        if (size <= data->buf_size) {
+            data->buf.len = size;
+            return;
+        }
+        /* Doesn't fit into the caller's storage anymore */
+        data->bytes = g_byte_array_sized_new(MAX(size, 2 * data->buf_size));
+        g_byte_array_append(data->bytes, data->buf.data, data->buf.len);
+    }
+    g_byte_array_set_size(data->bytes, size);
+}
+
+void
+gbinder_writer_data_append(
+    GBinderWriterData* data,
+    const void* ptr,
+    gsize size)
+{
+    if (size) {
+        const gsize len = data->bytes->len;
+
+        gbinder_writer_data_set_size(data, len + size);
+        memcpy(data->bytes->data + len, ptr, size);
+    }
+}
+
+/*
+ * Truncates the data to the first size bytes (e.g. the RPC header) and
+ * drops everything else, keeping the allocated memory for reuse unless
+ * there's too much of it. Note that data->bytes may change.
+ */
+void
+gbinder_writer_data_reset(
+    GBinderWriterData* data,
+    gsize size)
+{
+    GByteArray* buf = data->bytes;
+
+    GASSERT(size <= buf->len);
+    if (buf == &data->buf) {
+        buf->len = size;
+    } else if (buf->len > GBINDER_WRITER_MAX_RETAINED_SIZE) {
+        data->bytes = g_byte_array_sized_new(size);
+        g_byte_array_append(data->bytes, buf->data, size);
+        g_byte_array_free(buf, TRUE);
+    } else {
+        g_byte_array_set_size(buf, size);
+    }
+    if (data->offsets) {
+        gutil_int_array_set_count(data->offsets, 0);
+    }
+    data->buffers_size = 0;
+    if (data->slots) {
+        g_array_set_size(data->slots, 0);
+    }
+    gbinder_cleanup_reset(data->consumed);
+    gbinder_cleanup_reset(data->cleanup);
+    gbinder_arena_reset(&data->arena);
+}
+
+/*
+ * Makes sure that the next size bytes can be appended without
+ * reallocating the buffer. GByteArray never shrinks its allocation,
+ * so growing and shrinking it back does the job.
+ */
+void
+gbinder_writer_data_reserve(
+    GBinderWriterData* data,
+    gsize size)
+{
+    const guint len = data->bytes->len;
+
+    gbinder_writer_data_set_size(data, len + size);
+    gbinder_writer_data_set_size(data, len);
+}
+
+void
+gbinder_writer_reserve(
+    GBinderWriter* self,
+    gsize size)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        gbinder_writer_data_reserve(data, size);
+    }
+}
+
+/*
+ * Runs the fill function against a throwaway writer to find out how
+ * much data it produces (including the worst case space temporarily
+ * taken by each object), allocates all that at once and then runs it
+ * again for real.
+ */
+void
+gbinder_writer_append_measured(
+    GBinderWriter* self,
+    GBinderWriterFillFunc fill,
+    void* user_data)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data) && G_LIKELY(fill)) {
+        guint8 buf[GBINDER_WRITER_MEASURE_BUF_SIZE];
+        GBinderWriterData scratch;
+        GBinderWriter writer;
+        gsize size;
+        guint n;
+
+        memset(&scratch, 0, sizeof(scratch));
+        scratch.io = data->io;
+        scratch.dry_run = TRUE;
+        gbinder_writer_data_init_buf(&scratch, buf, sizeof(buf));
+        gbinder_writer_init(&writer, &scratch);
+        fill(&writer, user_data);
+
+        size = scratch.peak_size;
+        n = scratch.offsets ? scratch.offsets->count : 0;
+        gbinder_writer_data_free_bytes(&scratch);
+        gutil_int_array_free(scratch.offsets, TRUE);
+        gbinder_arena_free(scratch.arena);
+        if (scratch.slots) {
+            g_array_free(scratch.slots, TRUE);
+        }
+
+        if (n) {
+            if (data->offsets) {
+                const guint count = data->offsets->count;
+
+                gutil_int_array_set_count(data->offsets, count + n);
+                gutil_int_array_set_count(data->offsets, count);
+            } else {
+                data->offsets = gutil_int_array_sized_new(n);
+            }
+        }
+        gbinder_writer_data_reserve(data, size);
+        fill(self, user_data);
+    }
+}
+
 void
 gbinder_writer_append_int32(
     GBinderWriter* self,
@@ -115,7 +305,7 @@ gbinder_writer_data_append_int32(
 {
     guint32* ptr;
 
-    g_byte_array_set_size(data->bytes, data->bytes->len + sizeof(*ptr));
+    gbinder_writer_data_set_size(data, data->bytes->len + sizeof(*ptr));
     ptr = (void*)(data->bytes->data + (data->bytes->len - sizeof(*ptr)));
     *ptr = value;
 }
@@ -139,11 +329,84 @@ gbinder_writer_data_append_int64(
 {
     guint64* ptr;
 
-    g_byte_array_set_size(data->bytes, data->bytes->len + sizeof(*ptr));
+    gbinder_writer_data_set_size(data, data->bytes->len + sizeof(*ptr));
     ptr = (void*)(data->bytes->data + (data->bytes->len - sizeof(*ptr)));
     *ptr = value;
 }
 
+/*
+ * Slots remember where int32 and int64 values have been written, so
+ * that a request can be used as a template (see
+ * gbinder_local_request_instantiate) and the values patched in place.
+ */
+guint
+gbinder_writer_data_add_slot(
+    GBinderWriterData* data,
+    guint size)
+{
+    GBinderWriterSlot slot;
+
+    if (!data->slots) {
+        data->slots = g_array_new(FALSE, FALSE, sizeof(slot));
+    }
+    slot.offset = data->bytes->len;
+    slot.size = size;
+    g_array_append_vals(data->slots, &slot, 1);
+    return data->slots->len - 1;
+}
+
+gboolean
+gbinder_writer_data_patch(
+    GBinderWriterData* data,
+    const GArray* slots,
+    guint index,
+    const void* value,
+    guint size)
+{
+    if (slots && index < slots->len) {
+        const GBinderWriterSlot* slot = &g_array_index(slots,
+            GBinderWriterSlot, index);
+
+        if (slot->size == size && (slot->offset + size) <= data->bytes->len) {
+            memcpy(data->bytes->data + slot->offset, value, size);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+guint
+gbinder_writer_append_int32_slot(
+    GBinderWriter* self,
+    guint32 value)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        const guint slot = gbinder_writer_data_add_slot(data, sizeof(value));
+
+        gbinder_writer_data_append_int32(data, value);
+        return slot;
+    }
+    return 0;
+}
+
+guint
+gbinder_writer_append_int64_slot(
+    GBinderWriter* self,
+    guint64 value)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        const guint slot = gbinder_writer_data_add_slot(data, sizeof(value));
+
+        gbinder_writer_data_append_int64(data, value);
+        return slot;
+    }
+    return 0;
+}
+
 void
 gbinder_writer_append_string8(
     GBinderWriter* self,
@@ -185,7 +448,7 @@ gbinder_writer_data_append_string8_len(
         guint32* dest;
 
         /* Preallocate space */
-        g_byte_array_set_size(data->bytes, old_size + padded_len);
+        gbinder_writer_data_set_size(data, old_size + padded_len);
 
         /* Zero the last word */
         dest = (guint32*)(data->bytes->data + old_size);
@@ -225,66 +488,171 @@ gbinder_writer_data_append_string16(
     gbinder_writer_data_append_string16_len(data, utf8, utf8? strlen(utf8) : 0);
 }
 
-void
-gbinder_writer_data_append_string16_len(
-    GBinderWriterData* data,
-    const char* utf8,
-    gssize num_bytes)
+/*
+ * Widens the leading run of (non-zero) ASCII characters, 16 bytes at
+ * a time. Returns the number of characters converted.
+ */
+static
+gsize
+gbinder_writer_ascii_to_utf16(
+    const guint8* in,
+    gsize len,
+    gunichar2* out)
 {
-    const gsize old_size = data->bytes->len;
+    gsize i = 0;
 
-    if (utf8) {
-        const char* end = utf8;
+#if defined(GBINDER_WRITER_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
 
-        g_utf8_validate(utf8, num_bytes, &end);
-        num_bytes = end - utf8;
-    } else {
-        num_bytes = 0;
+    while (i + 16 <= len) {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+
+        /* Stop at anything non-ASCII or NUL */
+        if (_mm_movemask_epi8(v) || _mm_movemask_epi8(_mm_cmpeq_epi8(v,
+            zero))) {
+            break;
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpackhi_epi8(v, zero));
+        i += 16;
     }
+#elif defined(GBINDER_WRITER_SIMD_NEON)
+    while (i + 16 <= len) {
+        const uint8x16_t v = vld1q_u8(in + i);
 
-    if (num_bytes > 0) {
-        glong len = g_utf8_strlen(utf8, num_bytes);
-        gsize padded_len = G_ALIGN4((len+1)*2);
-        guint32* len_ptr;
-        gunichar2* utf16_ptr;
+        /* Stop at anything non-ASCII or NUL */
+        if (vmaxvq_u8(v) >= 0x80 || !vminvq_u8(v)) {
+            break;
+        }
+        vst1q_u16(out + i, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(out + i + 8, vmovl_u8(vget_high_u8(v)));
+        i += 16;
+    }
+#endif
 
-        /* Preallocate space */
-        g_byte_array_set_size(data->bytes, old_size + padded_len + 4);
-        len_ptr = (guint32*)(data->bytes->data + old_size);
-        utf16_ptr = (gunichar2*)(len_ptr + 1);
+    /* Scalar tail (or everything if there's no SIMD) */
+    while (i < len && in[i] && in[i] < 0x80) {
+        out[i] = in[i];
+        i++;
+    }
+    return i;
+}
 
-        /* TODO: this could be optimized for ASCII strings, i.e. if
-         * len equals num_bytes */
-        if (len > 0) {
-            glong utf16_len = 0;
-            gunichar2* utf16 = g_utf8_to_utf16(utf8, num_bytes, NULL,
-                &utf16_len, NULL);
-
-            if (utf16) {
-                len = utf16_len;
-                padded_len = G_ALIGN4((len+1)*2);
-                memcpy(utf16_ptr, utf16, (len+1)*2);
-                g_free(utf16);
+/*
+ * Converts UTF-8 to UTF-16 in one pass, stopping at NUL or at the first
+ * invalid sequence, i.e. where g_utf8_validate() would stop. The output
+ * buffer must have room for len units, which is the worst case. Returns
+ * the number of UTF-16 units written.
+ */
+static
+gsize
+gbinder_writer_utf8_to_utf16(
+    const char* utf8,
+    gsize len,
+    gunichar2* out)
+{
+    const guint8* in = (const guint8*)utf8;
+    gsize i = 0, n = 0;
+
+    while (i < len) {
+        const guint c = in[i];
+        guint cp, need, min;
+
+        if (c < 0x80) {
+            const gsize k = gbinder_writer_ascii_to_utf16(in + i, len - i,
+                out + n);
+
+            if (!k) {
+                break; /* NUL */
             }
+            i += k;
+            n += k;
+            continue;
+        } else if ((c & 0xe0) == 0xc0) {
+            cp = c & 0x1f;
+            need = 1;
+            min = 0x80;
+        } else if ((c & 0xf0) == 0xe0) {
+            cp = c & 0x0f;
+            need = 2;
+            min = 0x800;
+        } else if ((c & 0xf8) == 0xf0) {
+            cp = c & 0x07;
+            need = 3;
+            min = 0x10000;
+        } else {
+            break;
         }
 
-        /* Actual length */
-        *len_ptr = len;
+        if (i + need >= len) {
+            break; /* Truncated sequence */
+        } else {
+            guint k;
 
-        /* Zero padding */
-        if (padded_len - (len + 1)*2) {
-            memset(utf16_ptr + (len + 1), 0, padded_len - (len + 1)*2);
+            for (k = 1; k <= need && (in[i + k] & 0xc0) == 0x80; k++) {
+                cp = (cp << 6) | (in[i + k] & 0x3f);
+            }
+            if (k <= need || cp < min || cp > 0x10ffff ||
+                (cp & 0xfffff800) == 0xd800) {
+                break; /* Invalid, overlong or surrogate */
+            }
         }
 
-        /* Correct the packet size if necessaary */
-        g_byte_array_set_size(data->bytes, old_size + padded_len + 4);
-    } else if (utf8) {
-        /* Empty string */
-        guint16* ptr16;
+        if (cp < 0x10000) {
+            out[n++] = cp;
+        } else {
+            cp -= 0x10000;
+            out[n++] = 0xd800 | (cp >> 10);
+            out[n++] = 0xdc00 | (cp & 0x3ff);
+        }
+        i += need + 1;
+    }
+    return n;
+}
+
+void
+gbinder_writer_data_append_string16_len(
+    GBinderWriterData* data,
+    const char* utf8,
+    gssize num_bytes)
+{
+    const gsize old_size = data->bytes->len;
 
-        g_byte_array_set_size(data->bytes, old_size + 8);
-        ptr16 = (guint16*)(data->bytes->data + old_size);
-        ptr16[0] = ptr16[1] = ptr16[2] = 0; ptr16[3] = 0xffff;
+    if (utf8) {
+        gsize len = 0;
+
+        if (num_bytes < 0) {
+            num_bytes = strlen(utf8);
+        }
+        if (num_bytes > 0) {
+            guint32* len_ptr;
+            gunichar2* utf16_ptr;
+
+            /* Preallocate space for the worst case (one unit per byte) */
+            gbinder_writer_data_set_size(data, old_size + 4 +
+                G_ALIGN4((num_bytes + 1) * 2));
+            len_ptr = (guint32*)(data->bytes->data + old_size);
+            utf16_ptr = (gunichar2*)(len_ptr + 1);
+            len = gbinder_writer_utf8_to_utf16(utf8, num_bytes, utf16_ptr);
+            if (len > 0) {
+                const gsize padded_len = G_ALIGN4((len + 1) * 2);
+
+                /* Actual length, NULL terminator and zero padding */
+                *len_ptr = len;
+                memset(utf16_ptr + len, 0, padded_len - len * 2);
+
+                /* Correct the packet size */
+                gbinder_writer_data_set_size(data, old_size + padded_len + 4);
+            }
+        }
+        if (!len) {
+            /* Empty string */
+            guint16* ptr16;
+
+            gbinder_writer_data_set_size(data, old_size + 8);
+            ptr16 = (guint16*)(data->bytes->data + old_size);
+            ptr16[0] = ptr16[1] = ptr16[2] = 0; ptr16[3] = 0xffff;
+        }
     } else {
         /* NULL string */
         gbinder_writer_data_append_int32(data, -1);
@@ -313,7 +681,7 @@ gbinder_writer_append_bytes(
     GBinderWriterData* data = gbinder_writer_data(self);
 
     if (G_LIKELY(data)) {
-        g_byte_array_append(data->bytes, ptr, size);
+        gbinder_writer_data_append(data, ptr, size);
     }
 }
 
@@ -388,7 +756,8 @@ gbinder_writer_data_append_hidl_string(
     const char* str)
 {
     GBinderParent str_parent;
-    HidlString* hidl_string = g_new0(HidlString, 1);
+    HidlString* hidl_string = gbinder_arena_alloc0(&data->arena,
+        sizeof(HidlString));
     const gsize len = str ? strlen(str) : 0;
 
     /* Prepare parent descriptor for the string data */
@@ -399,7 +768,6 @@ gbinder_writer_data_append_hidl_string(
     hidl_string->data.str = str;
     hidl_string->len = len;
     hidl_string->owns_buffer = TRUE;
-    data->cleanup = gbinder_cleanup_add(data->cleanup, g_free, hidl_string);
 
     /* Write the buffer object pointing to the string descriptor */
     gbinder_writer_data_write_buffer_object(data, hidl_string,
@@ -435,7 +803,7 @@ gbinder_writer_data_append_hidl_string_vec(
     gssize count)
 {
     GBinderParent vec_parent;
-    HidlVec* vec = g_new0(HidlVec, 1);
+    HidlVec* vec = gbinder_arena_alloc0(&data->arena, sizeof(HidlVec));
     HidlString* strings = NULL;
     int i;
 
@@ -450,13 +818,12 @@ gbinder_writer_data_append_hidl_string_vec(
 
     /* Fill in the vector descriptor */
     if (count > 0) {
-        strings = g_new0(HidlString, count);
+        strings = gbinder_arena_alloc0(&data->arena,
+            sizeof(HidlString) * count);
         vec->data.ptr = strings;
-        data->cleanup = gbinder_cleanup_add(data->cleanup, g_free, strings);
     }
     vec->count = count;
     vec->owns_buffer = TRUE;
-    data->cleanup = gbinder_cleanup_add(data->cleanup, g_free, vec);
 
     /* Fill in string descriptors */
     for (i = 0; i < count; i++) {
@@ -498,6 +865,393 @@ gbinder_writer_data_append_hidl_string_vec(
     }
 }
 
+/*
+ * Writes the buffers referenced by hidl_string and hidl_vec fields of
+ * count structures of the given type, which have already been written
+ * as a part of buffer object number index, starting at offset.
+ */
+static
+void
+gbinder_writer_data_write_hidl_fields(
+    GBinderWriterData* data,
+    const void* base,
+    gsize count,
+    const GBinderHidlType* type,
+    guint index,
+    gsize offset)
+{
+    gsize i;
+
+    for (i = 0; i < count; i++) {
+        const guint8* ptr = (const guint8*)base + i * type->size;
+        const GBinderHidlField* field;
+
+        for (field = type->fields;
+            field && field->kind != GBINDER_HIDL_FIELD_KIND_END;
+            field++) {
+            const guint8* fptr = ptr + field->offset;
+            GBinderParent parent;
+
+            parent.index = index;
+            parent.offset = offset + i * type->size + field->offset;
+            switch (field->kind) {
+            case GBINDER_HIDL_FIELD_KIND_STRING:
+                {
+                    const HidlString* str = (const HidlString*)fptr;
+
+                    if (str->data.str) {
+                        parent.offset += HIDL_STRING_BUFFER_OFFSET;
+                        gbinder_writer_data_write_buffer_object(data,
+                            str->data.str, str->len + 1, &parent);
+                    }
+                }
+                break;
+            case GBINDER_HIDL_FIELD_KIND_VEC:
+                {
+                    const HidlVec* vec = (const HidlVec*)fptr;
+
+                    if (vec->data.ptr) {
+                        const guint vec_index =
+                            gbinder_writer_data_prepare(data);
+
+                        parent.offset += HIDL_VEC_BUFFER_OFFSET;
+                        gbinder_writer_data_write_buffer_object(data,
+                            vec->data.ptr, vec->count * field->type->size,
+                            &parent);
+                        gbinder_writer_data_write_hidl_fields(data,
+                            vec->data.ptr, vec->count, field->type,
+                            vec_index, 0);
+                    }
+                }
+                break;
+            case GBINDER_HIDL_FIELD_KIND_STRUCT:
+                gbinder_writer_data_write_hidl_fields(data, fptr, 1,
+                    field->type, index, parent.offset);
+                break;
+            case GBINDER_HIDL_FIELD_KIND_END:
+                break;
+            }
+        }
+    }
+}
+
+void
+gbinder_writer_data_append_hidl_vec(
+    GBinderWriterData* data,
+    const void* base,
+    guint count,
+    const GBinderHidlType* type)
+{
+    GBinderParent vec_parent;
+    HidlVec* vec = gbinder_arena_alloc0(&data->arena, sizeof(HidlVec));
+
+    /* The elements are not copied, they stay where they are */
+    vec->data.ptr = base;
+    vec->count = base ? count : 0;
+    vec->owns_buffer = TRUE;
+
+    /* Write the vector descriptor */
+    vec_parent.index = gbinder_writer_data_prepare(data);
+    vec_parent.offset = HIDL_VEC_BUFFER_OFFSET;
+    gbinder_writer_data_write_buffer_object(data, vec, sizeof(*vec), NULL);
+
+    /* And the elements, followed by whatever they point to */
+    if (base) {
+        const guint index = data->offsets->count;
+
+        gbinder_writer_data_write_buffer_object(data, base,
+            count * type->size, &vec_parent);
+        gbinder_writer_data_write_hidl_fields(data, base, count, type,
+            index, 0);
+    }
+}
+
+void
+gbinder_writer_data_append_hidl_struct(
+    GBinderWriterData* data,
+    const void* ptr,
+    const GBinderHidlType* type)
+{
+    const guint index = gbinder_writer_data_append_buffer_object(data,
+        ptr, type->size, NULL);
+
+    gbinder_writer_data_write_hidl_fields(data, ptr, 1, type, index, 0);
+}
+
+void
+gbinder_writer_append_hidl_vec(
+    GBinderWriter* self,
+    const void* base,
+    guint count,
+    guint elemsize)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        GBinderHidlType type;
+
+        memset(&type, 0, sizeof(type));
+        type.size = elemsize;
+        gbinder_writer_data_append_hidl_vec(data, base, count, &type);
+    }
+}
+
+void
+gbinder_writer_append_hidl_struct_vec(
+    GBinderWriter* self,
+    const void* base,
+    guint count,
+    const GBinderHidlType* type)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data) && G_LIKELY(type)) {
+        gbinder_writer_data_append_hidl_vec(data, base, count, type);
+    }
+}
+
+void
+gbinder_writer_append_hidl_struct(
+    GBinderWriter* self,
+    const void* ptr,
+    const GBinderHidlType* type)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data) && G_LIKELY(ptr) && G_LIKELY(type)) {
+        gbinder_writer_data_append_hidl_struct(data, ptr, type);
+    }
+}
+
+void
+gbinder_writer_data_append_hidl_byte_vec(
+    GBinderWriterData* data,
+    const void* bytes,
+    gsize size,
+    GDestroyNotify destroy,
+    gpointer user_data)
+{
+    if (G_LIKELY(size <= G_MAXUINT32)) {
+        GBinderHidlType type;
+
+        memset(&type, 0, sizeof(type));
+        type.size = 1;
+        gbinder_writer_data_append_hidl_vec(data, bytes, size, &type);
+        if (destroy && !data->dry_run) {
+            data->consumed = gbinder_cleanup_add(data->consumed, destroy,
+                user_data);
+        }
+    } else {
+        GWARN("Byte vector is too large (%" G_GSIZE_FORMAT " bytes)", size);
+        if (destroy) {
+            destroy(user_data);
+        }
+    }
+}
+
+void
+gbinder_writer_append_hidl_byte_vec(
+    GBinderWriter* self,
+    const void* bytes,
+    gsize size,
+    GDestroyNotify destroy,
+    gpointer user_data)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        gbinder_writer_data_append_hidl_byte_vec(data, bytes, size,
+            destroy, user_data);
+    } else if (destroy) {
+        destroy(user_data);
+    }
+}
+
+/*
+ * AIDL byte[] lives inside the parcel, so it can't be referenced. It's
+ * copied once directly to its final location.
+ */
+void
+gbinder_writer_data_append_byte_array(
+    GBinderWriterData* data,
+    const void* bytes,
+    gssize len)
+{
+    if (len < 0 || (!bytes && len > 0)) {
+        gbinder_writer_data_append_int32(data, -1);
+    } else if (len > G_MAXINT32) {
+        GWARN("Byte array is too large (%" G_GSSIZE_FORMAT " bytes)", len);
+    } else {
+        const guint offset = data->bytes->len;
+        const gsize padded = G_ALIGN4(len);
+        guint8* ptr;
+
+        gbinder_writer_data_set_size(data, offset + sizeof(gint32) + padded);
+        ptr = data->bytes->data + offset;
+        *((gint32*)ptr) = (gint32)len;
+        ptr += sizeof(gint32);
+        if (len > 0) {
+            memcpy(ptr, bytes, len);
+        }
+        memset(ptr + len, 0, padded - len);
+    }
+}
+
+void
+gbinder_writer_append_byte_array(
+    GBinderWriter* self,
+    const void* bytes,
+    gssize len)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        gbinder_writer_data_append_byte_array(data, bytes, len);
+    }
+}
+
+/*
+ * AIDL arrays of fixed size elements are prefixed with the element
+ * count, with -1 meaning a null array. The whole thing is sized once
+ * and the elements are copied in one go. Arrays whose size doesn't fit
+ * into 32 bits aren't written at all.
+ */
+static
+guint8*
+gbinder_writer_data_append_array(
+    GBinderWriterData* data,
+    gboolean null,
+    gssize count,
+    gsize elemsize)
+{
+    if (null || count < 0) {
+        gbinder_writer_data_append_int32(data, -1);
+        return NULL;
+    } else if ((gsize)count > G_MAXINT32 / elemsize) {
+        GWARN("Array is too large (%" G_GSSIZE_FORMAT " elements)", count);
+        return NULL;
+    } else {
+        const guint offset = data->bytes->len;
+        guint8* ptr;
+
+        gbinder_writer_data_set_size(data, offset + 4 + count * elemsize);
+        ptr = data->bytes->data + offset;
+        *((gint32*)ptr) = (gint32)count;
+        return ptr + 4;
+    }
+}
+
+static
+void
+gbinder_writer_append_array(
+    GBinderWriter* self,
+    const void* values,
+    gssize count,
+    gsize elemsize)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        guint8* dest = gbinder_writer_data_append_array(data,
+            !values && count > 0, count, elemsize);
+
+        if (dest && count > 0) {
+            memcpy(dest, values, count * elemsize);
+        }
+    }
+}
+
+void
+gbinder_writer_append_int32_array(
+    GBinderWriter* self,
+    const gint32* values,
+    gssize count)
+{
+    gbinder_writer_append_array(self, values, count, sizeof(*values));
+}
+
+void
+gbinder_writer_append_int64_array(
+    GBinderWriter* self,
+    const gint64* values,
+    gssize count)
+{
+    gbinder_writer_append_array(self, values, count, sizeof(*values));
+}
+
+void
+gbinder_writer_append_float_array(
+    GBinderWriter* self,
+    const gfloat* values,
+    gssize count)
+{
+    gbinder_writer_append_array(self, values, count, sizeof(*values));
+}
+
+void
+gbinder_writer_append_double_array(
+    GBinderWriter* self,
+    const gdouble* values,
+    gssize count)
+{
+    gbinder_writer_append_array(self, values, count, sizeof(*values));
+}
+
+void
+gbinder_writer_append_bool_array(
+    GBinderWriter* self,
+    const gboolean* values,
+    gssize count)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        /* AIDL booleans are full 32-bit zeros and ones */
+        gint32* dest = (gint32*)gbinder_writer_data_append_array(data,
+            !values && count > 0, count, sizeof(gint32));
+
+        if (dest) {
+            gssize i;
+
+            for (i = 0; i < count; i++) {
+                dest[i] = (values[i] != FALSE);
+            }
+        }
+    }
+}
+
+void
+gbinder_writer_append_string16_array(
+    GBinderWriter* self,
+    const char* const* strv,
+    gssize count)
+{
+    GBinderWriterData* data = gbinder_writer_data(self);
+
+    if (G_LIKELY(data)) {
+        if (count < 0 || (!strv && count > 0)) {
+            gbinder_writer_data_append_int32(data, -1);
+        } else if (count > G_MAXINT32 / 4) {
+            /* Each string takes at least 4 bytes */
+            GWARN("Array is too large (%" G_GSSIZE_FORMAT " elements)", count);
+        } else {
+            gsize size = 4;
+            gssize i;
+
+            /* Reserve enough space for the worst case (one unit per byte) */
+            for (i = 0; i < count; i++) {
+                size += 4 + (strv[i] ? G_ALIGN4((strlen(strv[i]) + 1) * 2) :
+                    0);
+            }
+            gbinder_writer_data_reserve(data, size);
+            gbinder_writer_data_append_int32(data, count);
+            for (i = 0; i < count; i++) {
+                gbinder_writer_data_append_string16(data, strv[i]);
+            }
+        }
+    }
+}
+
 void
 gbinder_writer_append_local_object(
     GBinderWriter* self,
@@ -515,16 +1269,15 @@ gbinder_writer_data_append_local_object(
     GBinderWriterData* data,
     GBinderLocalObject* obj)
 {
-    GByteArray* dest = data->bytes;
-    const guint offset = dest->len;
+    const guint offset = data->bytes->len;
     guint n;
 
     /* Preallocate enough space */
-    g_byte_array_set_size(dest, offset + GBINDER_MAX_BINDER_OBJECT_SIZE);
+    gbinder_writer_data_set_size(data, offset + GBINDER_MAX_BINDER_OBJECT_SIZE);
     /* Write the object */
-    n = data->io->encode_local_object(dest->data + offset, obj);
+    n = data->io->encode_local_object(data->bytes->data + offset, obj);
     /* Fix the data size */
-    g_byte_array_set_size(dest, offset + n);
+    gbinder_writer_data_set_size(data, offset + n);
     /* Record the offset */
     gbinder_writer_data_record_offset(data, offset);
 }
@@ -546,16 +1299,15 @@ gbinder_writer_data_append_remote_object(
     GBinderWriterData* data,
     GBinderRemoteObject* obj)
 {
-    GByteArray* dest = data->bytes;
-    const guint offset = dest->len;
+    const guint offset = data->bytes->len;
     guint n;
 
     /* Preallocate enough space */
-    g_byte_array_set_size(dest, offset + GBINDER_MAX_BINDER_OBJECT_SIZE);
+    gbinder_writer_data_set_size(data, offset + GBINDER_MAX_BINDER_OBJECT_SIZE);
     /* Write the object */
-    n = data->io->encode_remote_object(dest->data + offset, obj);
+    n = data->io->encode_remote_object(data->bytes->data + offset, obj);
     /* Fix the data size */
-    g_byte_array_set_size(dest, offset + n);
+    gbinder_writer_data_set_size(data, offset + n);
     /* Record the offset */
     gbinder_writer_data_record_offset(data, offset);
 }
@@ -35,14 +35,36 @@
 
 #include <gbinder_writer.h>
 
+#include "gbinder_arena.h"
 #include "gbinder_cleanup.h"
 
+/* Location of a value which can be patched after the data are written */
+typedef struct gbinder_writer_slot {
+    guint offset;
+    guint size;
+} GBinderWriterSlot;
+
 typedef struct gbinder_writer_data {
     const GBinderIo* io;
     GByteArray* bytes;
+    /* Caller provided storage, bytes point here until it overflows */
+    GByteArray buf;
+    gsize buf_size;
     GUtilIntArray* offsets;
     gsize buffers_size;
     GBinderCleanup* cleanup;
+    /*
+     * Released as soon as the driver has copied the data. The buffers
+     * referenced by the data are gone after that, so the data can only
+     * be sent once (spent is set after that).
+     */
+    GBinderCleanup* consumed;
+    gboolean spent;
+    GBinderArena* arena;
+    GArray* slots;
+    /* Measuring pass, the data are going to be thrown away */
+    gboolean dry_run;
+    gsize peak_size;
 } GBinderWriterData;
 
 void
@@ -50,6 +72,37 @@ gbinder_writer_init(
     GBinderWriter* writer,
     GBinderWriterData* data);
 
+void
+gbinder_writer_data_init_buf(
+    GBinderWriterData* data,
+    void* buf,
+    gsize size);
+
+void
+gbinder_writer_data_free_bytes(
+    GBinderWriterData* data);
+
+void
+gbinder_writer_data_set_size(
+    GBinderWriterData* data,
+    gsize size);
+
+void
+gbinder_writer_data_append(
+    GBinderWriterData* data,
+    const void* ptr,
+    gsize size);
+
+void
+gbinder_writer_data_reset(
+    GBinderWriterData* data,
+    gsize size);
+
+void
+gbinder_writer_data_reserve(
+    GBinderWriterData* data,
+    gsize size);
+
 void
 gbinder_writer_data_append_int32(
     GBinderWriterData* data,
@@ -60,6 +113,19 @@ gbinder_writer_data_append_int64(
     GBinderWriterData* data,
     guint64 value);
 
+guint
+gbinder_writer_data_add_slot(
+    GBinderWriterData* data,
+    guint size);
+
+gboolean
+gbinder_writer_data_patch(
+    GBinderWriterData* data,
+    const GArray* slots,
+    guint slot,
+    const void* value,
+    guint size);
+
 void
 gbinder_writer_data_append_string8(
     GBinderWriterData* data,
@@ -100,6 +166,33 @@ gbinder_writer_data_append_hidl_string_vec(
     const char* strv[],
     gssize count);
 
+void
+gbinder_writer_data_append_hidl_vec(
+    GBinderWriterData* data,
+    const void* base,
+    guint count,
+    const GBinderHidlType* type);
+
+void
+gbinder_writer_data_append_hidl_struct(
+    GBinderWriterData* data,
+    const void* ptr,
+    const GBinderHidlType* type);
+
+void
+gbinder_writer_data_append_hidl_byte_vec(
+    GBinderWriterData* data,
+    const void* bytes,
+    gsize size,
+    GDestroyNotify destroy,
+    gpointer user_data);
+
+void
+gbinder_writer_data_append_byte_array(
+    GBinderWriterData* data,
+    const void* bytes,
+    gssize len);
+
 void
 gbinder_writer_data_append_local_object(
     GBinderWriterData* data,
@@ -77,22 +77,13 @@ typedef struct radio_response_info {
     guint32 error;
 } RadioResponseInfo;
 
-typedef struct radio_string {
-    union {
-        guint64 value;
-        const char* str;
-    } data;
-    guint32 len;
-    guint32 owns_buffer;
-} RadioString;
-
 typedef struct radio_app_status {
     guint32 appType;
     guint32 appState;
     guint32 persoSubstate;
     guint32 unused1;
-    RadioString aid;
-    RadioString label;
+    GBinderHidlString aid;
+    GBinderHidlString label;
     guint32 pinReplaced;
     guint32 pin1;
     guint32 pin2;
@@ -106,14 +97,32 @@ typedef struct radio_card_status {
     guint32 cdmaSubscriptionAppIndex;
     guint32 imsSubscriptionAppIndex;
     guint32 unused1;
-    union {
-        guint64 value;
-        const RadioAppStatus* array;
-    } apps;
-    guint32 numApps;
-    guint32 unused2;
+    GBinderHidlVec apps;
 } RadioCardStatus;
 
+static const GBinderHidlField radio_app_status_fields[] = {
+    GBINDER_HIDL_FIELD_STRING(RadioAppStatus, aid),
+    GBINDER_HIDL_FIELD_STRING(RadioAppStatus, label),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType radio_app_status_type = {
+    "AppStatus", sizeof(RadioAppStatus), radio_app_status_fields
+};
+
+static const GBinderHidlField radio_card_status_fields[] = {
+    GBINDER_HIDL_FIELD_VEC(RadioCardStatus, apps, &radio_app_status_type),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType radio_card_status_type = {
+    "CardStatus", sizeof(RadioCardStatus), radio_card_status_fields
+};
+
+static const GBinderHidlType radio_response_info_type = {
+    "RadioResponseInfo", sizeof(RadioResponseInfo), NULL
+};
+
 static const char pname[] = "binder-client";
 
 static
@@ -164,48 +173,41 @@ app_decode_card_status(
     GBinderRemoteRequest* req)
 {
     GBinderReader reader;
-    GBinderBuffer* buf;
+    const RadioResponseInfo* info;
 
     gbinder_remote_request_init_reader(req, &reader);
-    /* RadioResponseInfo */
-    buf = gbinder_reader_read_buffer(&reader);
-    if (buf) {
-        const RadioResponseInfo* info = buf->data;
+    info = gbinder_reader_read_hidl_struct(&reader, &radio_response_info_type);
+    if (info) {
+        const RadioCardStatus* status;
 
-        GASSERT(sizeof(*info) == buf->size);
         GDEBUG("RadioResponseInfo: type=%d serial=%d error=%d",
             (int)info->type, (int)info->serial, (int)info->error);
-        app_dump(buf->data, buf->size);
-        gbinder_buffer_free(buf);
+        app_dump(info, sizeof(*info));
 
-        /* CardStatus */
-        buf = gbinder_reader_read_buffer(&reader);
-        if (buf) {
+        /* CardStatus, including the apps and their strings */
+        status = gbinder_reader_read_hidl_struct(&reader,
+            &radio_card_status_type);
+        if (status) {
+            const RadioAppStatus* apps = status->apps.data.ptr;
             guint i;
-            const RadioCardStatus* status = buf->data;
 
             GINFO("CardStatus: state=%d pinState=%d gsmSubIndex=%d "
                 "cdmsSubIndex=%d imsSubIndex=%d appCount=%u",
                 (int)status->cardState, (int)status->universalPinState,
                 (int)status->gsmUmtsSubscriptionAppIndex,
                 (int)status->cdmaSubscriptionAppIndex,
-                (int)status->imsSubscriptionAppIndex, status->numApps);
-            GASSERT(sizeof(*status) == buf->size);
-            app_dump(buf->data, buf->size);
-            gbinder_buffer_free(buf);
+                (int)status->imsSubscriptionAppIndex, status->apps.count);
+            app_dump(status, sizeof(*status));
 
-            for (i = 0; i < status->numApps; i++) {
-                const RadioAppStatus* app = status->apps.array + i;
+            for (i = 0; i < status->apps.count; i++) {
+                const RadioAppStatus* app = apps + i;
 
-                buf = gbinder_reader_read_buffer(&reader);
-                GASSERT(buf->size == sizeof(RadioAppStatus));
                 GINFO("AppStatus: type=%u state=%u substate=%u aid=%s "
                     "label=%s pin_replaced=%u pin1=%u pin2=%u",
                     app->appType, app->appState, app->persoSubstate,
                     app->aid.data.str, app->label.data.str,
                     app->pinReplaced, app->pin1, app->pin2);
-                app_dump(buf->data, buf->size);
-                gbinder_buffer_free(buf);
+                app_dump(app, sizeof(*app));
             }
         }
     }
@@ -30,6 +30,7 @@
  * THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "gbinder_local_object_p.h"
 #include "gbinder_system.h"
 
 #include <gutil_log.h>
@@ -270,6 +271,16 @@ test_binder_fill_transaction_data(
     tr->data_buffer = (gsize)g_memdup(bytes->data, bytes->len);
 }
 
+/* The real driver passes back the cookie which came with the object */
+static
+guint64
+test_binder_cookie(
+    void* ptr)
+{
+    return (ptr && G_TYPE_CHECK_INSTANCE_TYPE(ptr,
+        GBINDER_TYPE_LOCAL_OBJECT)) ? GBINDER_LOCAL_OBJECT(ptr)->cookie : 0;
+}
+
 gboolean
 test_binder_push_ptr_cookie(
     int fd,
@@ -282,6 +293,7 @@ test_binder_push_ptr_cookie(
     memcpy(buf, &cmd, sizeof(cmd));
     memset(data, 0, sizeof(*data));
     data->ptr = (gsize)ptr;
+    data->cookie = test_binder_cookie(ptr);
     return test_binder_push_data(fd, buf);
 }
 
@@ -376,14 +388,49 @@ test_binder_br_transaction(
 {
     guint32 cmd = BR_TRANSACTION_64;
     guint8 buf[sizeof(guint32) + sizeof(BinderTransactionData64)];
+    BinderTransactionData64* tr = (void*)(buf + sizeof(cmd));
 
     memcpy(buf, &cmd, sizeof(cmd));
-    test_binder_fill_transaction_data((void*)(buf + sizeof(cmd)),
-        (gsize)target, code, bytes);
+    test_binder_fill_transaction_data(tr, (gsize)target, code, bytes);
+    tr->cookie = test_binder_cookie(target);
 
     return test_binder_push_data(fd, buf);
 }
 
+gboolean
+test_binder_br_transaction_oneway_from(
+    int fd,
+    void* target,
+    guint32 code,
+    const GByteArray* bytes,
+    uid_t euid)
+{
+    guint32 cmd = BR_TRANSACTION_64;
+    guint8 buf[sizeof(guint32) + sizeof(BinderTransactionData64)];
+    BinderTransactionData64* tr = (void*)(buf + sizeof(cmd));
+
+    memcpy(buf, &cmd, sizeof(cmd));
+    test_binder_fill_transaction_data(tr, (gsize)target, code, bytes);
+    tr->cookie = test_binder_cookie(target);
+    tr->flags |= TF_ONE_WAY;
+    /* Like the kernel, never reveal the pid of a one-way caller */
+    tr->sender_pid = 0;
+    tr->sender_euid = euid;
+
+    return test_binder_push_data(fd, buf);
+}
+
+gboolean
+test_binder_br_transaction_oneway(
+    int fd,
+    void* target,
+    guint32 code,
+    const GByteArray* bytes)
+{
+    return test_binder_br_transaction_oneway_from(fd, target, code, bytes,
+        geteuid());
+}
+
 gboolean
 test_binder_br_reply(
     int fd,
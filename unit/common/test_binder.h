@@ -82,6 +82,20 @@ test_binder_br_transaction(
     void* target,
     guint32 code,
     const GByteArray* bytes);
+gboolean
+test_binder_br_transaction_oneway(
+    int fd,
+    void* target,
+    guint32 code,
+    const GByteArray* bytes);
+
+gboolean
+test_binder_br_transaction_oneway_from(
+    int fd,
+    void* target,
+    guint32 code,
+    const GByteArray* bytes,
+    uid_t euid);
 
 gboolean
 test_binder_br_reply(
@@ -36,11 +36,12 @@
 #include "gbinder_driver.h"
 #include "gbinder_ipc.h"
 #include "gbinder_local_reply_p.h"
-#include "gbinder_local_request.h"
+#include "gbinder_local_request_p.h"
 #include "gbinder_object_registry.h"
 #include "gbinder_output_data.h"
 #include "gbinder_remote_object_p.h"
 #include "gbinder_remote_reply.h"
+#include "gbinder_writer.h"
 
 #include <gutil_log.h>
 
@@ -80,6 +81,8 @@ test_null(
     g_assert(!gbinder_client_ref(null));
     gbinder_client_unref(null);
     g_assert(!gbinder_client_new_request(NULL));
+    g_assert(!gbinder_client_new_request2(NULL, 0));
+    g_assert(!gbinder_client_init_request(NULL, NULL, 0));
     g_assert(!gbinder_client_transact_sync_reply(null, 0, NULL, NULL));
     g_assert(gbinder_client_transact_sync_oneway(null, 0, NULL) == (-EINVAL));
     g_assert(!gbinder_client_transact(null, 0, 0, NULL, NULL, NULL, NULL));
@@ -138,6 +141,113 @@ test_sync_oneway(
     gbinder_client_unref(client);
 }
 
+/*==========================================================================*
+ * blob
+ *==========================================================================*/
+
+static
+void
+test_blob_destroy(
+    gpointer data)
+{
+    (*((int*)data))++;
+}
+
+static
+void
+test_blob(
+    void)
+{
+    static const guint8 blob[] = { 0x01, 0x02, 0x03, 0x04 };
+    GBinderClient* client = test_client_new(0, "foo");
+    GBinderLocalRequest* req = gbinder_client_new_request(client);
+    int fd = gbinder_driver_fd(gbinder_client_ipc(client)->driver);
+    GBinderWriter writer;
+    int count = 0;
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_byte_vec(&writer, blob, sizeof(blob),
+        test_blob_destroy, &count);
+    test_binder_br_transaction_complete(fd);
+    g_assert(gbinder_client_transact_sync_oneway(client, 0, req) ==
+        GBINDER_STATUS_OK);
+
+    /* The blob is released even though the request is still alive */
+    g_assert(count == 1);
+
+    /* And therefore the request can't be sent again */
+    g_assert(gbinder_client_transact_sync_oneway(client, 0, req) !=
+        GBINDER_STATUS_OK);
+    gbinder_local_request_unref(req);
+    g_assert(count == 1);
+
+    /* The size must fit into 32 bits, the blob is released anyway */
+    if (sizeof(gsize) > sizeof(guint32)) {
+        req = gbinder_client_new_request(client);
+        gbinder_local_request_init_writer(req, &writer);
+        gbinder_writer_append_hidl_byte_vec(&writer, blob,
+            (gsize)G_MAXUINT32 + 1, test_blob_destroy, &count);
+        g_assert(count == 2);
+        gbinder_local_request_unref(req);
+    }
+    gbinder_client_unref(client);
+}
+
+/*==========================================================================*
+ * size_hint
+ *==========================================================================*/
+
+#define TEST_SIZE_HINT_CODE (3)
+#define TEST_SIZE_HINT_COUNT (256)
+
+static
+void
+test_size_hint(
+    void)
+{
+    GBinderClient* client = test_client_new(0, "foo");
+    GBinderLocalRequest* req = gbinder_client_new_request2(client,
+        TEST_SIZE_HINT_CODE);
+    int fd = gbinder_driver_fd(gbinder_client_ipc(client)->driver);
+    GBinderOutputData* data;
+    const guint8* ptr;
+    guint i;
+
+    /* Nothing is known about this code yet */
+    g_assert(req);
+    for (i = 0; i < TEST_SIZE_HINT_COUNT; i++) {
+        gbinder_local_request_append_int32(req, i);
+    }
+    test_binder_br_transaction_complete(fd);
+    g_assert(gbinder_client_transact_sync_oneway(client,
+        TEST_SIZE_HINT_CODE, req) == GBINDER_STATUS_OK);
+    gbinder_local_request_unref(req);
+
+    /* The next request for the same code is presized */
+    req = gbinder_client_new_request2(client, TEST_SIZE_HINT_CODE);
+    data = gbinder_local_request_data(req);
+    ptr = data->bytes->data;
+    for (i = 0; i < TEST_SIZE_HINT_COUNT; i++) {
+        gbinder_local_request_append_int32(req, i);
+    }
+    g_assert(data->bytes->data == ptr);
+    gbinder_local_request_unref(req);
+
+    /* Explicit size hint works too */
+    req = gbinder_client_new_request(client);
+    g_assert(gbinder_local_request_reserve(req, TEST_SIZE_HINT_COUNT * 4) ==
+        req);
+    data = gbinder_local_request_data(req);
+    ptr = data->bytes->data;
+    for (i = 0; i < TEST_SIZE_HINT_COUNT; i++) {
+        gbinder_local_request_append_int32(req, i);
+    }
+    g_assert(data->bytes->data == ptr);
+    gbinder_local_request_unref(req);
+
+    gbinder_client_unref(client);
+}
+
 /*==========================================================================*
  * sync_reply
  *==========================================================================*/
@@ -198,6 +308,69 @@ test_sync_reply(
     gbinder_client_unref(client);
 }
 
+/*==========================================================================*
+ * in_buf
+ *==========================================================================*/
+
+#define TEST_IN_BUF_COUNT (256)
+
+static
+void
+test_in_buf(
+    void)
+{
+    GBinderClient* client = test_client_new(0, "foo");
+    GBinderLocalRequest* basic = gbinder_client_new_request(client);
+    const GByteArray* header = gbinder_local_request_data(basic)->bytes;
+    guint64 buf[64];
+    guint8 small[8];
+    GBinderLocalRequest* req;
+    GBinderOutputData* data;
+    guint i;
+
+    /* The request lives in the stack buffer, along with its data */
+    req = gbinder_client_init_request(client, buf, sizeof(buf));
+    g_assert(req);
+    g_assert((void*)req >= (void*)buf);
+    g_assert((void*)req < (void*)(buf + G_N_ELEMENTS(buf)));
+    gbinder_local_request_append_int32(req, 42);
+    data = gbinder_local_request_data(req);
+    g_assert(data->bytes->len == header->len + 4);
+    g_assert(!memcmp(data->bytes->data, header->data, header->len));
+    g_assert(data->bytes->data > (guint8*)buf);
+    g_assert(data->bytes->data < (guint8*)(buf + G_N_ELEMENTS(buf)));
+
+    /* It can't be sent asynchronously, the storage may be gone by then */
+    g_assert(!gbinder_client_transact(client, 0, 0, req, NULL, NULL, NULL));
+    g_assert(!gbinder_ipc_transact(gbinder_client_ipc(client), 0, 0, 0, req,
+        NULL, NULL, NULL));
+    test_sync_reply_tx(client, req);
+    gbinder_local_request_unref(req);
+
+    /* Data which don't fit are moved to the heap */
+    req = gbinder_client_init_request(client, buf, sizeof(buf));
+    for (i = 0; i < TEST_IN_BUF_COUNT; i++) {
+        gbinder_local_request_append_int32(req, i);
+    }
+    data = gbinder_local_request_data(req);
+    g_assert(data->bytes->len == header->len + 4 * TEST_IN_BUF_COUNT);
+    g_assert(!memcmp(data->bytes->data, header->data, header->len));
+    g_assert(((guint32*)(data->bytes->data + header->len))
+        [TEST_IN_BUF_COUNT - 1] == TEST_IN_BUF_COUNT - 1);
+    test_sync_reply_tx(client, req);
+    gbinder_local_request_unref(req);
+
+    /* The buffer is too small even for the request itself */
+    req = gbinder_client_init_request(client, small, sizeof(small));
+    g_assert(req);
+    g_assert((void*)req != (void*)small);
+    test_sync_reply_tx(client, req);
+    gbinder_local_request_unref(req);
+
+    gbinder_local_request_unref(basic);
+    gbinder_client_unref(client);
+}
+
 /*==========================================================================*
  * reply
  *==========================================================================*/
@@ -333,7 +506,10 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "null", test_null);
     g_test_add_func(TEST_PREFIX "basic", test_basic);
     g_test_add_func(TEST_PREFIX "sync_oneway", test_sync_oneway);
+    g_test_add_func(TEST_PREFIX "blob", test_blob);
+    g_test_add_func(TEST_PREFIX "size_hint", test_size_hint);
     g_test_add_func(TEST_PREFIX "sync_reply", test_sync_reply);
+    g_test_add_func(TEST_PREFIX "in_buf", test_in_buf);
     g_test_add_func(TEST_PREFIX "reply/ok1", test_reply_ok1);
     g_test_add_func(TEST_PREFIX "reply/ok2", test_reply_ok2);
     g_test_add_func(TEST_PREFIX "reply/ok3", test_reply_ok3);
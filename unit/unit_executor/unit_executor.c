@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _GNU_SOURCE
+#  define _GNU_SOURCE /* CPU_SET, sched_getaffinity */
+#endif
+
+#include "test_common.h"
+
+#include "gbinder_executor.h"
+#include "gbinder_sched.h"
+
+#include <gutil_macros.h>
+
+#include <sched.h>
+#include <sys/prctl.h>
+
+static TestOpt test_opt;
+
+typedef struct test_executor_data {
+    GMutex mutex;
+    GCond cond;
+    int started;
+    int done;
+    int wait_for;
+    GBinderExecutor* executor;
+} TestExecutorData;
+
+typedef struct test_executor_work {
+    GBinderExecutorWork work;
+    TestExecutorData* test;
+} TestExecutorWork;
+
+static
+void
+test_executor_data_init(
+    TestExecutorData* test)
+{
+    memset(test, 0, sizeof(*test));
+    g_mutex_init(&test->mutex);
+    g_cond_init(&test->cond);
+}
+
+static
+void
+test_executor_data_wait(
+    TestExecutorData* test,
+    int done)
+{
+    g_mutex_lock(&test->mutex);
+    while (test->done < done) {
+        g_cond_wait(&test->cond, &test->mutex);
+    }
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_executor_data_clear(
+    TestExecutorData* test)
+{
+    g_mutex_clear(&test->mutex);
+    g_cond_clear(&test->cond);
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    GBinderExecutorWork work;
+
+    memset(&work, 0, sizeof(work));
+    gbinder_executor_free(NULL);
+    gbinder_executor_push(NULL, &work);
+    gbinder_executor_set_min_threads(NULL, 0);
+    gbinder_executor_set_sched(NULL, NULL);
+    g_assert(!gbinder_executor_threads(NULL));
+    g_assert(!gbinder_sched_ref(NULL));
+    gbinder_sched_unref(NULL);
+    gbinder_sched_apply(NULL);
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+#define TEST_BASIC_COUNT (100)
+
+static
+void
+test_basic_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+
+    g_mutex_lock(&test->mutex);
+    test->done++;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_basic(
+    void)
+{
+    GBinderExecutorWork work[TEST_BASIC_COUNT];
+    TestExecutorData test;
+    GBinderExecutor* executor;
+    int i;
+
+    test_executor_data_init(&test);
+    executor = gbinder_executor_new("test", test_basic_proc, &test, 2, 4);
+
+    /* Minimum number of threads is started right away */
+    g_assert(gbinder_executor_threads(executor) == 2);
+    for (i = 0; i < TEST_BASIC_COUNT; i++) {
+        gbinder_executor_push(executor, work + i);
+    }
+    test_executor_data_wait(&test, TEST_BASIC_COUNT);
+    g_assert(gbinder_executor_threads(executor) <= 4);
+    gbinder_executor_set_min_threads(executor, 3);
+    g_assert(gbinder_executor_threads(executor) >= 3);
+    gbinder_executor_free(executor);
+    g_assert(test.done == TEST_BASIC_COUNT);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * concurrent
+ *==========================================================================*/
+
+#define TEST_CONCURRENT_COUNT (16)
+
+static
+void
+test_concurrent_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+
+    /* Blocks until all work items are running at the same time */
+    g_mutex_lock(&test->mutex);
+    test->started++;
+    g_cond_broadcast(&test->cond);
+    while (test->started < TEST_CONCURRENT_COUNT) {
+        g_cond_wait(&test->cond, &test->mutex);
+    }
+    test->done++;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_concurrent(
+    void)
+{
+    GBinderExecutorWork work[TEST_CONCURRENT_COUNT];
+    TestExecutorData test;
+    GBinderExecutor* executor;
+    int i;
+
+    test_executor_data_init(&test);
+    executor = gbinder_executor_new("test", test_concurrent_proc, &test, 0,
+        TEST_CONCURRENT_COUNT);
+    g_assert(!gbinder_executor_threads(executor));
+    for (i = 0; i < TEST_CONCURRENT_COUNT; i++) {
+        gbinder_executor_push(executor, work + i);
+    }
+    test_executor_data_wait(&test, TEST_CONCURRENT_COUNT);
+    g_assert(gbinder_executor_threads(executor) == TEST_CONCURRENT_COUNT);
+    gbinder_executor_free(executor);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * push_from_worker
+ *==========================================================================*/
+
+#define TEST_PUSH_COUNT (10)
+
+static
+void
+test_push_from_worker_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+    TestExecutorWork* item = G_CAST(work, TestExecutorWork, work);
+    TestExecutorWork* next = item + 1;
+
+    /* Each work item schedules the next one */
+    g_mutex_lock(&test->mutex);
+    test->done++;
+    if (test->done < TEST_PUSH_COUNT) {
+        gbinder_executor_push(test->executor, &next->work);
+    }
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_push_from_worker(
+    void)
+{
+    TestExecutorWork work[TEST_PUSH_COUNT];
+    TestExecutorData test;
+
+    test_executor_data_init(&test);
+    memset(work, 0, sizeof(work));
+    test.executor = gbinder_executor_new("test",
+        test_push_from_worker_proc, &test, 1, 2);
+    gbinder_executor_push(test.executor, &work[0].work);
+    test_executor_data_wait(&test, TEST_PUSH_COUNT);
+    gbinder_executor_free(test.executor);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * free_from_worker
+ *==========================================================================*/
+
+static
+void
+test_free_from_worker_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+
+    /* Executor gets deallocated by the worker thread */
+    gbinder_executor_free(test->executor);
+    g_mutex_lock(&test->mutex);
+    test->done++;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_free_from_worker(
+    void)
+{
+    GBinderExecutorWork work;
+    TestExecutorData test;
+
+    test_executor_data_init(&test);
+    test.executor = gbinder_executor_new("test",
+        test_free_from_worker_proc, &test, 2, 2);
+    gbinder_executor_push(test.executor, &work);
+    test_executor_data_wait(&test, 1);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * cancel
+ *==========================================================================*/
+
+static
+void
+test_cancel_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+
+    /* Blocks until released */
+    g_mutex_lock(&test->mutex);
+    test->started++;
+    g_cond_broadcast(&test->cond);
+    while (test->wait_for) {
+        g_cond_wait(&test->cond, &test->mutex);
+    }
+    test->done++;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_cancel(
+    void)
+{
+    GBinderExecutorWork work[3];
+    TestExecutorData test;
+    GBinderExecutor* executor;
+
+    test_executor_data_init(&test);
+    memset(work, 0, sizeof(work));
+    test.wait_for = 1;
+    executor = gbinder_executor_new("test", test_cancel_proc, &test, 1, 1);
+
+    /* Wait until the first one is running */
+    gbinder_executor_push(executor, work);
+    g_mutex_lock(&test.mutex);
+    while (!test.started) {
+        g_cond_wait(&test.cond, &test.mutex);
+    }
+    g_mutex_unlock(&test.mutex);
+
+    /* These two are stuck in the queue */
+    gbinder_executor_push(executor, work + 1);
+    gbinder_executor_push(executor, work + 2);
+    g_assert(!gbinder_executor_cancel(NULL, work + 1));
+    g_assert(!gbinder_executor_cancel(executor, NULL));
+    g_assert(!gbinder_executor_cancel(executor, work)); /* Running */
+    g_assert(gbinder_executor_cancel(executor, work + 1));
+    g_assert(!gbinder_executor_cancel(executor, work + 1)); /* Not anymore */
+
+    /* Release the running one, the remaining one completes too */
+    g_mutex_lock(&test.mutex);
+    test.wait_for = 0;
+    g_cond_broadcast(&test.cond);
+    g_mutex_unlock(&test.mutex);
+    test_executor_data_wait(&test, 2);
+    g_assert(!gbinder_executor_cancel(executor, work + 2));
+    gbinder_executor_free(executor);
+    g_assert(test.done == 2);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * sched
+ *==========================================================================*/
+
+#define TEST_SCHED_NAME "test-sched"
+#define TEST_SCHED_NAME2 "test-sched2"
+
+typedef struct test_sched_work {
+    GBinderExecutorWork work;
+    char name[16];
+    int cpus;
+} TestSchedWork;
+
+static
+void
+test_sched_proc(
+    GBinderExecutorWork* work,
+    void* user_data)
+{
+    TestExecutorData* test = user_data;
+    TestSchedWork* sw = G_CAST(work, TestSchedWork, work);
+    cpu_set_t set;
+
+    prctl(PR_GET_NAME, sw->name, 0, 0, 0);
+    CPU_ZERO(&set);
+    g_assert(!sched_getaffinity(0, sizeof(set), &set));
+    sw->cpus = CPU_COUNT(&set);
+    g_mutex_lock(&test->mutex);
+    test->done++;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_sched(
+    void)
+{
+    GBinderThreadParams params;
+    GBinderExecutor* executor;
+    GBinderSched* sched;
+    TestExecutorData test;
+    TestSchedWork work[4];
+    cpu_set_t set;
+    int cpus;
+    guint i;
+
+    /* NULL parameters are the defaults, empty ones change nothing */
+    sched = gbinder_sched_new(NULL);
+    g_assert(sched);
+    gbinder_sched_unref(sched);
+    memset(&params, 0, sizeof(params));
+    sched = gbinder_sched_new(&params);
+    g_assert(sched);
+    gbinder_sched_unref(sched);
+
+    /* Name and a single CPU, neither requires privileges */
+    params.name = TEST_SCHED_NAME;
+    CPU_ZERO(&set);
+    g_assert(!sched_getaffinity(0, sizeof(set), &set));
+    cpus = CPU_COUNT(&set);
+    for (i = 0; i < 64 && !params.cpu_mask; i++) {
+        if (CPU_ISSET(i, &set)) {
+            params.cpu_mask = G_GUINT64_CONSTANT(1) << i;
+        }
+    }
+    sched = gbinder_sched_new(&params);
+    g_assert(sched);
+    g_assert(gbinder_sched_ref(sched) == sched);
+    gbinder_sched_unref(sched);
+
+    /* The thread is already running when the parameters get applied */
+    memset(work, 0, sizeof(work));
+    test_executor_data_init(&test);
+    executor = gbinder_executor_new("test", test_sched_proc, &test, 1, 1);
+    g_assert(gbinder_executor_threads(executor) == 1);
+    gbinder_executor_set_sched(executor, sched);
+    gbinder_sched_unref(sched);
+    gbinder_executor_push(executor, &work[0].work);
+    test_executor_data_wait(&test, 1);
+    g_assert(!g_strcmp0(work[0].name, TEST_SCHED_NAME));
+    g_assert(work[0].cpus == 1);
+
+    /* Clearing the parameters doesn't undo anything */
+    gbinder_executor_set_sched(executor, NULL);
+    gbinder_executor_push(executor, &work[1].work);
+    test_executor_data_wait(&test, 2);
+    g_assert(!g_strcmp0(work[1].name, TEST_SCHED_NAME));
+    g_assert(work[1].cpus == 1);
+
+    /* Changing just the name leaves the affinity alone */
+    memset(&params, 0, sizeof(params));
+    params.name = TEST_SCHED_NAME2;
+    sched = gbinder_sched_new(&params);
+    gbinder_executor_set_sched(executor, sched);
+    gbinder_sched_unref(sched);
+    gbinder_executor_push(executor, &work[2].work);
+    test_executor_data_wait(&test, 3);
+    g_assert(!g_strcmp0(work[2].name, TEST_SCHED_NAME2));
+    g_assert(work[2].cpus == 1);
+
+    /* But the defaults restore the affinity (the name stays) */
+    sched = gbinder_sched_new(NULL);
+    gbinder_executor_set_sched(executor, sched);
+    gbinder_sched_unref(sched);
+    gbinder_executor_push(executor, &work[3].work);
+    test_executor_data_wait(&test, 4);
+    g_assert(!g_strcmp0(work[3].name, TEST_SCHED_NAME2));
+    g_assert(work[3].cpus == cpus);
+    gbinder_executor_free(executor);
+    test_executor_data_clear(&test);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/executor/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_null);
+    g_test_add_func(TEST_PREFIX "basic", test_basic);
+    g_test_add_func(TEST_PREFIX "concurrent", test_concurrent);
+    g_test_add_func(TEST_PREFIX "push_from_worker", test_push_from_worker);
+    g_test_add_func(TEST_PREFIX "free_from_worker", test_free_from_worker);
+    g_test_add_func(TEST_PREFIX "cancel", test_cancel);
+    g_test_add_func(TEST_PREFIX "sched", test_sched);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
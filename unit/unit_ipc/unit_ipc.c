@@ -75,10 +75,12 @@ test_null(
     g_assert(!gbinder_ipc_object_registry(null));
     gbinder_ipc_looper_check(null);
     gbinder_ipc_cancel(null, 0);
+    g_assert(!gbinder_ipc_prewarm(null, 0, NULL));
+    gbinder_ipc_set_thread_params(null, GBINDER_THREADS_LOOPER, NULL);
 
     g_assert(!gbinder_object_registry_ref(NULL));
     gbinder_object_registry_unref(NULL);
-    g_assert(!gbinder_object_registry_get_local(NULL, NULL));
+    g_assert(!gbinder_object_registry_get_local(NULL, NULL, 0));
     g_assert(!gbinder_object_registry_get_remote(NULL, 0));
 }
 
@@ -427,6 +429,211 @@ test_transact_status(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * transact_direct_reply
+ *==========================================================================*/
+
+typedef struct test_direct_reply_data {
+    GMainLoop* loop;
+    GThread* main_thread;
+    gboolean replied;
+} TestDirectReplyData;
+
+static
+void
+test_transact_direct_reply_destroy(
+    void* user_data)
+{
+    TestDirectReplyData* test = user_data;
+
+    /* Destroy callback is still invoked on the main thread */
+    GVERBOSE_("");
+    g_assert(test->main_thread == g_thread_self());
+    test_quit_later(test->loop);
+}
+
+static
+void
+test_transact_direct_reply_done(
+    GBinderIpc* ipc,
+    GBinderRemoteReply* reply,
+    int status,
+    void* user_data)
+{
+    TestDirectReplyData* test = user_data;
+    char* result = gbinder_remote_reply_read_string16(reply);
+
+    GVERBOSE_("");
+    g_assert(test->main_thread != g_thread_self());
+    g_assert(!g_strcmp0(result, TEST_REQ_PARAM_STR));
+    g_assert(status == GBINDER_STATUS_OK);
+    g_free(result);
+    test->replied = TRUE;
+}
+
+static
+void
+test_transact_direct_reply(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderLocalReply* reply = gbinder_local_reply_new(io);
+    GBinderOutputData* data;
+    TestDirectReplyData test;
+    const guint32 handle = 0;
+    const guint32 code = 1;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    test.main_thread = g_thread_self();
+
+    g_assert(gbinder_local_reply_append_string16(reply, TEST_REQ_PARAM_STR));
+    data = gbinder_local_reply_data(reply);
+    g_assert(data);
+
+    g_assert(test_binder_br_noop(fd));
+    g_assert(test_binder_br_transaction_complete(fd));
+    g_assert(test_binder_br_noop(fd));
+    g_assert(test_binder_br_reply(fd, handle, code, data->bytes));
+
+    g_assert(gbinder_ipc_transact(ipc, handle, code,
+        GBINDER_TX_FLAG_DIRECT_REPLY, req, test_transact_direct_reply_done,
+        test_transact_direct_reply_destroy, &test));
+
+    test_run(&test_opt, test.loop);
+    g_assert(test.replied);
+
+    gbinder_local_request_unref(req);
+    gbinder_local_reply_unref(reply);
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * transact_high_priority
+ *==========================================================================*/
+
+#define TEST_HIGH_PRIORITY_BLOCKERS (64) /* GBINDER_IPC_MAX_TX_THREADS */
+
+typedef struct test_high_priority_data {
+    GMainLoop* loop;
+    GMutex mutex;
+    GCond cond;
+    gboolean released;
+    int started;
+    int blocked;
+} TestHighPriorityData;
+
+static
+void
+test_transact_high_priority_block(
+    const GBinderIpcTx* tx)
+{
+    TestHighPriorityData* test = tx->user_data;
+
+    GVERBOSE_("");
+    g_mutex_lock(&test->mutex);
+    test->started++;
+    g_cond_broadcast(&test->cond);
+    while (!test->released) {
+        g_cond_wait(&test->cond, &test->mutex);
+    }
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_transact_high_priority_unblock(
+    void* user_data)
+{
+    TestHighPriorityData* test = user_data;
+
+    GVERBOSE_("");
+    g_assert(test->blocked > 0);
+    test->blocked--;
+    if (!test->blocked) {
+        test_quit_later(test->loop);
+    }
+}
+
+static
+void
+test_transact_high_priority_done(
+    GBinderIpc* ipc,
+    GBinderRemoteReply* reply,
+    int status,
+    void* user_data)
+{
+    TestHighPriorityData* test = user_data;
+
+    /* All normal transactions are still stuck */
+    GVERBOSE_("");
+    g_assert(status == GBINDER_STATUS_OK);
+    g_assert(test->blocked == TEST_HIGH_PRIORITY_BLOCKERS);
+    g_mutex_lock(&test->mutex);
+    test->released = TRUE;
+    g_cond_broadcast(&test->cond);
+    g_mutex_unlock(&test->mutex);
+}
+
+static
+void
+test_transact_high_priority(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderLocalReply* reply = gbinder_local_reply_new(io);
+    GBinderOutputData* data;
+    TestHighPriorityData test;
+    const guint32 handle = 0;
+    const guint32 code = 1;
+    int i;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    g_mutex_init(&test.mutex);
+    g_cond_init(&test.cond);
+
+    /* Occupy all normal priority threads */
+    for (i = 0; i < TEST_HIGH_PRIORITY_BLOCKERS; i++) {
+        g_assert(gbinder_ipc_transact_custom(ipc,
+            test_transact_high_priority_block, NULL,
+            test_transact_high_priority_unblock, &test));
+        test.blocked++;
+    }
+
+    g_assert(gbinder_local_reply_append_string16(reply, TEST_REQ_PARAM_STR));
+    data = gbinder_local_reply_data(reply);
+    g_assert(data);
+
+    g_assert(test_binder_br_noop(fd));
+    g_assert(test_binder_br_transaction_complete(fd));
+    g_assert(test_binder_br_noop(fd));
+    g_assert(test_binder_br_reply(fd, handle, code, data->bytes));
+
+    /* This one still gets through */
+    g_assert(gbinder_ipc_transact(ipc, handle, code,
+        GBINDER_TX_FLAG_HIGH_PRIORITY, req, test_transact_high_priority_done,
+        NULL, &test));
+
+    test_run(&test_opt, test.loop);
+    g_assert(test.released);
+    g_assert(!test.blocked);
+
+    gbinder_local_request_unref(req);
+    gbinder_local_reply_unref(reply);
+    gbinder_ipc_unref(ipc);
+    g_mutex_clear(&test.mutex);
+    g_cond_clear(&test.cond);
+    g_main_loop_unref(test.loop);
+}
+
 /*==========================================================================*
  * transact_custom
  *==========================================================================*/
@@ -487,6 +694,156 @@ test_transact_custom2(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * transact_batch
+ *==========================================================================*/
+
+#define TEST_BATCH_COUNT (10)
+
+typedef struct test_batch_data {
+    GMainLoop* loop;
+    int done;
+    int destroyed;
+} TestBatchData;
+
+static
+void
+test_transact_batch_done(
+    const GBinderIpcTx* tx)
+{
+    TestBatchData* test = tx->user_data;
+
+    GVERBOSE_("");
+    test->done++;
+}
+
+static
+void
+test_transact_batch_destroy(
+    void* user_data)
+{
+    TestBatchData* test = user_data;
+
+    GVERBOSE_("");
+    test->destroyed++;
+    g_assert(test->destroyed == test->done);
+    if (test->destroyed == TEST_BATCH_COUNT) {
+        test_quit_later(test->loop);
+    }
+}
+
+static
+void
+test_transact_batch(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    TestBatchData test;
+    int i;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    gbinder_ipc_set_tx_done_batch(NULL, 0);
+    gbinder_ipc_set_tx_done_batch(ipc, 3);
+    for (i = 0; i < TEST_BATCH_COUNT; i++) {
+        g_assert(gbinder_ipc_transact_custom(ipc, NULL,
+            test_transact_batch_done, test_transact_batch_destroy, &test));
+    }
+
+    test_run(&test_opt, test.loop);
+    g_assert(test.done == TEST_BATCH_COUNT);
+
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * transact_stale_id
+ *==========================================================================*/
+
+static
+void
+test_transact_stale_id_done(
+    const GBinderIpcTx* tx)
+{
+    GVERBOSE_("");
+    g_assert(!tx->cancelled);
+    test_quit_later((GMainLoop*)tx->user_data);
+}
+
+static
+void
+test_transact_stale_id(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    gulong id1, id2;
+
+    id1 = gbinder_ipc_transact_custom(ipc, NULL,
+        test_transact_stale_id_done, NULL, loop);
+    g_assert(id1);
+    test_run(&test_opt, loop);
+
+    /* The record gets reused but the id is different */
+    id2 = gbinder_ipc_transact_custom(ipc, NULL,
+        test_transact_stale_id_done, NULL, loop);
+    g_assert(id2);
+    g_assert(id2 != id1);
+
+    /* Stale id doesn't cancel anything */
+    gbinder_ipc_cancel(ipc, id1);
+    test_run(&test_opt, loop);
+
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transact_id_wrap
+ *==========================================================================*/
+
+#define TEST_ID_WRAP_COUNT ((1 << 12) + 1) /* More than 12-bit generation */
+
+static
+void
+test_transact_id_wrap(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    gulong id1, id;
+    guint i;
+
+    id1 = gbinder_ipc_transact_custom(ipc, NULL,
+        test_transact_stale_id_done, NULL, loop);
+    g_assert(id1);
+    test_run(&test_opt, loop);
+
+    /* The same record gets reused over and over again */
+    for (i = 0; i < TEST_ID_WRAP_COUNT; i++) {
+        id = gbinder_ipc_transact_custom(ipc, NULL,
+            test_transact_stale_id_done, NULL, loop);
+        g_assert(id);
+        if (sizeof(gulong) > sizeof(guint32)) {
+            /* The generation is wide enough not to wrap */
+            g_assert(id != id1);
+        }
+        test_run(&test_opt, loop);
+    }
+
+    /* Stale id doesn't cancel anything */
+    id = gbinder_ipc_transact_custom(ipc, NULL,
+        test_transact_stale_id_done, NULL, loop);
+    if (id != id1) {
+        gbinder_ipc_cancel(ipc, id1);
+    }
+    test_run(&test_opt, loop);
+
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(loop);
+}
+
 /*==========================================================================*
  * transact_cancel
  *==========================================================================*/
@@ -579,6 +936,77 @@ test_transact_cancel2(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * transact_cancel_queued
+ *==========================================================================*/
+
+static
+void
+test_transact_cancel_queued_destroy(
+    void* user_data)
+{
+    GVERBOSE_("");
+    *((gboolean*)user_data) = TRUE;
+}
+
+static
+void
+test_transact_cancel_queued_exec(
+    const GBinderIpcTx* tx)
+{
+    g_assert_not_reached();
+}
+
+static
+void
+test_transact_cancel_queued(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    TestHighPriorityData test;
+    gboolean destroyed = FALSE;
+    gulong id;
+    int i;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    g_mutex_init(&test.mutex);
+    g_cond_init(&test.cond);
+
+    /* Occupy all threads (reusing transact_high_priority callbacks) */
+    for (i = 0; i < TEST_HIGH_PRIORITY_BLOCKERS; i++) {
+        g_assert(gbinder_ipc_transact_custom(ipc,
+            test_transact_high_priority_block, NULL,
+            test_transact_high_priority_unblock, &test));
+        test.blocked++;
+    }
+    g_mutex_lock(&test.mutex);
+    while (test.started < TEST_HIGH_PRIORITY_BLOCKERS) {
+        g_cond_wait(&test.cond, &test.mutex);
+    }
+    g_mutex_unlock(&test.mutex);
+
+    /* This one gets queued and is destroyed by gbinder_ipc_cancel() */
+    id = gbinder_ipc_transact_custom(ipc, test_transact_cancel_queued_exec,
+        NULL, test_transact_cancel_queued_destroy, &destroyed);
+    g_assert(id);
+    gbinder_ipc_cancel(ipc, id);
+    g_assert(destroyed);
+
+    /* Release the blockers */
+    g_mutex_lock(&test.mutex);
+    test.released = TRUE;
+    g_cond_broadcast(&test.cond);
+    g_mutex_unlock(&test.mutex);
+    test_run(&test_opt, test.loop);
+    g_assert(!test.blocked);
+
+    gbinder_ipc_unref(ipc);
+    g_mutex_clear(&test.mutex);
+    g_cond_clear(&test.cond);
+    g_main_loop_unref(test.loop);
+}
+
 /*==========================================================================*
  * transact_incoming
  *==========================================================================*/
@@ -721,6 +1149,672 @@ test_transact_status_reply(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * transact_incoming_deferred
+ *==========================================================================*/
+
+typedef struct test_deferred_data {
+    GMainLoop* loop;
+    GBinderRemoteRequest* req;
+    GBinderLocalReply* reply;
+} TestDeferredData;
+
+static
+gboolean
+test_transact_deferred_complete(
+    gpointer user_data)
+{
+    TestDeferredData* test = user_data;
+
+    gbinder_remote_request_complete(test->req, test->reply,
+        GBINDER_STATUS_OK);
+    /* The second completion is ignored */
+    gbinder_remote_request_complete(test->req, NULL, -EFAULT);
+    gbinder_remote_request_unref(test->req);
+    gbinder_local_reply_unref(test->reply);
+    test->req = NULL;
+    test->reply = NULL;
+    return G_SOURCE_REMOVE;
+}
+
+static
+GBinderLocalReply*
+test_transact_deferred_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    TestDeferredData* test = user_data;
+    GBinderLocalReply* reply = gbinder_local_object_new_reply(obj);
+
+    GVERBOSE_("\"%s\" %u", gbinder_remote_request_interface(req), code);
+    g_assert(!flags);
+    gbinder_remote_request_block(req);
+    /* Blocking twice does nothing */
+    gbinder_remote_request_block(req);
+    if (code == 1) {
+        /* Complete it later */
+        g_assert(!test->req);
+        test->req = gbinder_remote_request_ref(req);
+        test->reply = reply;
+        g_idle_add(test_transact_deferred_complete, test);
+    } else {
+        /* Complete it before returning */
+        g_assert(code == 2);
+        gbinder_remote_request_complete(req, reply, GBINDER_STATUS_OK);
+        gbinder_local_reply_unref(reply);
+        test_quit_later(test->loop);
+    }
+
+    /* These are ignored */
+    *status = -EFAULT;
+    return NULL;
+}
+
+static
+void
+test_transact_incoming_deferred(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderLocalObject* obj;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    TestDeferredData test;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    obj = gbinder_ipc_new_local_object(ipc, "test",
+        test_transact_deferred_proc, &test);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+
+    /* The second one may be picked up while the first one is blocked */
+    test_binder_br_transaction(fd, obj, 1, data->bytes);
+    test_binder_br_transaction(fd, obj, 2, data->bytes);
+    test_run(&test_opt, test.loop);
+    g_assert(!test.req);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, test.loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, test.loop);
+
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * transact_incoming_blocked
+ *==========================================================================*/
+
+typedef struct test_blocked_data {
+    GMainLoop* loop;
+    GBinderRemoteRequest* req;
+    const GByteArray* bytes;
+    int fd;
+} TestBlockedData;
+
+static
+GBinderLocalReply*
+test_transact_blocked_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    TestBlockedData* test = user_data;
+    GBinderLocalReply* reply = gbinder_local_object_new_reply(obj);
+
+    GVERBOSE_("\"%s\" %u", gbinder_remote_request_interface(req), code);
+    g_assert(!flags);
+    if (code == 1) {
+        /* Block it and send another one */
+        g_assert(!test->req);
+        gbinder_remote_request_block(req);
+        test->req = gbinder_remote_request_ref(req);
+        test_binder_br_transaction(test->fd, obj, 2, test->bytes);
+        gbinder_local_reply_unref(reply);
+        reply = NULL;
+    } else {
+        /* The first one is still blocked */
+        g_assert(code == 2);
+        g_assert(test->req);
+        gbinder_remote_request_complete(test->req, reply, GBINDER_STATUS_OK);
+        gbinder_remote_request_unref(test->req);
+        test->req = NULL;
+        test_quit_later(test->loop);
+    }
+    *status = GBINDER_STATUS_OK;
+    return reply;
+}
+
+static
+void
+test_transact_incoming_blocked(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderLocalObject* obj;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    TestBlockedData test;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    test.fd = fd;
+    obj = gbinder_ipc_new_local_object(ipc, "test",
+        test_transact_blocked_proc, &test);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+    test.bytes = data->bytes;
+
+    /* The second one gets handled by another looper */
+    test_binder_br_transaction(fd, obj, 1, data->bytes);
+    test_run(&test_opt, test.loop);
+    g_assert(!test.req);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, test.loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, test.loop);
+
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * incoming_drop_oneway
+ *==========================================================================*/
+
+static
+GBinderLocalReply*
+test_incoming_oneway_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    GVERBOSE_("\"%s\" %u", gbinder_remote_request_interface(req), code);
+    g_assert(flags & GBINDER_TX_FLAG_ONEWAY);
+    g_assert(code == 1);
+    test_quit_later((GMainLoop*)user_data);
+    return NULL;
+}
+
+static
+void
+test_incoming_wait(
+    GBinderIpc* ipc,
+    guint count)
+{
+    GBinderIncomingStats stats;
+
+    /* The main thread isn't handling anything while we are waiting */
+    do {
+        g_usleep(1000);
+        g_assert(gbinder_ipc_get_incoming_stats(ipc, &stats));
+    } while (stats.pending + stats.rejected + stats.dropped < count);
+}
+
+static
+void
+test_incoming_drop_oneway(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    GBinderLocalObject* obj = gbinder_ipc_new_local_object
+        (ipc, "test", test_incoming_oneway_proc, loop);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderIncomingStats stats;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    g_assert(!gbinder_ipc_get_incoming_stats(NULL, &stats));
+    g_assert(!gbinder_ipc_get_incoming_stats(ipc, NULL));
+    gbinder_ipc_set_max_pending_incoming(NULL, 1, TRUE);
+    gbinder_ipc_set_max_pending_incoming(ipc, 1, TRUE);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    gbinder_writer_append_string8(&writer, "message");
+    data = gbinder_local_request_data(req);
+
+    /* The second one gets dropped */
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    test_incoming_wait(ipc, 2);
+    test_run(&test_opt, loop);
+
+    g_assert(gbinder_ipc_get_incoming_stats(ipc, &stats));
+    g_assert(!stats.pending);
+    g_assert(stats.peak == 1);
+    g_assert(!stats.rejected);
+    g_assert(stats.dropped == 1);
+    g_assert(gbinder_local_object_get_incoming_stats(obj, &stats));
+    g_assert(stats.dropped == 1);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, loop);
+
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * incoming_reject
+ *==========================================================================*/
+
+static
+void
+test_incoming_reject(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    GBinderLocalObject* obj = gbinder_ipc_new_local_object
+        (ipc, "test", test_incoming_oneway_proc, loop);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderIncomingStats stats;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    g_assert(!gbinder_local_object_get_incoming_stats(NULL, &stats));
+    g_assert(!gbinder_local_object_get_incoming_stats(obj, NULL));
+    gbinder_local_object_set_max_pending(NULL, 1);
+    gbinder_local_object_set_max_pending(obj, 1);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    gbinder_writer_append_string8(&writer, "message");
+    data = gbinder_local_request_data(req);
+
+    /* Two-way transaction is rejected, the handler never sees it */
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    test_binder_br_transaction(fd, obj, 2, data->bytes);
+    test_incoming_wait(ipc, 2);
+    test_run(&test_opt, loop);
+
+    g_assert(gbinder_local_object_get_incoming_stats(obj, &stats));
+    g_assert(!stats.pending);
+    g_assert(stats.peak == 1);
+    g_assert(stats.rejected == 1);
+    g_assert(!stats.dropped);
+    g_assert(gbinder_ipc_get_incoming_stats(ipc, &stats));
+    g_assert(stats.rejected == 1);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, loop);
+
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * incoming_fair
+ *==========================================================================*/
+
+#define TEST_FAIR_EUID1 (1001)
+#define TEST_FAIR_EUID2 (1002)
+#define TEST_FAIR_COUNT (5)
+
+typedef struct test_fair_data {
+    GMainLoop* loop;
+    pid_t pid[TEST_FAIR_COUNT];
+    uid_t euid[TEST_FAIR_COUNT];
+    guint count;
+} TestFairData;
+
+static
+GBinderLocalReply*
+test_incoming_fair_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    TestFairData* test = user_data;
+
+    g_assert(test->count < TEST_FAIR_COUNT);
+    test->pid[test->count] = gbinder_remote_request_sender_pid(req);
+    test->euid[test->count] = gbinder_remote_request_sender_euid(req);
+    if (++(test->count) == TEST_FAIR_COUNT) {
+        test_quit_later(test->loop);
+    }
+    return NULL;
+}
+
+static
+void
+test_incoming_fair(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderCallerStats* stats;
+    GBinderLocalObject* obj;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    TestFairData test;
+    guint i, n = 1;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    obj = gbinder_ipc_new_local_object(ipc, "test", test_incoming_fair_proc,
+        &test);
+
+    g_assert(!gbinder_ipc_get_caller_stats(NULL, &n));
+    g_assert(!n);
+    g_assert(!gbinder_ipc_get_caller_stats(ipc, NULL));
+    gbinder_ipc_set_fair_incoming(NULL, TRUE);
+    gbinder_ipc_set_fair_incoming(ipc, TRUE);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+
+    /*
+     * The second caller doesn't have to wait for the first one. One-way
+     * callers don't have pids, they are told apart by euid. Two-way
+     * calls have a queue of their own.
+     */
+    for (i = 0; i < TEST_FAIR_COUNT - 2; i++) {
+        test_binder_br_transaction_oneway_from(fd, obj, 1, data->bytes,
+            TEST_FAIR_EUID1);
+    }
+    test_binder_br_transaction_oneway_from(fd, obj, 1, data->bytes,
+        TEST_FAIR_EUID2);
+    test_binder_br_transaction(fd, obj, 1, data->bytes);
+    test_incoming_wait(ipc, TEST_FAIR_COUNT);
+    test_run(&test_opt, test.loop);
+
+    g_assert(test.count == TEST_FAIR_COUNT);
+    g_assert(!test.pid[0]);
+    g_assert(test.euid[0] == TEST_FAIR_EUID1);
+    g_assert(!test.pid[1]);
+    g_assert(test.euid[1] == TEST_FAIR_EUID2);
+    g_assert(test.pid[2] == getpid());
+    g_assert(test.euid[2] == geteuid());
+    g_assert(!test.pid[3]);
+    g_assert(test.euid[3] == TEST_FAIR_EUID1);
+    g_assert(!test.pid[4]);
+    g_assert(test.euid[4] == TEST_FAIR_EUID1);
+
+    stats = gbinder_ipc_get_caller_stats(ipc, &n);
+    g_assert(stats);
+    g_assert(n == 3);
+    for (i = 0; i < n; i++) {
+        g_assert(!stats[i].pending);
+        if (stats[i].pid) {
+            g_assert(stats[i].pid == getpid());
+            g_assert(stats[i].euid == geteuid());
+            g_assert(stats[i].handled == 1);
+        } else if (stats[i].euid == TEST_FAIR_EUID1) {
+            g_assert(stats[i].handled == TEST_FAIR_COUNT - 2);
+        } else {
+            g_assert(stats[i].euid == TEST_FAIR_EUID2);
+            g_assert(stats[i].handled == 1);
+        }
+    }
+    g_free(stats);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, test.loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, test.loop);
+
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * incoming_fair/expire
+ *==========================================================================*/
+
+#define TEST_FAIR_MAX_IDLE (64) /* GBINDER_IPC_MAX_IDLE_CALLERS */
+#define TEST_FAIR_EXPIRE_COUNT (TEST_FAIR_MAX_IDLE + 2)
+#define TEST_FAIR_EXPIRE_EUID (2001)
+
+static
+GBinderLocalReply*
+test_incoming_fair_expire_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    TestFairData* test = user_data;
+
+    if (++(test->count) == TEST_FAIR_EXPIRE_COUNT) {
+        test_quit_later(test->loop);
+    }
+    return NULL;
+}
+
+static
+void
+test_incoming_fair_expire(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderCallerStats* stats;
+    GBinderLocalObject* obj;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    TestFairData test;
+    guint i, n = 0;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    obj = gbinder_ipc_new_local_object(ipc, "test",
+        test_incoming_fair_expire_proc, &test);
+    gbinder_ipc_set_fair_incoming(ipc, TRUE);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+
+    /* One call from each euid, they go idle in the same order */
+    for (i = 0; i < TEST_FAIR_EXPIRE_COUNT; i++) {
+        test_binder_br_transaction_oneway_from(fd, obj, 1, data->bytes,
+            TEST_FAIR_EXPIRE_EUID + i);
+    }
+    test_incoming_wait(ipc, TEST_FAIR_EXPIRE_COUNT);
+    test_run(&test_opt, test.loop);
+    g_assert(test.count == TEST_FAIR_EXPIRE_COUNT);
+
+    /* Only the callers which have been idle for longest are gone */
+    stats = gbinder_ipc_get_caller_stats(ipc, &n);
+    g_assert(stats);
+    g_assert(n == TEST_FAIR_MAX_IDLE);
+    for (i = 0; i < n; i++) {
+        g_assert(!stats[i].pid);
+        g_assert(stats[i].euid >= TEST_FAIR_EXPIRE_EUID +
+            (TEST_FAIR_EXPIRE_COUNT - TEST_FAIR_MAX_IDLE));
+        g_assert(stats[i].handled == 1);
+    }
+    g_free(stats);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, test.loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, test.loop);
+
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * incoming_priority
+ *==========================================================================*/
+
+typedef struct test_priority_data {
+    GMainLoop* loop;
+    gboolean other_done;
+    gboolean incoming_done;
+} TestPriorityData;
+
+static
+gboolean
+test_incoming_priority_other(
+    gpointer user_data)
+{
+    TestPriorityData* test = user_data;
+
+    /* Incoming transaction must have been handled by now */
+    g_assert(test->incoming_done);
+    test->other_done = TRUE;
+    test_quit_later(test->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static
+GBinderLocalReply*
+test_incoming_priority_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    TestPriorityData* test = user_data;
+
+    g_assert(!test->other_done);
+    test->incoming_done = TRUE;
+    return NULL;
+}
+
+static
+void
+test_incoming_priority(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const char* dev = gbinder_driver_dev(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderLocalObject* obj;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    TestPriorityData test;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    obj = gbinder_ipc_new_local_object(ipc, "test",
+        test_incoming_priority_proc, &test);
+    gbinder_ipc_set_incoming_priority(NULL, G_PRIORITY_HIGH);
+    gbinder_ipc_set_incoming_priority(ipc, G_PRIORITY_HIGH);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+
+    /* The incoming transaction overtakes the default priority source */
+    g_idle_add_full(G_PRIORITY_DEFAULT, test_incoming_priority_other,
+        &test, NULL);
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    test_incoming_wait(ipc, 1);
+    test_run(&test_opt, test.loop);
+    g_assert(test.incoming_done);
+    g_assert(test.other_done);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_transact_done, test.loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    g_idle_add(test_transact_unref_ipc, ipc);
+    test_run(&test_opt, test.loop);
+
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * prewarm
+ *==========================================================================*/
+
+static
+void
+test_prewarm(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GBinderPrewarmStats stats;
+
+    memset(&stats, 0xff, sizeof(stats));
+    g_assert(gbinder_ipc_prewarm(ipc, 2, &stats));
+    g_assert(stats.looper >= 0);
+    g_assert(stats.threads >= 0);
+    g_assert(stats.tables >= 0);
+    g_assert(stats.total >= stats.looper + stats.threads + stats.tables);
+
+    /* Second time is cheap but still works, stats are optional */
+    g_assert(gbinder_ipc_prewarm(ipc, 0, NULL));
+    gbinder_ipc_unref(ipc);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -739,13 +1833,34 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "transact_dead", test_transact_dead);
     g_test_add_func(TEST_PREFIX "transact_failed", test_transact_failed);
     g_test_add_func(TEST_PREFIX "transact_status", test_transact_status);
+    g_test_add_func(TEST_PREFIX "transact_direct_reply",
+        test_transact_direct_reply);
+    g_test_add_func(TEST_PREFIX "transact_high_priority",
+        test_transact_high_priority);
     g_test_add_func(TEST_PREFIX "transact_custom", test_transact_custom);
     g_test_add_func(TEST_PREFIX "transact_custom2", test_transact_custom2);
+    g_test_add_func(TEST_PREFIX "transact_batch", test_transact_batch);
+    g_test_add_func(TEST_PREFIX "transact_stale_id", test_transact_stale_id);
+    g_test_add_func(TEST_PREFIX "transact_id_wrap", test_transact_id_wrap);
     g_test_add_func(TEST_PREFIX "transact_cancel", test_transact_cancel);
     g_test_add_func(TEST_PREFIX "transact_cancel2", test_transact_cancel2);
+    g_test_add_func(TEST_PREFIX "transact_cancel_queued",
+        test_transact_cancel_queued);
     g_test_add_func(TEST_PREFIX "transact_incoming", test_transact_incoming);
     g_test_add_func(TEST_PREFIX "transact_status_reply",
         test_transact_status_reply);
+    g_test_add_func(TEST_PREFIX "transact_incoming_deferred",
+        test_transact_incoming_deferred);
+    g_test_add_func(TEST_PREFIX "transact_incoming_blocked",
+        test_transact_incoming_blocked);
+    g_test_add_func(TEST_PREFIX "incoming_drop_oneway",
+        test_incoming_drop_oneway);
+    g_test_add_func(TEST_PREFIX "incoming_reject", test_incoming_reject);
+    g_test_add_func(TEST_PREFIX "incoming_fair", test_incoming_fair);
+    g_test_add_func(TEST_PREFIX "incoming_fair/expire",
+        test_incoming_fair_expire);
+    g_test_add_func(TEST_PREFIX "incoming_priority", test_incoming_priority);
+    g_test_add_func(TEST_PREFIX "prewarm", test_prewarm);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -78,8 +78,8 @@ test_reader_data_init_for_reply(
     memset(data, 0, sizeof(*data));
     data->buffer = buf;
     data->reg = gbinder_object_registry_ref(reg);
-    g_assert(!gbinder_object_registry_get_local(reg, NULL));
-    g_assert(gbinder_object_registry_get_local(reg, obj) == obj);
+    g_assert(!gbinder_object_registry_get_local(reg, NULL, 0));
+    g_assert(gbinder_object_registry_get_local(reg, obj, obj->cookie) == obj);
     gbinder_local_object_unref(obj); /* ref added by the above call */
     if (offsets && offsets->count > 0) {
         guint i;
@@ -155,14 +155,25 @@ test_basic(
     GBinderLocalObject* bar;
 
     /* ipc is not a local object */
-    g_assert(!gbinder_object_registry_get_local(reg, ipc));
+    g_assert(!gbinder_object_registry_get_local(reg, ipc, 0));
 
     /* Create a new local objects */
     foo = gbinder_ipc_new_local_object(ipc, "foo", NULL, NULL);
     bar = gbinder_ipc_new_local_object(ipc, "bar", NULL, NULL);
 
     /* But ipc is still not a local object! */
-    g_assert(!gbinder_object_registry_get_local(reg, ipc));
+    g_assert(!gbinder_object_registry_get_local(reg, ipc, foo->cookie));
+
+    /* Both the pointer and the cookie must match */
+    g_assert(foo->cookie);
+    g_assert(bar->cookie);
+    g_assert(foo->cookie != bar->cookie);
+    g_assert(!gbinder_object_registry_get_local(reg, foo, 0));
+    g_assert(!gbinder_object_registry_get_local(reg, foo, bar->cookie));
+    g_assert(!gbinder_object_registry_get_local(reg, foo,
+        foo->cookie ^ 0x10000));
+    g_assert(gbinder_object_registry_get_local(reg, foo, foo->cookie) == foo);
+    gbinder_local_object_unref(foo); /* ref added by the above call */
 
     gbinder_ipc_unref(ipc);
 
@@ -484,6 +495,7 @@ test_increfs(
 
     g_assert(obj->weak_refs == 1);
     gbinder_local_object_remove_handler(obj, id);
+    gbinder_local_object_handle_decrefs(obj);
     gbinder_local_object_unref(obj);
     gbinder_ipc_unref(ipc);
     g_main_loop_unref(loop);
@@ -568,6 +580,7 @@ test_acquire(
 
     g_assert(obj->strong_refs == 1);
     gbinder_local_object_remove_handler(obj, id);
+    gbinder_local_object_handle_release(obj);
     gbinder_local_object_unref(obj);
     gbinder_ipc_unref(ipc);
     g_main_loop_unref(loop);
@@ -616,6 +629,181 @@ test_release(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * stale
+ *==========================================================================*/
+
+static
+void
+test_stale(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GBinderObjectRegistry* reg = gbinder_ipc_object_registry(ipc);
+    GBinderLocalObject* obj = gbinder_ipc_new_local_object
+        (ipc, NULL, NULL, NULL);
+    const guint32 cookie = obj->cookie;
+    void* ptr = obj;
+
+    gbinder_local_object_unref(obj);
+    g_assert(!gbinder_object_registry_get_local(reg, ptr, cookie));
+
+    /* The slot gets reused but the cookie is different */
+    obj = gbinder_ipc_new_local_object(ipc, NULL, NULL, NULL);
+    g_assert(obj->cookie != cookie);
+    g_assert((obj->cookie & 0xffff) == (cookie & 0xffff));
+    g_assert(!gbinder_object_registry_get_local(reg, obj, cookie));
+    g_assert(gbinder_object_registry_get_local(reg, obj, obj->cookie) == obj);
+    gbinder_local_object_unref(obj); /* ref added by the above call */
+    gbinder_local_object_unref(obj);
+    gbinder_ipc_unref(ipc);
+}
+
+/*==========================================================================*
+ * refs_changed
+ *==========================================================================*/
+
+typedef struct test_refs_changed_data {
+    GMainLoop* loop;
+    int weak;
+    int strong;
+    int count;
+} TestRefsChangedData;
+
+static
+void
+test_refs_changed_cb(
+    GBinderLocalObject* obj,
+    int weak_delta,
+    int strong_delta,
+    void* user_data)
+{
+    TestRefsChangedData* test = user_data;
+
+    GVERBOSE_("%d %d", weak_delta, strong_delta);
+    test->weak += weak_delta;
+    test->strong += strong_delta;
+    test->count++;
+    g_assert(obj->weak_refs == test->weak);
+    g_assert(obj->strong_refs == test->strong);
+    if (test->weak == 2 && test->strong == 1) {
+        test_quit_later(test->loop);
+    }
+}
+
+static
+void
+test_refs_changed(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GBinderLocalObject* obj = gbinder_ipc_new_local_object
+        (ipc, NULL, NULL, NULL);
+    int fd = gbinder_driver_fd(ipc->driver);
+    TestRefsChangedData test;
+    gulong id;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, FALSE);
+    g_assert(!gbinder_local_object_add_refs_changed_handler(obj, NULL, NULL));
+    g_assert(!gbinder_local_object_add_refs_changed_handler(NULL,
+        test_refs_changed_cb, NULL));
+    id = gbinder_local_object_add_refs_changed_handler(obj,
+        test_refs_changed_cb, &test);
+
+    /* The changes may be (and normally are) delivered in one callback */
+    test_binder_br_increfs(fd, obj);
+    test_binder_br_increfs(fd, obj);
+    test_binder_br_increfs(fd, obj);
+    test_binder_br_acquire(fd, obj);
+    test_binder_br_acquire(fd, obj);
+    test_binder_br_decrefs(fd, obj);
+    test_binder_br_release(fd, obj);
+
+    test_run(&test_opt, test.loop);
+
+    g_assert(test.count >= 1 && test.count <= 7);
+    g_assert(obj->weak_refs == 2);
+    g_assert(obj->strong_refs == 1);
+    gbinder_local_object_remove_handler(obj, id);
+    gbinder_local_object_handle_release(obj);
+    gbinder_local_object_unref(obj);
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * node_refs
+ *==========================================================================*/
+
+static
+void
+test_node_refs_increfs_cb(
+    GBinderLocalObject* obj,
+    void* user_data)
+{
+    GVERBOSE_("%d", obj->weak_refs);
+    test_quit_later((GMainLoop*)user_data);
+}
+
+static
+void
+test_node_refs_finalized(
+    gpointer user_data,
+    GObject* obj)
+{
+    GVERBOSE_("%p", obj);
+    test_quit_later((GMainLoop*)user_data);
+}
+
+static
+void
+test_node_refs(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GBinderObjectRegistry* reg = gbinder_ipc_object_registry(ipc);
+    GBinderLocalObject* obj = gbinder_ipc_new_local_object
+        (ipc, NULL, NULL, NULL);
+    GBinderLocalObject* obj2;
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    int fd = gbinder_driver_fd(ipc->driver);
+    const guint32 cookie = obj->cookie;
+    void* ptr = obj;
+    gulong id = gbinder_local_object_add_weak_refs_changed_handler(obj,
+        test_node_refs_increfs_cb, loop);
+
+    test_binder_br_increfs(fd, obj);
+    test_run(&test_opt, loop);
+    gbinder_local_object_remove_handler(obj, id);
+    g_object_weak_ref(G_OBJECT(obj), test_node_refs_finalized, loop);
+
+    /* The kernel still knows about it, the object must stay alive */
+    gbinder_local_object_unref(obj);
+    obj2 = gbinder_ipc_new_local_object(ipc, NULL, NULL, NULL);
+    g_assert(obj2 != ptr);
+    g_assert(obj2->cookie != cookie);
+    g_assert(gbinder_object_registry_get_local(reg, ptr, cookie) == ptr);
+    gbinder_local_object_unref(ptr); /* ref added by the above call */
+    gbinder_local_object_unref(obj2);
+
+    /* Now it's gone */
+    test_binder_br_decrefs(fd, ptr);
+    test_run(&test_opt, loop);
+    g_assert(!gbinder_object_registry_get_local(reg, ptr, cookie));
+
+    /* The address may be reused, the cookie may not */
+    obj = gbinder_ipc_new_local_object(ipc, NULL, NULL, NULL);
+    GDEBUG("%p 0x%08x -> %p 0x%08x", ptr, cookie, obj, obj->cookie);
+    g_assert(obj->cookie != cookie);
+    g_assert(!gbinder_object_registry_get_local(reg, obj, cookie));
+    g_assert(gbinder_object_registry_get_local(reg, obj, obj->cookie) == obj);
+    gbinder_local_object_unref(obj); /* ref added by the above call */
+    gbinder_local_object_unref(obj);
+    gbinder_ipc_unref(ipc);
+    g_main_loop_unref(loop);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -635,6 +823,9 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "decrefs", test_decrefs);
     g_test_add_func(TEST_PREFIX "acquire", test_acquire);
     g_test_add_func(TEST_PREFIX "release", test_release);
+    g_test_add_func(TEST_PREFIX "refs_changed", test_refs_changed);
+    g_test_add_func(TEST_PREFIX "stale", test_stale);
+    g_test_add_func(TEST_PREFIX "node_refs", test_node_refs);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
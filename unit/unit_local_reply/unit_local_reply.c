@@ -35,6 +35,7 @@
 #include "gbinder_local_object.h"
 #include "gbinder_local_reply_p.h"
 #include "gbinder_output_data.h"
+#include "gbinder_pool.h"
 #include "gbinder_writer.h"
 #include "gbinder_io.h"
 #include "gbinder_ipc.h"
@@ -74,6 +75,7 @@ test_null(
     gbinder_local_reply_init_writer(NULL, NULL);
     gbinder_local_reply_init_writer(NULL, &writer);
     g_assert(!gbinder_local_reply_data(NULL));
+    gbinder_local_reply_reset(NULL);
 
     gbinder_local_reply_cleanup(NULL, NULL, &count);
     gbinder_local_reply_cleanup(NULL, test_int_inc, &count);
@@ -350,6 +352,52 @@ test_remote_object(
     gbinder_local_reply_unref(reply);
 }
 
+/*==========================================================================*
+ * pool
+ *==========================================================================*/
+
+static
+void
+test_pool(
+    void)
+{
+    GBinderPool* pool = gbinder_local_reply_pool_new();
+    GBinderLocalReply* reply = gbinder_local_reply_new_pooled
+        (pool, &gbinder_io_32);
+    GBinderLocalReply* reply2;
+    GBinderOutputData* data;
+    GUtilIntArray* offsets;
+    int count = 0;
+
+    gbinder_local_reply_append_int32(reply, 1);
+    gbinder_local_reply_append_hidl_string(reply, "foo");
+    gbinder_local_reply_cleanup(reply, test_int_inc, &count);
+
+    /* Explicit reset */
+    gbinder_local_reply_reset(reply);
+    g_assert(count == 1);
+    data = gbinder_local_reply_data(reply);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(!offsets || !offsets->count);
+    g_assert(!gbinder_output_data_buffers_size(data));
+    g_assert(!data->bytes->len);
+
+    /* Returned to the pool and taken back */
+    gbinder_local_reply_append_int32(reply, 1);
+    gbinder_local_reply_cleanup(reply, test_int_inc, &count);
+    gbinder_local_reply_unref(reply);
+    g_assert(count == 2);
+    reply2 = gbinder_local_reply_new_pooled(pool, &gbinder_io_32);
+    g_assert(reply2 == reply);
+    data = gbinder_local_reply_data(reply2);
+    g_assert(!data->bytes->len);
+
+    /* Pooled reply may outlive the pool */
+    gbinder_pool_unref(pool);
+    gbinder_local_reply_append_int32(reply2, 1);
+    gbinder_local_reply_unref(reply2);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -369,6 +417,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "hidl_string_vec", test_hidl_string_vec);
     g_test_add_func(TEST_PREFIX "local_object", test_local_object);
     g_test_add_func(TEST_PREFIX "remote_object", test_remote_object);
+    g_test_add_func(TEST_PREFIX "pool", test_pool);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -34,6 +34,7 @@
 
 #include "gbinder_local_request_p.h"
 #include "gbinder_output_data.h"
+#include "gbinder_pool.h"
 #include "gbinder_writer.h"
 #include "gbinder_io.h"
 
@@ -76,6 +77,11 @@ test_null(
     g_assert(count == 1);
 
     g_assert(!gbinder_local_request_data(NULL));
+    g_assert(!gbinder_local_request_reserve(NULL, 0));
+    gbinder_local_request_reset(NULL);
+    g_assert(!gbinder_local_request_instantiate(NULL));
+    g_assert(!gbinder_local_request_patch_int32(NULL, 0, 0));
+    g_assert(!gbinder_local_request_patch_int64(NULL, 0, 0));
     g_assert(!gbinder_local_request_append_int32(NULL, 0));
     g_assert(!gbinder_local_request_append_int64(NULL, 0));
     g_assert(!gbinder_local_request_append_string8(NULL, NULL));
@@ -348,6 +354,188 @@ test_remote_object(
     gbinder_local_request_unref(req);
 }
 
+/*==========================================================================*
+ * reset
+ *==========================================================================*/
+
+static
+void
+test_reset(
+    void)
+{
+    const guint8 init_data[] = { 0x01, 0x02, 0x03, 0x04 };
+    GBytes* init_bytes = g_bytes_new_static(init_data, sizeof(init_data));
+    GBinderLocalRequest* req = gbinder_local_request_new
+        (&gbinder_io_32, init_bytes);
+    GBinderOutputData* data;
+    GUtilIntArray* offsets;
+    int count = 0;
+    guint i;
+
+    gbinder_local_request_append_int32(req, 1);
+    gbinder_local_request_append_hidl_string(req, "foo");
+    gbinder_local_request_cleanup(req, test_int_inc, &count);
+    data = gbinder_local_request_data(req);
+    g_assert(gbinder_output_data_buffers_size(data));
+    g_assert(gbinder_output_data_offsets(data)->count == 2);
+
+    /* Reset keeps the header and runs the cleanup functions */
+    gbinder_local_request_reset(req);
+    g_assert(count == 1);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(!offsets || !offsets->count);
+    g_assert(!gbinder_output_data_buffers_size(data));
+    g_assert(data->bytes->len == sizeof(init_data));
+    g_assert(!memcmp(data->bytes->data, init_data, sizeof(init_data)));
+
+    /* Large buffer gets reallocated, the header survives that too */
+    for (i = 0; i < 0x10000 / 4; i++) {
+        gbinder_local_request_append_int32(req, i);
+    }
+    gbinder_local_request_reset(req);
+    data = gbinder_local_request_data(req);
+    g_assert(data->bytes->len == sizeof(init_data));
+    g_assert(!memcmp(data->bytes->data, init_data, sizeof(init_data)));
+
+    /* And the request is still usable */
+    gbinder_local_request_append_int32(req, 1);
+    g_assert(data->bytes->len == sizeof(init_data) + 4);
+    gbinder_local_request_unref(req);
+    g_assert(count == 1);
+    g_bytes_unref(init_bytes);
+}
+
+/*==========================================================================*
+ * pool
+ *==========================================================================*/
+
+static
+void
+test_pool(
+    void)
+{
+    const guint8 init_data[] = { 0x01, 0x02, 0x03, 0x04 };
+    GBytes* init_bytes = g_bytes_new_static(init_data, sizeof(init_data));
+    GBinderPool* pool = gbinder_local_request_pool_new();
+    GBinderLocalRequest* req[8];
+    GBinderLocalRequest* req2;
+    GBinderOutputData* data;
+    int count = 0;
+    guint i;
+
+    req[0] = gbinder_local_request_new_pooled(pool, &gbinder_io_32,
+        init_bytes, 0);
+    gbinder_local_request_append_int32(req[0], 1);
+    gbinder_local_request_cleanup(req[0], test_int_inc, &count);
+    gbinder_local_request_unref(req[0]);
+    g_assert(count == 1);
+
+    /* The same request comes back, reset to the header */
+    req2 = gbinder_local_request_new_pooled(pool, &gbinder_io_32,
+        init_bytes, 64);
+    g_assert(req2 == req[0]);
+    data = gbinder_local_request_data(req2);
+    g_assert(data->bytes->len == sizeof(init_data));
+    g_assert(!memcmp(data->bytes->data, init_data, sizeof(init_data)));
+    gbinder_local_request_unref(req2);
+
+    /* Not everything is kept */
+    for (i = 0; i < G_N_ELEMENTS(req); i++) {
+        req[i] = gbinder_local_request_new_pooled(pool, &gbinder_io_32,
+            init_bytes, 0);
+    }
+    for (i = 0; i < G_N_ELEMENTS(req); i++) {
+        gbinder_local_request_unref(req[i]);
+    }
+
+    /* Pooled request may outlive the pool */
+    req2 = gbinder_local_request_new_pooled(pool, &gbinder_io_32,
+        init_bytes, 0);
+    gbinder_pool_unref(pool);
+    gbinder_local_request_append_int32(req2, 1);
+    gbinder_local_request_unref(req2);
+    g_bytes_unref(init_bytes);
+}
+
+/*==========================================================================*
+ * template
+ *==========================================================================*/
+
+static
+void
+test_template(
+    void)
+{
+    const guint8 init_data[] = { 0x01, 0x02, 0x03, 0x04 };
+    GBytes* init_bytes = g_bytes_new_static(init_data, sizeof(init_data));
+    GBinderLocalRequest* tmpl = gbinder_local_request_new
+        (&gbinder_io_32, init_bytes);
+    GBinderLocalRequest* req;
+    GBinderLocalRequest* req2;
+    GBinderOutputData* data;
+    GBinderOutputData* tmpl_data;
+    GUtilIntArray* offsets;
+    GBinderWriter writer;
+    guint slot32, slot64;
+    guint32 value32;
+    guint64 value64;
+
+    gbinder_local_request_init_writer(tmpl, &writer);
+    slot32 = gbinder_writer_append_int32_slot(&writer, 1);
+    gbinder_writer_append_hidl_string(&writer, "foo");
+    slot64 = gbinder_writer_append_int64_slot(&writer, 2);
+    g_assert(slot32 == 0);
+    g_assert(slot64 == 1);
+    tmpl_data = gbinder_local_request_data(tmpl);
+
+    /* Instance is a copy of the template */
+    req = gbinder_local_request_instantiate(tmpl);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2);
+    g_assert(!memcmp(offsets->data, gbinder_output_data_offsets
+        (tmpl_data)->data, 2 * sizeof(offsets->data[0])));
+    g_assert(gbinder_output_data_buffers_size(data) ==
+        gbinder_output_data_buffers_size(tmpl_data));
+    g_assert(data->bytes->len == tmpl_data->bytes->len);
+    g_assert(!memcmp(data->bytes->data, tmpl_data->bytes->data,
+        data->bytes->len));
+
+    /* Patch the slots */
+    g_assert(gbinder_local_request_patch_int32(req, slot32, 3));
+    g_assert(gbinder_local_request_patch_int64(req, slot64, 4));
+    g_assert(!gbinder_local_request_patch_int32(req, slot64, 3));
+    g_assert(!gbinder_local_request_patch_int64(req, slot32, 4));
+    g_assert(!gbinder_local_request_patch_int32(req, 2, 0));
+    memcpy(&value32, data->bytes->data + sizeof(init_data), 4);
+    g_assert(value32 == 3);
+    memcpy(&value64, data->bytes->data + data->bytes->len - 8, 8);
+    g_assert(value64 == 4);
+
+    /* The template is unchanged */
+    memcpy(&value32, tmpl_data->bytes->data + sizeof(init_data), 4);
+    g_assert(value32 == 1);
+    memcpy(&value64, tmpl_data->bytes->data + tmpl_data->bytes->len - 8, 8);
+    g_assert(value64 == 2);
+
+    /* Instances get reused */
+    gbinder_local_request_unref(req);
+    req2 = gbinder_local_request_instantiate(tmpl);
+    g_assert(req2 == req);
+    data = gbinder_local_request_data(req2);
+    g_assert(gbinder_output_data_offsets(data)->count == 2);
+    g_assert(!memcmp(data->bytes->data, tmpl_data->bytes->data,
+        data->bytes->len));
+
+    /* Instance keeps the template alive */
+    gbinder_local_request_unref(tmpl);
+    g_assert(gbinder_local_request_patch_int32(req2, slot32, 5));
+    gbinder_local_request_unref(req2);
+    g_bytes_unref(init_bytes);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -368,6 +556,9 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "hidl_string_vec", test_hidl_string_vec);
     g_test_add_func(TEST_PREFIX "local_object", test_local_object);
     g_test_add_func(TEST_PREFIX "remote_object", test_remote_object);
+    g_test_add_func(TEST_PREFIX "reset", test_reset);
+    g_test_add_func(TEST_PREFIX "pool", test_pool);
+    g_test_add_func(TEST_PREFIX "template", test_template);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -34,9 +34,15 @@
 
 #include "gbinder_buffer_p.h"
 #include "gbinder_driver.h"
+#include "gbinder_io.h"
 #include "gbinder_ipc.h"
+#include "gbinder_local_request_p.h"
+#include "gbinder_output_data.h"
 #include "gbinder_reader_p.h"
 #include "gbinder_remote_object_p.h"
+#include "gbinder_writer.h"
+
+#include <gutil_intarray.h>
 
 static TestOpt test_opt;
 
@@ -78,6 +84,14 @@ test_empty(
     g_assert(!gbinder_reader_read_buffer(&reader));
     g_assert(!gbinder_reader_read_hidl_string(&reader));
     g_assert(!gbinder_reader_read_hidl_string_vec(&reader));
+    g_assert(!gbinder_reader_read_hidl_vec(&reader, 1, NULL, NULL));
+    g_assert(!gbinder_reader_read_byte_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_int32_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_int64_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_float_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_double_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_bool_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_string16_array(&reader, NULL, NULL));
     g_assert(!gbinder_reader_skip_buffer(&reader));
     g_assert(!gbinder_reader_read_string8(&reader));
     g_assert(!gbinder_reader_read_string16(&reader));
@@ -205,6 +219,185 @@ test_int32(
     gbinder_driver_unref(driver);
 }
 
+/*==========================================================================*
+ * byte_array
+ *==========================================================================*/
+
+static
+void
+test_byte_array(
+    void)
+{
+    static const guint8 in[] = {
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(0),
+        TEST_INT32_BYTES(5), 0x01, 0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00,
+        TEST_INT32_BYTES(5), 0x01, 0x02, 0x03, 0x04, 0x05 /* Too short */
+    };
+    GBinderDriver* driver = gbinder_driver_new(GBINDER_DEFAULT_BINDER);
+    GBinderReader reader;
+    GBinderReaderData data;
+    gconstpointer ptr;
+    gsize len;
+
+    g_assert(driver);
+    memset(&data, 0, sizeof(data));
+    data.buffer = gbinder_buffer_new(driver, g_memdup(in, sizeof(in)),
+        sizeof(in));
+
+    gbinder_reader_init(&reader, &data, 0, sizeof(in));
+    g_assert(gbinder_reader_read_byte_array(&reader, &ptr, &len));
+    g_assert(!ptr);
+    g_assert(!len);
+    g_assert(gbinder_reader_read_byte_array(&reader, &ptr, &len));
+    g_assert(ptr);
+    g_assert(!len);
+    g_assert(gbinder_reader_read_byte_array(&reader, &ptr, &len));
+    g_assert(len == 5);
+    g_assert(ptr == (guint8*)data.buffer->data + 12);
+    g_assert(!gbinder_reader_read_byte_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_bytes_read(&reader) == 24);
+
+    gbinder_buffer_free(data.buffer);
+    gbinder_driver_unref(driver);
+}
+
+/*==========================================================================*
+ * arrays
+ *==========================================================================*/
+
+static
+void
+test_arrays(
+    void)
+{
+    static const guint8 in[] = {
+        TEST_INT32_BYTES(2), TEST_INT32_BYTES(1), TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(1), TEST_INT64_BYTES(3),
+        TEST_INT32_BYTES(1), TEST_INT32_BYTES(0x3f800000),
+        TEST_INT32_BYTES(0),
+        TEST_INT32_BYTES(3),
+        TEST_INT32_BYTES(1), TEST_INT32_BYTES(0), 0x02, 0xff, 0xff, 0xff,
+        TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(2),
+        TEST_INT16_BYTES('a'), TEST_INT16_BYTES('b'), 0x00, 0x00, 0x00, 0x00,
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(-1) /* Second string is missing */
+    };
+    GBinderDriver* driver = gbinder_driver_new(GBINDER_DEFAULT_BINDER);
+    GBinderReader reader;
+    GBinderReaderData data;
+    gint32* i32;
+    gint64* i64;
+    gfloat* f;
+    gdouble* d;
+    gboolean* b;
+    char** strv;
+    gsize count;
+
+    g_assert(driver);
+    memset(&data, 0, sizeof(data));
+    data.buffer = gbinder_buffer_new(driver, g_memdup(in, sizeof(in)),
+        sizeof(in));
+
+    gbinder_reader_init(&reader, &data, 0, sizeof(in));
+    g_assert(gbinder_reader_read_int32_array(&reader, &i32, &count));
+    g_assert(count == 2);
+    g_assert(i32[0] == 1);
+    g_assert(i32[1] == 2);
+    g_free(i32);
+    g_assert(gbinder_reader_read_int32_array(&reader, &i32, &count));
+    g_assert(!i32);
+    g_assert(!count);
+    g_assert(gbinder_reader_read_int64_array(&reader, &i64, &count));
+    g_assert(count == 1);
+    g_assert(i64[0] == 3);
+    g_free(i64);
+    g_assert(gbinder_reader_read_float_array(&reader, &f, &count));
+    g_assert(count == 1);
+    g_assert(f[0] == 1.0f);
+    g_free(f);
+    g_assert(gbinder_reader_read_double_array(&reader, &d, &count));
+    g_assert(d);
+    g_assert(!count);
+    g_free(d);
+    g_assert(gbinder_reader_read_bool_array(&reader, &b, &count));
+    g_assert(count == 3);
+    g_assert(b[0] == TRUE);
+    g_assert(b[1] == FALSE);
+    g_assert(b[2] == TRUE);
+    g_free(b);
+    g_assert(gbinder_reader_read_string16_array(&reader, &strv, &count));
+    g_assert(count == 2);
+    g_assert(!g_strcmp0(strv[0], "ab"));
+    g_assert(!strv[1]);
+    g_assert(!strv[2]);
+    g_free(strv[0]);
+    g_free(strv);
+    g_assert(!gbinder_reader_read_string16_array(&reader, &strv, &count));
+    g_assert(gbinder_reader_bytes_remaining(&reader) == 8);
+
+    /* Same thing without fetching the values */
+    gbinder_reader_init(&reader, &data, 0, sizeof(in));
+    g_assert(gbinder_reader_read_int32_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_int32_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_int64_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_float_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_double_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_bool_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_read_string16_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_read_string16_array(&reader, NULL, NULL));
+    /* Not enough data for 2 int64 values */
+    g_assert(!gbinder_reader_read_int64_array(&reader, NULL, NULL));
+    g_assert(gbinder_reader_bytes_remaining(&reader) == 8);
+
+    gbinder_buffer_free(data.buffer);
+    gbinder_driver_unref(driver);
+}
+
+/*==========================================================================*
+ * string16_array/truncated
+ *==========================================================================*/
+
+static
+void
+test_string16_array_truncated(
+    void)
+{
+    static const guint8 in[] = {
+        TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(2),
+        TEST_INT16_BYTES('a'), TEST_INT16_BYTES('b'), 0x00, 0x00, 0x00, 0x00,
+        TEST_INT32_BYTES(5) /* Second string is truncated */
+    };
+    GBinderDriver* driver = gbinder_driver_new(GBINDER_DEFAULT_BINDER);
+    GBinderReader reader;
+    GBinderReaderData data;
+    char** strv = NULL;
+    gsize count = 0;
+
+    g_assert(driver);
+    memset(&data, 0, sizeof(data));
+    data.buffer = gbinder_buffer_new(driver, g_memdup(in, sizeof(in)),
+        sizeof(in));
+
+    /* Skipping the array */
+    gbinder_reader_init(&reader, &data, 0, sizeof(in));
+    g_assert(!gbinder_reader_read_string16_array(&reader, NULL, &count));
+    g_assert(!gbinder_reader_read_string16_array(&reader, NULL, NULL));
+    g_assert(!gbinder_reader_bytes_read(&reader));
+
+    /* And reading it */
+    g_assert(!gbinder_reader_read_string16_array(&reader, &strv, &count));
+    g_assert(!strv);
+    g_assert(!gbinder_reader_bytes_read(&reader));
+
+    gbinder_buffer_free(data.buffer);
+    gbinder_driver_unref(driver);
+}
+
 /*==========================================================================*
  * int64
  *==========================================================================*/
@@ -643,6 +836,135 @@ test_vec(
     gbinder_ipc_unref(ipc);
 }
 
+/*==========================================================================*
+ * hidl_struct
+ *==========================================================================*/
+
+typedef struct test_hidl_item {
+    guint32 id;
+    guint32 flags;
+    GBinderHidlString name;
+} TestHidlItem;
+
+typedef struct test_hidl_outer {
+    GBinderHidlString name;
+    GBinderHidlVec items;
+} TestHidlOuter;
+
+static const GBinderHidlField test_hidl_item_fields[] = {
+    GBINDER_HIDL_FIELD_STRING(TestHidlItem, name),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType test_hidl_item_type = {
+    "TestHidlItem", sizeof(TestHidlItem), test_hidl_item_fields
+};
+
+static const GBinderHidlField test_hidl_outer_fields[] = {
+    GBINDER_HIDL_FIELD_STRING(TestHidlOuter, name),
+    GBINDER_HIDL_FIELD_VEC(TestHidlOuter, items, &test_hidl_item_type),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType test_hidl_outer_type = {
+    "TestHidlOuter", sizeof(TestHidlOuter), test_hidl_outer_fields
+};
+
+static
+void
+test_hidl_struct(
+    void)
+{
+    /* Using 64-bit I/O */
+    static const char* names[] = { "foo", "bar" };
+    static const guint32 ints[] = { 1, 2, 3 };
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_HWBINDER);
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderOutputData* out;
+    GUtilIntArray* offsets;
+    GBinderReaderData data;
+    GBinderReader reader;
+    GBinderWriter writer;
+    TestHidlItem items[2];
+    TestHidlOuter outer;
+    gconstpointer ptr;
+    gsize count;
+    guint i;
+
+    g_assert(ipc);
+    memset(items, 0, sizeof(items));
+    memset(&outer, 0, sizeof(outer));
+    for (i = 0; i < G_N_ELEMENTS(items); i++) {
+        items[i].id = i;
+        items[i].name.data.str = names[i];
+        items[i].name.len = strlen(names[i]);
+    }
+    outer.name.data.str = "outer";
+    outer.name.len = 5;
+    outer.items.data.ptr = items;
+    outer.items.count = G_N_ELEMENTS(items);
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_struct(&writer, &outer, &test_hidl_outer_type);
+    gbinder_writer_append_hidl_vec(&writer, ints, G_N_ELEMENTS(ints),
+        sizeof(ints[0]));
+    gbinder_writer_append_hidl_vec(&writer, NULL, 0, sizeof(ints[0]));
+    gbinder_writer_append_hidl_struct_vec(&writer, items, G_N_ELEMENTS(items),
+        &test_hidl_item_type);
+    gbinder_writer_append_hidl_vec(&writer, ints, G_N_ELEMENTS(ints),
+        sizeof(ints[0]));
+
+    /* Feed the output to the reader. Nothing gets relocated here */
+    out = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(out);
+    memset(&data, 0, sizeof(data));
+    data.buffer = gbinder_buffer_new(ipc->driver,
+        g_memdup(out->bytes->data, out->bytes->len), out->bytes->len);
+    data.reg = gbinder_ipc_object_registry(ipc);
+    data.objects = g_new(void*, offsets->count + 1);
+    for (i = 0; i < offsets->count; i++) {
+        data.objects[i] = (guint8*)data.buffer->data + offsets->data[i];
+    }
+    data.objects[i] = NULL;
+    gbinder_reader_init(&reader, &data, 0, data.buffer->size);
+
+    g_assert(gbinder_reader_read_hidl_struct(&reader,
+        &test_hidl_outer_type) == &outer);
+    g_assert(gbinder_reader_read_hidl_vec(&reader, sizeof(ints[0]),
+        &ptr, &count));
+    g_assert(ptr == ints);
+    g_assert(count == G_N_ELEMENTS(ints));
+    g_assert(gbinder_reader_read_hidl_vec(&reader, sizeof(ints[0]),
+        &ptr, &count));
+    g_assert(!ptr);
+    g_assert(!count);
+    g_assert(gbinder_reader_read_hidl_struct_vec(&reader,
+        &test_hidl_item_type, &ptr, &count));
+    g_assert(ptr == items);
+    g_assert(count == G_N_ELEMENTS(items));
+
+    /* Element size doesn't match */
+    g_assert(!gbinder_reader_read_hidl_vec(&reader, 8, &ptr, &count));
+    g_assert(!ptr);
+    g_assert(!count);
+    g_assert(gbinder_reader_at_end(&reader));
+
+    /* Strings are not where the structure says they are */
+    gbinder_reader_init(&reader, &data, 0, data.buffer->size);
+    items[1].name.data.str = names[0];
+    g_assert(!gbinder_reader_read_hidl_struct(&reader,
+        &test_hidl_outer_type));
+
+    /* Wrong structure size */
+    gbinder_reader_init(&reader, &data, 0, data.buffer->size);
+    g_assert(!gbinder_reader_read_hidl_struct(&reader, &test_hidl_item_type));
+
+    g_free(data.objects);
+    gbinder_buffer_free(data.buffer);
+    gbinder_local_request_unref(req);
+    gbinder_ipc_unref(ipc);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -658,6 +980,10 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "byte", test_byte);
     g_test_add_func(TEST_PREFIX "bool", test_bool);
     g_test_add_func(TEST_PREFIX "int32", test_int32);
+    g_test_add_func(TEST_PREFIX "byte_array", test_byte_array);
+    g_test_add_func(TEST_PREFIX "arrays", test_arrays);
+    g_test_add_func(TEST_PREFIX "string16_array/truncated",
+        test_string16_array_truncated);
     g_test_add_func(TEST_PREFIX "int64", test_int64);
 
     for (i = 0; i < G_N_ELEMENTS(test_string8_tests); i++) {
@@ -690,6 +1016,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "/object/object/invalid", test_object_invalid);
     g_test_add_func(TEST_PREFIX "/object/object/no_reg", test_object_no_reg);
     g_test_add_func(TEST_PREFIX "/vec", test_vec);
+    g_test_add_func(TEST_PREFIX "/hidl_struct", test_hidl_struct);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -87,6 +87,102 @@ test_basic(
     gbinder_ipc_unref(ipc);
 }
 
+/*==========================================================================*
+ * handles
+ *==========================================================================*/
+
+static
+void
+test_handles(
+    void)
+{
+    static const guint32 handles[] = { 0, 1, 255, 256, 0x10000, 0xfffffffe };
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GBinderRemoteObject* obj[G_N_ELEMENTS(handles)];
+    GBinderRemoteObject* obj2;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(handles); i++) {
+        obj[i] = gbinder_ipc_get_remote_object(ipc, handles[i]);
+        g_assert(obj[i]);
+        g_assert(obj[i]->handle == handles[i]);
+    }
+    for (i = 0; i < G_N_ELEMENTS(handles); i++) {
+        obj2 = gbinder_ipc_get_remote_object(ipc, handles[i]);
+        g_assert(obj2 == obj[i]);
+        gbinder_remote_object_unref(obj2);
+    }
+
+    /* Once the last reference is gone, the handle maps to a new object */
+    for (i = 0; i < G_N_ELEMENTS(handles); i++) {
+        GBinderRemoteObject* weak = obj[i];
+
+        g_object_add_weak_pointer(G_OBJECT(weak), (gpointer*)&weak);
+        gbinder_remote_object_unref(obj[i]);
+        g_assert(!weak);
+        obj[i] = gbinder_ipc_get_remote_object(ipc, handles[i]);
+        g_assert(obj[i]);
+        g_assert(obj[i]->handle == handles[i]);
+    }
+    for (i = 0; i < G_N_ELEMENTS(handles); i++) {
+        gbinder_remote_object_unref(obj[i]);
+    }
+    gbinder_ipc_unref(ipc);
+}
+
+/*==========================================================================*
+ * threads
+ *==========================================================================*/
+
+#define TEST_THREADS_COUNT (4)
+#define TEST_THREADS_HANDLES (3)
+#define TEST_THREADS_LOOPS (1000)
+
+static
+gpointer
+test_threads_proc(
+    gpointer ipc)
+{
+    guint i;
+
+    /* Objects keep getting released while other threads look them up */
+    for (i = 0; i < TEST_THREADS_LOOPS; i++) {
+        const guint32 handle = i % TEST_THREADS_HANDLES;
+        GBinderRemoteObject* obj = gbinder_ipc_get_remote_object(ipc, handle);
+
+        g_assert(obj);
+        g_assert(obj->handle == handle);
+        g_assert(obj->refcount > 0);
+        gbinder_remote_object_unref(obj);
+    }
+    return NULL;
+}
+
+static
+void
+test_threads(
+    void)
+{
+    GBinderIpc* ipc = gbinder_ipc_new(GBINDER_DEFAULT_BINDER);
+    GThread* thread[TEST_THREADS_COUNT];
+    GBinderRemoteObject* obj;
+    guint i;
+
+    for (i = 0; i < TEST_THREADS_COUNT; i++) {
+        thread[i] = g_thread_new("test", test_threads_proc, ipc);
+    }
+    for (i = 0; i < TEST_THREADS_COUNT; i++) {
+        g_thread_join(thread[i]);
+    }
+
+    /* Everything has been released */
+    obj = gbinder_ipc_get_remote_object(ipc, 0);
+    g_assert(obj);
+    g_assert(obj->refcount == 1);
+    gbinder_remote_object_unref(obj);
+    gbinder_ipc_unref(ipc);
+}
+
 /*==========================================================================*
  * dead
  *==========================================================================*/
@@ -135,6 +231,8 @@ int main(int argc, char* argv[])
     g_test_init(&argc, &argv, NULL);
     g_test_add_func(TEST_PREFIX "null", test_null);
     g_test_add_func(TEST_PREFIX "basic", test_basic);
+    g_test_add_func(TEST_PREFIX "handles", test_handles);
+    g_test_add_func(TEST_PREFIX "threads", test_threads);
     g_test_add_func(TEST_PREFIX "dead", test_dead);
     test_init(&test_opt, argc, argv);
     return g_test_run();
@@ -76,6 +76,8 @@ test_null(
     g_assert(!gbinder_remote_request_read_string8(NULL));
     g_assert(!gbinder_remote_request_read_string16(NULL));
     g_assert(!gbinder_remote_request_read_object(NULL));
+    gbinder_remote_request_block(NULL);
+    gbinder_remote_request_complete(NULL, NULL, 0);
 }
 
 /*==========================================================================*
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2018 Jolla Ltd.
+ * Contact: Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the name of Jolla Ltd nor the names of its contributors may
+ *      be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_binder.h"
+
+#include "gbinder_servicemanager.h"
+#include "gbinder_driver.h"
+#include "gbinder_ipc.h"
+#include "gbinder_local_object.h"
+#include "gbinder_local_request_p.h"
+#include "gbinder_output_data.h"
+#include "gbinder_rpc_protocol.h"
+#include "gbinder_writer.h"
+
+#include <gutil_log.h>
+
+static TestOpt test_opt;
+
+static
+gboolean
+test_unref_ipc(
+    gpointer ipc)
+{
+    gbinder_ipc_unref(ipc);
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+test_ipc_done(
+    gpointer loop,
+    GObject* ipc)
+{
+    test_quit_later((GMainLoop*)loop);
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    GBinderIncomingStats stats;
+
+    gbinder_servicemanager_set_max_pending_incoming(NULL, 0, FALSE);
+    gbinder_servicemanager_set_tx_done_batch(NULL, 0);
+    g_assert(!gbinder_servicemanager_get_incoming_stats(NULL, &stats));
+}
+
+/*==========================================================================*
+ * incoming
+ *==========================================================================*/
+
+static
+GBinderLocalReply*
+test_incoming_proc(
+    GBinderLocalObject* obj,
+    GBinderRemoteRequest* req,
+    guint code,
+    guint flags,
+    int* status,
+    void* user_data)
+{
+    GVERBOSE_("%u", code);
+    g_assert(flags & GBINDER_TX_FLAG_ONEWAY);
+    g_assert(code == 1);
+    test_quit_later((GMainLoop*)user_data);
+    return NULL;
+}
+
+static
+void
+test_incoming(
+    void)
+{
+    const char* dev = GBINDER_DEFAULT_BINDER;
+    GBinderIpc* ipc = gbinder_ipc_new(dev);
+    GBinderServiceManager* sm = gbinder_servicemanager_new(dev);
+    const GBinderIo* io = gbinder_driver_io(ipc->driver);
+    const int fd = gbinder_driver_fd(ipc->driver);
+    const GBinderRpcProtocol* prot = gbinder_rpc_protocol_for_device(dev);
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    GBinderLocalObject* obj = gbinder_servicemanager_new_local_object
+        (sm, "test", test_incoming_proc, loop);
+    GBinderLocalRequest* req = gbinder_local_request_new(io, NULL);
+    GBinderIncomingStats stats;
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    g_assert(sm);
+    g_assert(obj);
+    g_assert(!gbinder_servicemanager_get_incoming_stats(sm, NULL));
+    gbinder_servicemanager_set_tx_done_batch(sm, 1);
+    gbinder_servicemanager_set_max_pending_incoming(sm, 1, TRUE);
+
+    gbinder_local_request_init_writer(req, &writer);
+    prot->write_rpc_header(&writer, "test");
+    data = gbinder_local_request_data(req);
+
+    /* The second one gets dropped */
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    test_binder_br_transaction_oneway(fd, obj, 1, data->bytes);
+    do {
+        /* The main thread isn't handling anything while we are waiting */
+        g_usleep(1000);
+        g_assert(gbinder_servicemanager_get_incoming_stats(sm, &stats));
+    } while (stats.pending + stats.dropped < 2);
+    test_run(&test_opt, loop);
+
+    g_assert(gbinder_servicemanager_get_incoming_stats(sm, &stats));
+    g_assert(!stats.pending);
+    g_assert(stats.peak == 1);
+    g_assert(!stats.rejected);
+    g_assert(stats.dropped == 1);
+
+    /* Now we need to wait until GBinderIpc is destroyed */
+    GDEBUG("waiting for GBinderIpc to get destroyed");
+    g_object_weak_ref(G_OBJECT(ipc), test_ipc_done, loop);
+    gbinder_local_object_unref(obj);
+    gbinder_local_request_unref(req);
+    gbinder_servicemanager_unref(sm);
+    g_idle_add(test_unref_ipc, ipc);
+    test_run(&test_opt, loop);
+
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/servicemanager/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_null);
+    g_test_add_func(TEST_PREFIX "incoming", test_incoming);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -60,8 +60,14 @@ test_null(
     gbinder_local_request_init_writer(NULL, &writer);
     gbinder_writer_append_int32(NULL, 0);
     gbinder_writer_append_int32(&writer, 0);
+    gbinder_writer_reserve(NULL, 0);
+    gbinder_writer_reserve(&writer, 0);
     gbinder_writer_append_int64(NULL, 0);
     gbinder_writer_append_int64(&writer, 0);
+    g_assert(!gbinder_writer_append_int32_slot(NULL, 0));
+    g_assert(!gbinder_writer_append_int32_slot(&writer, 0));
+    g_assert(!gbinder_writer_append_int64_slot(NULL, 0));
+    g_assert(!gbinder_writer_append_int64_slot(&writer, 0));
     gbinder_writer_append_string8(NULL, NULL);
     gbinder_writer_append_string8(&writer, NULL);
     gbinder_writer_append_string8_len(NULL, NULL, 0);
@@ -78,6 +84,29 @@ test_null(
     gbinder_writer_append_hidl_string(&writer, NULL);
     gbinder_writer_append_hidl_string_vec(NULL, NULL, 0);
     gbinder_writer_append_hidl_string_vec(&writer, NULL, 0);
+    gbinder_writer_append_hidl_vec(NULL, NULL, 0, 0);
+    gbinder_writer_append_hidl_vec(&writer, NULL, 0, 0);
+    gbinder_writer_append_hidl_struct_vec(NULL, NULL, 0, NULL);
+    gbinder_writer_append_hidl_struct_vec(&writer, NULL, 0, NULL);
+    gbinder_writer_append_hidl_struct(NULL, NULL, NULL);
+    gbinder_writer_append_hidl_struct(&writer, NULL, NULL);
+    gbinder_writer_append_hidl_byte_vec(NULL, NULL, 0, NULL, NULL);
+    gbinder_writer_append_byte_array(NULL, NULL, 0);
+    gbinder_writer_append_byte_array(&writer, NULL, 0);
+    gbinder_writer_append_int32_array(NULL, NULL, 0);
+    gbinder_writer_append_int32_array(&writer, NULL, 0);
+    gbinder_writer_append_int64_array(NULL, NULL, 0);
+    gbinder_writer_append_int64_array(&writer, NULL, 0);
+    gbinder_writer_append_float_array(NULL, NULL, 0);
+    gbinder_writer_append_float_array(&writer, NULL, 0);
+    gbinder_writer_append_double_array(NULL, NULL, 0);
+    gbinder_writer_append_double_array(&writer, NULL, 0);
+    gbinder_writer_append_bool_array(NULL, NULL, 0);
+    gbinder_writer_append_bool_array(&writer, NULL, 0);
+    gbinder_writer_append_string16_array(NULL, NULL, 0);
+    gbinder_writer_append_string16_array(&writer, NULL, 0);
+    gbinder_writer_append_measured(NULL, NULL, NULL);
+    gbinder_writer_append_measured(&writer, NULL, NULL);
     gbinder_writer_append_buffer_object(NULL, NULL, 0);
     gbinder_writer_append_buffer_object(&writer, NULL, 0);
     gbinder_writer_append_buffer_object_with_parent(NULL, NULL, 0, NULL);
@@ -287,6 +316,85 @@ test_string16(
     gbinder_local_request_unref(req);
 }
 
+/*==========================================================================*
+ * string16_utf8
+ *==========================================================================*/
+
+typedef struct test_string16_utf8_data {
+    const char* name;
+    const char* input;
+    gssize len;
+} TestString16Utf8Data;
+
+static const TestString16Utf8Data test_string16_utf8_tests[] = {
+    { "ascii", "android.hidl.manager@1.0::IServiceManager", -1 },
+    { "ascii_len", "android.hidl.manager@1.0::IServiceManager", 20 },
+    { "latin1", "\xc3\xa9t\xc3\xa9 \xc3\xa0 la plage", -1 },
+    { "cyrillic", "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82", -1 },
+    { "cjk", "0123456789abcdef\xe4\xb8\xad\xe6\x96\x87", -1 },
+    { "emoji", "emoji \xf0\x9f\x98\x80 and more", -1 },
+    { "max", "\xf4\x8f\xbf\xbf", -1 },
+    { "truncated", "0123456789abcdefgh\xe4\xb8", -1 },
+    { "overlong", "abc\xc0\x80" "def", -1 },
+    { "surrogate", "abc\xed\xa0\x80" "def", -1 },
+    { "too_big", "abc\xf4\x90\x80\x80" "def", -1 },
+    { "stray", "\x80" "abc", -1 },
+    { "nul", "0123456789abcdefghij\0klm", 24 }
+};
+
+/* This is how it used to be done */
+static
+GByteArray*
+test_string16_utf8_expected(
+    const char* utf8,
+    gssize num_bytes)
+{
+    GByteArray* out = g_byte_array_new();
+    const char* end = utf8;
+    glong len = 0;
+
+    g_utf8_validate(utf8, num_bytes, &end);
+    if (end > utf8) {
+        gunichar2* utf16 = g_utf8_to_utf16(utf8, end - utf8, NULL, &len,
+            NULL);
+        const guint32 len32 = len;
+
+        g_byte_array_append(out, (void*)&len32, sizeof(len32));
+        g_byte_array_append(out, (void*)utf16, (len + 1) * 2);
+        g_free(utf16);
+        while (out->len % 4) {
+            const guint8 zero = 0;
+
+            g_byte_array_append(out, &zero, 1);
+        }
+    } else {
+        g_byte_array_append(out, string16_tests_data_empty,
+            sizeof(string16_tests_data_empty));
+    }
+    return out;
+}
+
+static
+void
+test_string16_utf8(
+    gconstpointer test_data)
+{
+    const TestString16Utf8Data* test = test_data;
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_32, NULL);
+    GByteArray* expected = test_string16_utf8_expected(test->input,
+        test->len);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_string16_len(&writer, test->input, test->len);
+    data = gbinder_local_request_data(req);
+    g_assert(data->bytes->len == expected->len);
+    g_assert(!memcmp(data->bytes->data, expected->data, expected->len));
+    g_byte_array_free(expected, TRUE);
+    gbinder_local_request_unref(req);
+}
+
 /*==========================================================================*
  * hidl_string
  *==========================================================================*/
@@ -371,6 +479,557 @@ test_hidl_string2(
     gbinder_local_request_unref(req);
 }
 
+#define TEST_HIDL_STRING_MANY (100)
+
+/* Buffer pointer in struct binder_buffer_object (64-bit protocol) */
+static
+const void*
+test_hidl_buffer_ptr64(
+    GBinderOutputData* data,
+    guint offset)
+{
+    guint64 ptr;
+
+    memcpy(&ptr, data->bytes->data + offset + 8, sizeof(ptr));
+    return (const void*)(gsize)ptr;
+}
+
+static
+void
+test_hidl_string_many(
+    void)
+{
+    static const char* strv[] = { "foo", "bar", NULL };
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    GUtilIntArray* offsets;
+    const HidlVec* vec;
+    const HidlString* str;
+    guint i;
+
+    /* Enough descriptors to fill more than one arena chunk */
+    gbinder_local_request_init_writer(req, &writer);
+    for (i = 0; i < TEST_HIDL_STRING_MANY; i++) {
+        gbinder_writer_append_hidl_string(&writer, strv[i % 2]);
+    }
+    gbinder_writer_append_hidl_string_vec(&writer, strv, -1);
+
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2 * TEST_HIDL_STRING_MANY + 4);
+
+    /* Descriptors are 8-byte aligned and stay where they were */
+    for (i = 0; i < TEST_HIDL_STRING_MANY; i++) {
+        str = test_hidl_buffer_ptr64(data, offsets->data[2 * i]);
+        g_assert(!(GPOINTER_TO_SIZE(str) % 8));
+        g_assert(str->data.str == strv[i % 2]);
+        g_assert(str->len == 3);
+        g_assert(str->owns_buffer);
+    }
+    vec = test_hidl_buffer_ptr64(data, offsets->data[2 * i]);
+    g_assert(!(GPOINTER_TO_SIZE(vec) % 8));
+    g_assert(vec->count == 2);
+    str = vec->data.ptr;
+    g_assert(!(GPOINTER_TO_SIZE(str) % 8));
+    g_assert(str[0].data.str == strv[0]);
+    g_assert(str[1].data.str == strv[1]);
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[2 * i + 1]) == str);
+    gbinder_local_request_unref(req);
+}
+
+/*==========================================================================*
+ * hidl_struct
+ *==========================================================================*/
+
+typedef struct test_hidl_item {
+    guint32 id;
+    guint32 flags;
+    GBinderHidlString name;
+} TestHidlItem;
+
+typedef struct test_hidl_label {
+    guint64 color;
+    GBinderHidlString text;
+} TestHidlLabel;
+
+typedef struct test_hidl_outer {
+    guint32 a;
+    guint32 b;
+    TestHidlLabel label;
+    GBinderHidlVec items;
+} TestHidlOuter;
+
+static const GBinderHidlField test_hidl_item_fields[] = {
+    GBINDER_HIDL_FIELD_STRING(TestHidlItem, name),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType test_hidl_item_type = {
+    "TestHidlItem", sizeof(TestHidlItem), test_hidl_item_fields
+};
+
+static const GBinderHidlField test_hidl_label_fields[] = {
+    GBINDER_HIDL_FIELD_STRING(TestHidlLabel, text),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType test_hidl_label_type = {
+    "TestHidlLabel", sizeof(TestHidlLabel), test_hidl_label_fields
+};
+
+static const GBinderHidlField test_hidl_outer_fields[] = {
+    GBINDER_HIDL_FIELD_STRUCT(TestHidlOuter, label, &test_hidl_label_type),
+    GBINDER_HIDL_FIELD_VEC(TestHidlOuter, items, &test_hidl_item_type),
+    GBINDER_HIDL_FIELD_END()
+};
+
+static const GBinderHidlType test_hidl_outer_type = {
+    "TestHidlOuter", sizeof(TestHidlOuter), test_hidl_outer_fields
+};
+
+static
+void
+test_hidl_buffer_parent64(
+    GBinderOutputData* data,
+    guint offset,
+    guint64* parent,
+    guint64* parent_offset)
+{
+    memcpy(parent, data->bytes->data + offset + 24, sizeof(*parent));
+    memcpy(parent_offset, data->bytes->data + offset + 32,
+        sizeof(*parent_offset));
+}
+
+static
+void
+test_hidl_struct(
+    void)
+{
+    static const char* names[] = { "foo", "bar" };
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    GUtilIntArray* offsets;
+    const HidlVec* vec;
+    TestHidlItem items[2];
+    TestHidlOuter outer;
+    guint64 parent, parent_offset;
+    guint i;
+
+    memset(items, 0, sizeof(items));
+    memset(&outer, 0, sizeof(outer));
+    for (i = 0; i < G_N_ELEMENTS(items); i++) {
+        items[i].id = i;
+        items[i].name.data.str = names[i];
+        items[i].name.len = strlen(names[i]);
+    }
+    outer.a = 1;
+    outer.b = 2;
+    outer.label.text.data.str = "label";
+    outer.label.text.len = 5;
+    outer.items.data.ptr = items;
+    outer.items.count = G_N_ELEMENTS(items);
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_struct(&writer, &outer, &test_hidl_outer_type);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+
+    /* outer, label.text, items, items[0].name, items[1].name */
+    g_assert(offsets);
+    g_assert(offsets->count == 5);
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[0]) == &outer);
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[1]) ==
+        outer.label.text.data.str);
+    test_hidl_buffer_parent64(data, offsets->data[1], &parent, &parent_offset);
+    g_assert(parent == 0);
+    g_assert(parent_offset == G_STRUCT_OFFSET(TestHidlOuter, label) +
+        G_STRUCT_OFFSET(TestHidlLabel, text));
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[2]) == items);
+    test_hidl_buffer_parent64(data, offsets->data[2], &parent, &parent_offset);
+    g_assert(parent == 0);
+    g_assert(parent_offset == G_STRUCT_OFFSET(TestHidlOuter, items));
+    for (i = 0; i < G_N_ELEMENTS(items); i++) {
+        g_assert(test_hidl_buffer_ptr64(data, offsets->data[3 + i]) ==
+            names[i]);
+        test_hidl_buffer_parent64(data, offsets->data[3 + i], &parent,
+            &parent_offset);
+        g_assert(parent == 2);
+        g_assert(parent_offset == i * sizeof(TestHidlItem) +
+            G_STRUCT_OFFSET(TestHidlItem, name));
+    }
+    g_assert(gbinder_output_data_buffers_size(data) ==
+        sizeof(outer) + 8 + sizeof(items) + 8 + 8);
+    gbinder_local_request_unref(req);
+
+    /* Plain data vector */
+    req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_vec(&writer, items, 2, sizeof(items[0]));
+    gbinder_writer_append_hidl_vec(&writer, NULL, 0, sizeof(items[0]));
+    gbinder_writer_append_hidl_struct_vec(&writer, items, 2,
+        &test_hidl_item_type);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2 + 1 + 4);
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[1]) == items);
+    test_hidl_buffer_parent64(data, offsets->data[1], &parent, &parent_offset);
+    g_assert(parent == 0);
+    g_assert(parent_offset == GBINDER_HIDL_VEC_BUFFER_OFFSET);
+    test_hidl_buffer_parent64(data, offsets->data[6], &parent, &parent_offset);
+    g_assert(parent == 4);
+    gbinder_local_request_unref(req);
+
+    /* Missing elements make an empty vector */
+    req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_vec(&writer, NULL, 2, sizeof(items[0]));
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 1);
+    vec = test_hidl_buffer_ptr64(data, offsets->data[0]);
+    g_assert(!vec->data.ptr);
+    g_assert(!vec->count);
+    gbinder_local_request_unref(req);
+}
+
+/*==========================================================================*
+ * hidl_byte_vec
+ *==========================================================================*/
+
+static
+void
+test_hidl_byte_vec_destroy(
+    gpointer data)
+{
+    (*((int*)data))++;
+}
+
+static
+void
+test_hidl_byte_vec(
+    void)
+{
+    static const guint8 blob[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+    GUtilIntArray* offsets;
+    const HidlVec* vec;
+    int count = 0;
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_byte_vec(&writer, blob, sizeof(blob),
+        test_hidl_byte_vec_destroy, &count);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2);
+    vec = test_hidl_buffer_ptr64(data, offsets->data[0]);
+    g_assert(vec->data.ptr == blob);
+    g_assert(vec->count == sizeof(blob));
+    g_assert(test_hidl_buffer_ptr64(data, offsets->data[1]) == blob);
+    g_assert(gbinder_output_data_buffers_size(data) ==
+        sizeof(HidlVec) + 8);
+
+    /* Released once the data have been consumed */
+    g_assert(!count);
+    gbinder_output_data_consumed(data);
+    g_assert(count == 1);
+    gbinder_output_data_consumed(data);
+    gbinder_local_request_unref(req);
+    g_assert(count == 1);
+
+    /* Or when the request is deallocated */
+    req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_hidl_byte_vec(&writer, blob, sizeof(blob),
+        test_hidl_byte_vec_destroy, &count);
+    gbinder_writer_append_hidl_byte_vec(&writer, NULL, 0, NULL, NULL);
+    gbinder_local_request_unref(req);
+    g_assert(count == 2);
+
+    /* Or right away if there's no writer */
+    gbinder_writer_append_hidl_byte_vec(NULL, blob, sizeof(blob),
+        test_hidl_byte_vec_destroy, &count);
+    g_assert(count == 3);
+}
+
+/*==========================================================================*
+ * byte_array
+ *==========================================================================*/
+
+static
+void
+test_byte_array(
+    void)
+{
+    static const guint8 in[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+    static const guint8 out[] = {
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(0),
+        TEST_INT32_BYTES(5), 0x01, 0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00
+    };
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_32, NULL);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_byte_array(&writer, NULL, 1);
+    gbinder_writer_append_byte_array(&writer, in, 0);
+    gbinder_writer_append_byte_array(&writer, in, sizeof(in));
+    data = gbinder_local_request_data(req);
+    g_assert(!gbinder_output_data_offsets(data));
+    g_assert(!gbinder_output_data_buffers_size(data));
+    g_assert(data->bytes->len == sizeof(out));
+    g_assert(!memcmp(data->bytes->data, out, sizeof(out)));
+    gbinder_local_request_unref(req);
+}
+
+/*==========================================================================*
+ * arrays
+ *==========================================================================*/
+
+static
+void
+test_arrays(
+    void)
+{
+    static const gint32 in_int32[] = { 1, 2 };
+    static const gint64 in_int64[] = { 3 };
+    static const gfloat in_float[] = { 1.0f };
+    static const gdouble in_double[] = { 0.0 };
+    static const gboolean in_bool[] = { TRUE, FALSE, 5 };
+    static const char* in_str[] = { "ab", NULL };
+    static const guint8 out[] = {
+        TEST_INT32_BYTES(2), TEST_INT32_BYTES(1), TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(1), TEST_INT64_BYTES(3),
+        TEST_INT32_BYTES(1), TEST_INT32_BYTES(0x3f800000),
+        TEST_INT32_BYTES(0),
+        TEST_INT32_BYTES(1), TEST_INT64_BYTES(0),
+        TEST_INT32_BYTES(3),
+        TEST_INT32_BYTES(1), TEST_INT32_BYTES(0), TEST_INT32_BYTES(1),
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(2),
+        TEST_INT32_BYTES(2),
+        TEST_INT16_BYTES('a'), TEST_INT16_BYTES('b'), 0x00, 0x00, 0x00, 0x00,
+        TEST_INT32_BYTES(-1),
+        TEST_INT32_BYTES(0)
+    };
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_32, NULL);
+    GBinderOutputData* data;
+    GBinderWriter writer;
+
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_int32_array(&writer, in_int32,
+        G_N_ELEMENTS(in_int32));
+    gbinder_writer_append_int32_array(&writer, NULL, 1);
+    gbinder_writer_append_int64_array(&writer, in_int64,
+        G_N_ELEMENTS(in_int64));
+    gbinder_writer_append_float_array(&writer, in_float,
+        G_N_ELEMENTS(in_float));
+    gbinder_writer_append_float_array(&writer, in_float, 0);
+    gbinder_writer_append_double_array(&writer, in_double,
+        G_N_ELEMENTS(in_double));
+    gbinder_writer_append_bool_array(&writer, in_bool,
+        G_N_ELEMENTS(in_bool));
+    gbinder_writer_append_bool_array(&writer, in_bool, -1);
+    gbinder_writer_append_string16_array(&writer, in_str,
+        G_N_ELEMENTS(in_str));
+    gbinder_writer_append_string16_array(&writer, in_str, 0);
+    data = gbinder_local_request_data(req);
+    g_assert(!gbinder_output_data_offsets(data));
+    g_assert(!gbinder_output_data_buffers_size(data));
+    g_assert(data->bytes->len == sizeof(out));
+    g_assert(!memcmp(data->bytes->data, out, sizeof(out)));
+    gbinder_local_request_unref(req);
+
+    /* Arrays which are too large aren't written at all */
+    req = gbinder_local_request_new(&gbinder_io_32, NULL);
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_int32_array(&writer, in_int32, G_MAXINT32 / 4 + 1);
+    gbinder_writer_append_int64_array(&writer, in_int64, G_MAXINT32 / 8 + 1);
+    gbinder_writer_append_bool_array(&writer, in_bool, G_MAXINT32 / 4 + 1);
+    gbinder_writer_append_string16_array(&writer, in_str, G_MAXINT32);
+    if (sizeof(gssize) > 4) {
+        gbinder_writer_append_byte_array(&writer, in_int32,
+            (gssize)G_MAXINT32 + 1);
+        gbinder_writer_append_double_array(&writer, in_double,
+            (gssize)G_MAXINT32 + 1);
+    }
+    data = gbinder_local_request_data(req);
+    g_assert(!data->bytes->len);
+    gbinder_local_request_unref(req);
+}
+
+/*==========================================================================*
+ * measured
+ *==========================================================================*/
+
+#define TEST_MEASURED_COUNT (200)
+
+typedef struct test_measured_data {
+    GBinderLocalRequest* req;
+    const guint8* ptr;
+    int passes;
+    int destroyed;
+} TestMeasuredData;
+
+static const guint8 test_measured_blob[] = { 0x01, 0x02, 0x03, 0x04 };
+
+static
+void
+test_measured_fill(
+    GBinderWriter* writer,
+    void* user_data)
+{
+    TestMeasuredData* test = user_data;
+    guint i;
+
+    test->passes++;
+    if (test->req) {
+        test->ptr = gbinder_local_request_data(test->req)->bytes->data;
+    }
+    gbinder_writer_append_int32(writer, 42);
+    gbinder_writer_append_string16(writer, "foo");
+    gbinder_writer_append_buffer_object(writer, test_measured_blob,
+        sizeof(test_measured_blob));
+    gbinder_writer_append_local_object(writer, NULL);
+    for (i = 0; i < TEST_MEASURED_COUNT; i++) {
+        gbinder_writer_append_int32(writer, i);
+    }
+    gbinder_writer_append_string8(writer, "bar");
+}
+
+static
+void
+test_measured_destroy(
+    gpointer user_data)
+{
+    ((TestMeasuredData*)user_data)->destroyed++;
+}
+
+static
+void
+test_measured_fill_hidl(
+    GBinderWriter* writer,
+    void* user_data)
+{
+    TestMeasuredData* test = user_data;
+
+    test->passes++;
+    gbinder_writer_append_hidl_string(writer, "foo");
+    gbinder_writer_append_hidl_byte_vec(writer, test_measured_blob,
+        sizeof(test_measured_blob), test_measured_destroy, test);
+}
+
+#define TEST_MEASURED_OBJECTS (8)
+
+static
+void
+test_measured_fill_objects(
+    GBinderWriter* writer,
+    void* user_data)
+{
+    TestMeasuredData* test = user_data;
+    guint i;
+
+    test->passes++;
+    if (test->req) {
+        test->ptr = gbinder_local_request_data(test->req)->bytes->data;
+    }
+    for (i = 0; i < TEST_MEASURED_OBJECTS; i++) {
+        gbinder_writer_append_local_object(writer, NULL);
+        gbinder_writer_append_buffer_object(writer, test_measured_blob,
+            sizeof(test_measured_blob));
+    }
+}
+
+static
+void
+test_measured(
+    void)
+{
+    GBinderLocalRequest* req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderLocalRequest* ref = gbinder_local_request_new(&gbinder_io_64, NULL);
+    GBinderOutputData* data;
+    GBinderOutputData* ref_data;
+    GUtilIntArray* offsets;
+    GUtilIntArray* ref_offsets;
+    GBinderWriter writer;
+    TestMeasuredData test;
+
+    /* The result is the same as if the data were written directly */
+    memset(&test, 0, sizeof(test));
+    gbinder_local_request_init_writer(ref, &writer);
+    gbinder_writer_append_int32(&writer, 1);
+    test_measured_fill(&writer, &test);
+    g_assert(test.passes == 1);
+
+    memset(&test, 0, sizeof(test));
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_int32(&writer, 1);
+    test.req = req;
+    gbinder_writer_append_measured(&writer, test_measured_fill, &test);
+    g_assert(test.passes == 2);
+
+    data = gbinder_local_request_data(req);
+    ref_data = gbinder_local_request_data(ref);
+    g_assert(data->bytes->len == ref_data->bytes->len);
+    g_assert(!memcmp(data->bytes->data, ref_data->bytes->data,
+        data->bytes->len));
+    offsets = gbinder_output_data_offsets(data);
+    ref_offsets = gbinder_output_data_offsets(ref_data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2);
+    g_assert(offsets->count == ref_offsets->count);
+    g_assert(!memcmp(offsets->data, ref_offsets->data,
+        sizeof(offsets->data[0]) * offsets->count));
+    g_assert(gbinder_output_data_buffers_size(data) ==
+        gbinder_output_data_buffers_size(ref_data));
+
+    /* The second pass didn't have to reallocate anything */
+    g_assert(data->bytes->data == test.ptr);
+    gbinder_local_request_unref(req);
+    gbinder_local_request_unref(ref);
+
+    /* Destroy callbacks from the measuring pass are ignored */
+    memset(&test, 0, sizeof(test));
+    req = gbinder_local_request_new(&gbinder_io_64, NULL);
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_measured(&writer, test_measured_fill_hidl, &test);
+    g_assert(test.passes == 2);
+    data = gbinder_local_request_data(req);
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 4);
+    g_assert(!test.destroyed);
+    gbinder_local_request_unref(req);
+    g_assert(test.destroyed == 1);
+
+    /* Multiple objects, each of them smaller than the worst case */
+    memset(&test, 0, sizeof(test));
+    req = gbinder_local_request_new(&gbinder_io_32, NULL);
+    test.req = req;
+    gbinder_local_request_init_writer(req, &writer);
+    gbinder_writer_append_measured(&writer, test_measured_fill_objects,
+        &test);
+    g_assert(test.passes == 2);
+    data = gbinder_local_request_data(req);
+    g_assert(data->bytes->data == test.ptr);
+    g_assert(data->bytes->len == TEST_MEASURED_OBJECTS *
+        (BINDER_OBJECT_SIZE_32 + BUFFER_OBJECT_SIZE_32));
+    offsets = gbinder_output_data_offsets(data);
+    g_assert(offsets);
+    g_assert(offsets->count == 2 * TEST_MEASURED_OBJECTS);
+    gbinder_local_request_unref(req);
+}
+
 /*==========================================================================*
  * hidl_string_vec
  *==========================================================================*/
@@ -595,7 +1254,22 @@ int main(int argc, char* argv[])
         g_free(path);
     }
 
+    for (i = 0; i < G_N_ELEMENTS(test_string16_utf8_tests); i++) {
+        const TestString16Utf8Data* test = test_string16_utf8_tests + i;
+        char* path = g_strconcat(TEST_PREFIX "string16_utf8/", test->name,
+            NULL);
+
+        g_test_add_data_func(path, test, test_string16_utf8);
+        g_free(path);
+    }
+
     g_test_add_func(TEST_PREFIX "hidl_string/2strings", test_hidl_string2);
+    g_test_add_func(TEST_PREFIX "hidl_string/many", test_hidl_string_many);
+    g_test_add_func(TEST_PREFIX "hidl_struct", test_hidl_struct);
+    g_test_add_func(TEST_PREFIX "hidl_byte_vec", test_hidl_byte_vec);
+    g_test_add_func(TEST_PREFIX "byte_array", test_byte_array);
+    g_test_add_func(TEST_PREFIX "arrays", test_arrays);
+    g_test_add_func(TEST_PREFIX "measured", test_measured);
     for (i = 0; i < G_N_ELEMENTS(test_hidl_string_tests); i++) {
         const TestHidlStringData* test = test_hidl_string_tests + i;
         char* path = g_strconcat(TEST_PREFIX "hidl_string/", test->name, NULL);